@@ -3,11 +3,14 @@
 #include <iostream>
 
 #include "utils/VectorUtils.hpp"
+#include "Profiling/Profiler.hpp"
 
 Agent::Agent(Grid& grid, const sf::Vector2f startPosition, const float maxSpeed, const float maxForce) :
     m_grid(grid),
     m_maxSpeed(maxSpeed),
-    m_maxForce(maxForce)
+    m_maxForce(maxForce),
+    m_neighbours(nullptr),
+    m_separationRadius(0)
 {
     m_shape.setFillColor(sf::Color::Cyan);
     m_shape.setOutlineThickness(1);
@@ -52,10 +55,17 @@ float Agent::getOutlineThickness() const
     return m_shape.getOutlineThickness();
 }
 
+void Agent::setNeighbours(const SpatialGrid* neighbours, const float radius)
+{
+    m_neighbours = neighbours;
+    m_separationRadius = radius;
+}
 
 void Agent::update(const sf::Time dt)
 {
-    const auto forceToApply = steeringBehaviourFlowField();
+    LAB6FLOWFIELD_PROFILE_SCOPE("Agent::update");
+
+    const auto forceToApply = steeringBehaviourFlowField() + steeringBehaviourSeparation();
 
     m_velocity = m_velocity + (forceToApply * dt.asSeconds());
 
@@ -77,64 +87,12 @@ void Agent::draw(sf::RenderTarget& target, sf::RenderStates states) const
 
 sf::Vector2f Agent::steeringBehaviourFlowField() const
 {
-    const sf::Vector2i nodeCoords = m_grid.convertWorldToGridCoordinates(getPosition());
-    //std::cout << "\rGrid coords: " << nodeCoords.x << " " << nodeCoords.y << "\tAgent pos: " << getPosition().x << " " << getPosition().y << std::flush;
-
-    sf::Vector2f f00;
-    sf::Vector2f f01;
-    sf::Vector2f f10;
-    sf::Vector2f f11;
-
-    const auto node00 = m_grid.findNode({nodeCoords.x, nodeCoords.y});
-    const auto node01 = m_grid.findNode({nodeCoords.x, nodeCoords.y + 1});
-    const auto node10 = m_grid.findNode({nodeCoords.x + 1, nodeCoords.y});
-    const auto node11 = m_grid.findNode({nodeCoords.x + 1, nodeCoords.y + 1});
-    if (node00 != nullptr)
-    {
-        f00 = sf::Vector2f(node00->getFlowFieldDirection());
-    }
-    else
-    {
-        // Return no velocity because the agent is not on a node parts of the grid
-        return {0, 0};
-    }
-
-    if (node01 != nullptr)
-    {
-        f01 = sf::Vector2f(node01->getFlowFieldDirection());
-    }
-    else
-    {
-        f01 = sf::Vector2f(0, -1);
-    }
-    if (node10 != nullptr)
-    {
-        f10 = sf::Vector2f(node10->getFlowFieldDirection());
-    }
-    else
-    {
-        f10 = sf::Vector2f(-1, 0);
-    }
-
-    if (node11 != nullptr)
-    {
-        f11 = sf::Vector2f(node11->getFlowFieldDirection());
-    }
-    else
-    {
-        f11 = sf::Vector2f(1, 1);
-    }
-
     const sf::Vector2f nodeGridPos = m_grid.convertWorldToGridPosition(getPosition());
 
-    const auto xWeight = nodeGridPos.x - static_cast<float>(nodeCoords.x);
-
-    const auto top = (f00 * (1 - xWeight)) + (f10 * xWeight);
-    const auto bottom = (f01 * (1 - xWeight)) + (f11 * xWeight);
-
-    const auto yWeight = nodeGridPos.y - static_cast<float>(nodeCoords.y);
+    // Return no velocity when the agent is not on a node parts of the grid, straight to the goal when it sees it
+    const FlowField::Direction sample = m_grid.getFlowField().getSteeringDirection(nodeGridPos.x, nodeGridPos.y);
 
-    const auto direction = VectorUtils::normalize((top * (1 - yWeight)) + (bottom * yWeight));
+    const auto direction = VectorUtils::normalize(sf::Vector2f(sample.x, sample.y));
     if (std::isnan(VectorUtils::getLength(direction)))
     {
         return {0, 0};
@@ -146,3 +104,21 @@ sf::Vector2f Agent::steeringBehaviourFlowField() const
 
     return velocityChange * (m_maxForce / m_maxSpeed);
 }
+
+sf::Vector2f Agent::steeringBehaviourSeparation() const
+{
+    if (m_neighbours == nullptr || m_separationRadius <= 0) return {0, 0};
+
+    // The agent is not in the grid of neighbours, nothing to exclude
+    const SpatialGrid::Separation separation = m_neighbours->getSeparation(getPosition().x, getPosition().y,
+                                                                           m_separationRadius, -1);
+    const sf::Vector2f force = sf::Vector2f(separation.x, separation.y) * m_maxForce;
+
+    const float length = VectorUtils::getLength(force);
+    if (length > m_maxForce)
+    {
+        return force * (m_maxForce / length);
+    }
+
+    return force;
+}
@@ -5,6 +5,7 @@
 #include <SFML/Graphics/CircleShape.hpp>
 
 #include "Grid.hpp"
+#include "Crowd/SpatialGrid.hpp"
 
 class Agent : public sf::Drawable
 {
@@ -21,17 +22,29 @@ public:
     float getRadius() const;
 
     float getOutlineThickness() const;
+
+    /**
+     * \brief Agents to keep away from, disabled when nullptr
+     * \param radius distance under which a neighbour pushes the agent away
+     */
+    void setNeighbours(const SpatialGrid* neighbours, float radius);
     
     void update(sf::Time dt);
 
 private:
     /**
-     * \brief Steering behaviour using Bilinear Interpolation
-     * \details https://en.wikipedia.org/wiki/Bilinear_interpolation
+     * \brief Steering behaviour using Bilinear Interpolation, or straight to the goal when the agent sees it
+     * \details https://en.wikipedia.org/wiki/Bilinear_interpolation (see FlowField::getSteeringDirection())
      * \return calculated velocity to be assigned to the agent
      */
     sf::Vector2f steeringBehaviourFlowField() const;
 
+    /**
+     * \brief Steering behaviour pushing the agent away from its neighbours
+     * \return force to add to the agent, no longer than its max force
+     */
+    sf::Vector2f steeringBehaviourSeparation() const;
+
     void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
 
     // Reference of the grid where the agent navigate in
@@ -42,6 +55,9 @@ private:
     sf::Vector2f m_velocity;
     float m_maxSpeed;
     float m_maxForce;
+
+    const SpatialGrid* m_neighbours;
+    float m_separationRadius;
 };
 
 
@@ -0,0 +1,214 @@
+#include "MapGenerator.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../FlowField/FlowField.hpp"
+#include "../FlowField/ObstacleMap.hpp"
+
+void MapGenerator::generate(FlowField& field, const MapType type, const unsigned seed)
+{
+    ObstacleMap obstacles(field.getWidth(), field.getHeight());
+
+    switch (type)
+    {
+    case MapType::Open:
+        break;
+    case MapType::Maze:
+        generateMaze(obstacles, seed);
+        break;
+    case MapType::Rooms:
+        generateRooms(obstacles);
+        break;
+    case MapType::RandomObstacles:
+        generateRandomObstacles(obstacles, seed);
+        break;
+    }
+
+    field.setObstacles(obstacles);
+}
+
+void MapGenerator::generateTerrain(FlowField& field, const unsigned seed)
+{
+    // Each patch of 8x8 cells gets one kind of terrain, normal terrain being the most common
+    constexpr int PatchSize = 8;
+    constexpr std::uint8_t TerrainCosts[] = {1, 1, 1, 1, 2, 4, 8, 50};
+    constexpr int TerrainCount = sizeof(TerrainCosts) / sizeof(TerrainCosts[0]);
+
+    std::mt19937 random(seed);
+    const int patchesPerRow = (field.getWidth() + PatchSize - 1) / PatchSize;
+    const int patchesPerColumn = (field.getHeight() + PatchSize - 1) / PatchSize;
+
+    std::vector<std::uint8_t> patchCosts(patchesPerRow * patchesPerColumn);
+    for (auto& cost : patchCosts)
+    {
+        cost = TerrainCosts[random() % TerrainCount];
+    }
+
+    for (int y = 0; y < field.getHeight(); y++)
+    {
+        for (int x = 0; x < field.getWidth(); x++)
+        {
+            field.setTerrainCost(x, y, patchCosts[x / PatchSize + patchesPerRow * (y / PatchSize)]);
+        }
+    }
+}
+
+int MapGenerator::findCentralPassableCell(const FlowField& field)
+{
+    const int cellCount = field.getCellCount();
+    const int center = field.toIndex(field.getWidth() / 2, field.getHeight() / 2);
+
+    for (int offset = 0; offset < cellCount; offset++)
+    {
+        const int index = (center + offset) % cellCount;
+        if (!field.isObstacle(index)) return index;
+    }
+
+    return -1;
+}
+
+std::string MapGenerator::getName(const MapType type)
+{
+    switch (type)
+    {
+    case MapType::Open:
+        return "open";
+    case MapType::Maze:
+        return "maze";
+    case MapType::Rooms:
+        return "rooms";
+    case MapType::RandomObstacles:
+        return "random";
+    }
+
+    return "unknown";
+}
+
+bool MapGenerator::parse(const std::string& name, MapType& type)
+{
+    for (const MapType candidate : {MapType::Open, MapType::Maze, MapType::Rooms, MapType::RandomObstacles})
+    {
+        if (getName(candidate) == name)
+        {
+            type = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MapGenerator::generateMaze(ObstacleMap& obstacles, const unsigned seed)
+{
+    const int width = obstacles.getWidth();
+    const int height = obstacles.getHeight();
+
+    // Maze nodes are the cells with even coordinates, the cells between two nodes are the walls to carve
+    const int mazeWidth = (width + 1) / 2;
+    const int mazeHeight = (height + 1) / 2;
+
+    obstacles.fillRect(0, 0, width, height, true);
+
+    std::mt19937 random(seed);
+    std::vector<bool> visited(mazeWidth * mazeHeight, false);
+    std::vector<int> stack;
+    stack.reserve(mazeWidth * mazeHeight);
+
+    visited[0] = true;
+    obstacles.setObstacle(0, 0, false);
+    stack.push_back(0);
+
+    constexpr int StepX[4] = {1, -1, 0, 0};
+    constexpr int StepY[4] = {0, 0, 1, -1};
+
+    while (!stack.empty())
+    {
+        const int current = stack.back();
+        const int currentX = current % mazeWidth;
+        const int currentY = current / mazeWidth;
+
+        int candidates[4];
+        int candidateCount = 0;
+        for (int direction = 0; direction < 4; direction++)
+        {
+            const int nextX = currentX + StepX[direction];
+            const int nextY = currentY + StepY[direction];
+            if (nextX < 0 || nextX >= mazeWidth || nextY < 0 || nextY >= mazeHeight) continue;
+            if (visited[nextX + mazeWidth * nextY]) continue;
+
+            candidates[candidateCount++] = direction;
+        }
+
+        if (candidateCount == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        const int direction = candidates[random() % candidateCount];
+        const int nextX = currentX + StepX[direction];
+        const int nextY = currentY + StepY[direction];
+        const int next = nextX + mazeWidth * nextY;
+
+        // Carve the wall between both nodes, then the next node itself
+        obstacles.setObstacle(currentX * 2 + StepX[direction], currentY * 2 + StepY[direction], false);
+        obstacles.setObstacle(nextX * 2, nextY * 2, false);
+
+        visited[next] = true;
+        stack.push_back(next);
+    }
+}
+
+void MapGenerator::generateRooms(ObstacleMap& obstacles)
+{
+    constexpr int RoomSize = 16;
+    constexpr int DoorOffset = RoomSize / 2;
+
+    const int width = obstacles.getWidth();
+    const int height = obstacles.getHeight();
+
+    // Walls on the last column and the last row of each room
+    for (int x = RoomSize - 1; x < width; x += RoomSize)
+    {
+        obstacles.fillRect(x, 0, 1, height, true);
+    }
+    for (int y = RoomSize - 1; y < height; y += RoomSize)
+    {
+        obstacles.fillRect(0, y, width, 1, true);
+    }
+
+    // Doors are two cells wide, in the middle of each wall segment
+    for (int x = RoomSize - 1; x < width; x += RoomSize)
+    {
+        for (int y = 0; y < height; y += RoomSize)
+        {
+            obstacles.fillRect(x, y + DoorOffset - 1, 1, 2, false);
+        }
+    }
+    for (int y = RoomSize - 1; y < height; y += RoomSize)
+    {
+        for (int x = 0; x < width; x += RoomSize)
+        {
+            obstacles.fillRect(x + DoorOffset - 1, y, 2, 1, false);
+        }
+    }
+}
+
+void MapGenerator::generateRandomObstacles(ObstacleMap& obstacles, const unsigned seed)
+{
+    constexpr unsigned ObstaclePercentage = 30;
+
+    std::mt19937 random(seed);
+    for (int y = 0; y < obstacles.getHeight(); y++)
+    {
+        for (int x = 0; x < obstacles.getWidth(); x++)
+        {
+            if (random() % 100 < ObstaclePercentage)
+            {
+                obstacles.setObstacle(x, y, true);
+            }
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef LAB6FLOWFIELD_MAPGENERATOR_HPP
+#define LAB6FLOWFIELD_MAPGENERATOR_HPP
+
+#include <string>
+
+class FlowField;
+class ObstacleMap;
+
+enum class MapType
+{
+    Open,
+    Maze,
+    Rooms,
+    RandomObstacles
+};
+
+/**
+ * \brief Generate deterministic benchmark maps by placing obstacles on a flow field
+ * \details The obstacles are drawn in an ObstacleMap, with rectangles where possible, then applied to the field at once.
+ */
+class MapGenerator
+{
+public:
+    MapGenerator() = delete;
+
+    /**
+     * \brief Replace the obstacles of the field with a map of the given type
+     * \param seed seed of the random generator, the same seed always gives the same map
+     */
+    static void generate(FlowField& field, MapType type, unsigned seed);
+
+    /**
+     * \brief Replace the terrain costs of the field with patches of normal terrain, mud and danger zones
+     */
+    static void generateTerrain(FlowField& field, unsigned seed);
+
+    /**
+     * \brief Find the passable cell the closest to the center of the grid (in index order)
+     * \return index of the cell, -1 if every cell is an obstacle
+     */
+    static int findCentralPassableCell(const FlowField& field);
+
+    static std::string getName(MapType type);
+
+    /**
+     * \brief Convert a map name (open, maze, rooms, random) to its type
+     * \return false if the name is unknown
+     */
+    static bool parse(const std::string& name, MapType& type);
+
+private:
+    /**
+     * \brief Perfect maze carved with an iterative recursive backtracker, corridors are one cell wide
+     */
+    static void generateMaze(ObstacleMap& obstacles, unsigned seed);
+
+    /**
+     * \brief Square rooms separated by walls, each wall having a door in its middle
+     */
+    static void generateRooms(ObstacleMap& obstacles);
+
+    /**
+     * \brief About 30% of the cells are obstacles, placed at random
+     */
+    static void generateRandomObstacles(ObstacleMap& obstacles, unsigned seed);
+};
+
+
+#endif //LAB6FLOWFIELD_MAPGENERATOR_HPP
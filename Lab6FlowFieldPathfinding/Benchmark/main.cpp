@@ -0,0 +1,861 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Crowd/AgentStore.hpp"
+#include "../Crowd/ThreadPool.hpp"
+#include "../FlowField/AsyncFlowField.hpp"
+#include "../FlowField/FlowField.hpp"
+#include "../FlowField/FlowFieldCache.hpp"
+#include "../FlowField/FlowFieldJobs.hpp"
+#include "../FlowField/HierarchicalFlowField.hpp"
+#include "../FlowField/MapFile.hpp"
+#include "../FlowField/ObstacleMap.hpp"
+#include "../FlowField/PathExtractor.hpp"
+#include "../FlowField/VectorFieldKernel.hpp"
+#include "../Rendering/GridMesh.hpp"
+#include "MapGenerator.hpp"
+
+/*
+ * Count every heap allocation of the process, so each phase can report how many it did
+ */
+namespace
+{
+    std::atomic<std::size_t> allocationCount{0};
+}
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Same values as the game, so agents move the same way
+    constexpr float CellSize = 16.f;
+    constexpr float AgentMaxSpeed = 60.f;
+    constexpr float AgentMaxForce = 150.f;
+    constexpr float TimeStep = 1.f / 60.f;
+
+    constexpr unsigned Seed = 42;
+
+    // The game asks for a new field every few frames, faster than the big fields are calculated
+    constexpr int AsyncRequestCount = 8;
+    constexpr int AsyncFramesPerRequest = 4;
+    constexpr auto AsyncFrameInterval = std::chrono::milliseconds(2);
+
+    // Bulk edits of a level: rectangles and triangles of about this size, placed at random
+    constexpr int ObstacleEditCount = 256;
+    constexpr int ObstacleEditSize = 32;
+
+    struct Options
+    {
+        std::vector<int> sizes = {50, 128, 256, 512, 1024, 2048, 4096};
+        std::vector<MapType> maps = {MapType::Open, MapType::Maze, MapType::Rooms, MapType::RandomObstacles};
+        std::vector<FlowField::Integrator> integrators = {
+            FlowField::Integrator::BreadthFirst, FlowField::Integrator::Weighted
+        };
+        int repeat = 5;
+        int pathCount = 1000;
+        int agentCount = 10000;
+        int agentTicks = 60;
+        int repairCount = 200;
+        int cacheGoalCount = 8;
+        int cacheLookupCount = 10000;
+        int jobGoalCount = 16;
+        int sectorSize = HierarchicalFlowField::DefaultSectorSize;
+        // Threads updating the agents, the calling one included
+        int threadCount = ThreadPool::getDefaultWorkerCount() + 1;
+    };
+
+    /**
+     * \brief One benchmarked configuration
+     */
+    struct Scenario
+    {
+        int size;
+        MapType map;
+        FlowField::Integrator integrator;
+    };
+
+    struct Measure
+    {
+        double bestMilliseconds;
+        std::size_t allocations;
+    };
+
+    /**
+     * \brief Run a function several times
+     * \return best time of all the runs and the number of allocations done by one run
+     */
+    template <typename Function>
+    Measure measure(const int repeat, Function&& function)
+    {
+        Measure result{1e300, 0};
+        for (int i = 0; i < repeat; i++)
+        {
+            const std::size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+            const auto start = Clock::now();
+
+            function();
+
+            const auto end = Clock::now();
+            result.allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+            const double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+            if (milliseconds < result.bestMilliseconds) result.bestMilliseconds = milliseconds;
+        }
+
+        return result;
+    }
+
+    const char* getIntegratorName(const FlowField::Integrator integrator)
+    {
+        switch (integrator)
+        {
+        case FlowField::Integrator::BreadthFirst:
+            return "bfs";
+        case FlowField::Integrator::Weighted:
+            return "weighted";
+        case FlowField::Integrator::Eikonal:
+            return "eikonal";
+        }
+
+        return "unknown";
+    }
+
+    bool parseIntegrator(const std::string& name, FlowField::Integrator& integrator)
+    {
+        for (const auto candidate : {
+                 FlowField::Integrator::BreadthFirst, FlowField::Integrator::Weighted, FlowField::Integrator::Eikonal
+             })
+        {
+            if (name == getIntegratorName(candidate))
+            {
+                integrator = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void printHeader()
+    {
+        std::printf("%-6s %-7s %-10s %-12s %12s %16s %12s  %s\n", "size", "map", "integrator", "phase", "best ms",
+                    "items/s", "allocs", "notes");
+    }
+
+    void printRow(const Scenario& scenario, const char* phase, const Measure& measure, const double itemCount,
+                  const std::string& notes = "")
+    {
+        const double itemsPerSecond = itemCount / (measure.bestMilliseconds / 1000.0);
+        std::printf("%-6d %-7s %-10s %-12s %12.3f %16.0f %12zu  %s\n", scenario.size,
+                    MapGenerator::getName(scenario.map).c_str(), getIntegratorName(scenario.integrator), phase,
+                    measure.bestMilliseconds, itemsPerSecond, measure.allocations, notes.c_str());
+        std::fflush(stdout);
+    }
+
+    /**
+     * \brief Pick cells reachable from the goal, at random but always the same for a given map
+     */
+    std::vector<int> pickReachableCells(const FlowField& field, const int count)
+    {
+        std::vector<int> reachable;
+        for (int i = 0; i < field.getCellCount(); i++)
+        {
+            const int cost = field.getCostDistance(i);
+            if (cost != FlowField::Unvisited && cost != FlowField::Impassable) reachable.push_back(i);
+        }
+
+        std::vector<int> cells;
+        if (reachable.empty()) return cells;
+
+        std::mt19937 random(Seed);
+        cells.reserve(count);
+        for (int i = 0; i < count; i++)
+        {
+            cells.push_back(reachable[random() % reachable.size()]);
+        }
+
+        return cells;
+    }
+
+    /**
+     * \brief Walk the flow from each start to the goal (or to a cell without direction), one path after the other
+     * \return total number of steps walked
+     */
+    template <typename Field>
+    long long walkPaths(const Field& field, const std::vector<int>& starts)
+    {
+        long long steps = 0;
+        for (const int start : starts)
+        {
+            int current = start;
+            while (true)
+            {
+                const int next = field.getNextIndex(current);
+                if (next == -1) break;
+
+                current = next;
+                steps++;
+            }
+        }
+
+        return steps;
+    }
+
+    AgentStore spawnAgents(const FlowField& field, const std::vector<int>& cells)
+    {
+        AgentStore agents(AgentMaxSpeed, AgentMaxForce);
+        agents.reserve(static_cast<int>(cells.size()));
+        for (const int cell : cells)
+        {
+            const int x = cell % field.getWidth();
+            const int y = cell / field.getWidth();
+            agents.add(static_cast<float>(x) * CellSize + CellSize / 2, static_cast<float>(y) * CellSize + CellSize / 2);
+        }
+
+        return agents;
+    }
+
+    void runBenchmark(const Scenario& scenario, const Options& options, ThreadPool& pool)
+    {
+        const int size = scenario.size;
+        const double cellCount = static_cast<double>(size) * size;
+
+        FlowField field(size, size, CellSize);
+        MapGenerator::generate(field, scenario.map, Seed);
+        field.setIntegrator(scenario.integrator);
+        if (scenario.integrator != FlowField::Integrator::BreadthFirst)
+        {
+            MapGenerator::generateTerrain(field, Seed);
+        }
+
+        const int goal = MapGenerator::findCentralPassableCell(field);
+        if (goal == -1) return;
+        field.setGoal(goal % size, goal / size);
+
+        // Less runs on the biggest grids, a single run already takes a while
+        const int repeat = cellCount > 1e6 ? std::max(1, options.repeat / 2) : options.repeat;
+
+        printRow(scenario, "map", measure(repeat, [&] { MapGenerator::generate(field, scenario.map, Seed); }),
+                 cellCount);
+
+        ObstacleMap obstacles(size, size);
+        std::vector<ObstacleMap::Point> editOrigins;
+        std::mt19937 editRandom(Seed);
+        for (int i = 0; i < ObstacleEditCount; i++)
+        {
+            editOrigins.push_back({static_cast<float>(editRandom() % size), static_cast<float>(editRandom() % size)});
+        }
+        std::vector<ObstacleMap::Point> triangle(3);
+        const Measure editMeasure = measure(repeat, [&]
+        {
+            for (int i = 0; i < ObstacleEditCount; i++)
+            {
+                const ObstacleMap::Point& origin = editOrigins[i];
+                if (i % 2 == 0)
+                {
+                    obstacles.fillRect(static_cast<int>(origin.x), static_cast<int>(origin.y), ObstacleEditSize,
+                                       ObstacleEditSize, i % 4 == 0);
+                    continue;
+                }
+
+                triangle[0] = origin;
+                triangle[1] = {origin.x + ObstacleEditSize, origin.y + ObstacleEditSize / 4};
+                triangle[2] = {origin.x + ObstacleEditSize / 4, origin.y + ObstacleEditSize};
+                obstacles.fillPolygon(triangle, i % 4 == 1);
+            }
+        });
+        printRow(scenario, "edits", editMeasure, ObstacleEditCount,
+                 std::to_string(ObstacleEditSize) + " cell rects and triangles");
+
+        printRow(scenario, "reset", measure(repeat, [&] { field.resetFields(); }), cellCount);
+        switch (scenario.integrator)
+        {
+        case FlowField::Integrator::BreadthFirst:
+        {
+            // On the calling thread only, then on the thread pool if the grid is big enough, with the same costs
+            const auto search = [&]
+            {
+                field.resetFields();
+                field.createCostField();
+            };
+            printRow(scenario, "cost 1t", measure(repeat, search), cellCount);
+
+            std::vector<int> serialCosts(field.getCellCount());
+            for (int i = 0; i < field.getCellCount(); i++) serialCosts[i] = field.getCostDistance(i);
+
+            field.setThreadPool(&pool);
+            const Measure costMeasure = measure(repeat, search);
+            bool isDeterministic = true;
+            for (int i = 0; i < field.getCellCount() && isDeterministic; i++)
+            {
+                isDeterministic = field.getCostDistance(i) == serialCosts[i];
+            }
+            printRow(scenario, "cost", costMeasure, cellCount, !field.isParallelSearch()
+                         ? std::string("serial")
+                         : std::to_string(pool.getThreadCount()) + " threads, " +
+                         (isDeterministic ? "same costs" : "COSTS DIFFER"));
+            printRow(scenario, "integration", measure(repeat, [&] { field.createIntegrationField(); }), cellCount);
+            break;
+        }
+        case FlowField::Integrator::Weighted:
+            printRow(scenario, "integration", measure(repeat, [&]
+            {
+                field.resetFields();
+                field.createWeightedIntegrationField();
+            }), cellCount);
+            break;
+        case FlowField::Integrator::Eikonal:
+        {
+            // Serial sweeps first, then the 4 orderings on the thread pool, which must give the same integrations but
+            // for the rounding (the times are updated in another order). calculate() keeps using the serial sweeps
+            // afterwards, the default of the solver.
+            EikonalSolver& solver = field.getEikonalSolver();
+            const auto solve = [&]
+            {
+                field.resetFields();
+                field.createEikonalIntegrationField();
+            };
+            const Measure serialMeasure = measure(repeat, solve);
+            const int serialIterationCount = solver.getIterationCount();
+
+            std::vector<int> serialIntegrations(field.getCellCount());
+            for (int i = 0; i < field.getCellCount(); i++) serialIntegrations[i] = field.getIntegration(i);
+
+            // The weighted integrator reaches the same cells, diagonal steps between 2 obstacles included
+            field.resetFields();
+            field.createWeightedIntegrationField();
+            int unmatchedCellCount = 0;
+            for (int i = 0; i < field.getCellCount(); i++)
+            {
+                if ((field.getIntegration(i) == FlowField::Unvisited) !=
+                    (serialIntegrations[i] == FlowField::Unvisited))
+                {
+                    unmatchedCellCount++;
+                }
+            }
+            printRow(scenario, "serial", serialMeasure, cellCount,
+                     std::to_string(serialIterationCount) + " iterations, " +
+                     (unmatchedCellCount == 0
+                          ? std::string("same cells reached as weighted")
+                          : std::to_string(unmatchedCellCount) + " CELLS REACHED DIFFERENTLY THAN WEIGHTED"));
+
+            solver.setThreadPool(&pool);
+            solver.setParallel(true);
+            const Measure parallelMeasure = measure(repeat, solve);
+            bool isSameField = true;
+            for (int i = 0; i < field.getCellCount() && isSameField; i++)
+            {
+                isSameField = std::abs(field.getIntegration(i) - serialIntegrations[i]) <= 1;
+            }
+
+            char speedup[32];
+            std::snprintf(speedup, sizeof(speedup), "%.2f",
+                          serialMeasure.bestMilliseconds / parallelMeasure.bestMilliseconds);
+            printRow(scenario, "integration", parallelMeasure, cellCount,
+                     std::to_string(solver.getIterationCount()) + " iterations, " +
+                     std::to_string(pool.getThreadCount()) + " threads, " + speedup + "x faster, " +
+                     (isSameField ? "same integrations" : "INTEGRATIONS DIFFER"));
+            solver.setParallel(false);
+            break;
+        }
+        }
+        // The scalar kernel first, its codes are the reference the SIMD kernel must give too
+        {
+            const VectorFieldKernel::InstructionSet bestSet = field.getInstructionSet();
+            field.setInstructionSet(VectorFieldKernel::InstructionSet::Scalar);
+            const Measure scalarMeasure = measure(repeat, [&] { field.computeVectorField(); });
+            std::vector<int> scalarNextIndices(field.getCellCount());
+            for (int i = 0; i < field.getCellCount(); i++) scalarNextIndices[i] = field.getNextIndex(i);
+            printRow(scenario, "vector 1x", scalarMeasure, cellCount);
+
+            field.setInstructionSet(bestSet);
+            const Measure simdMeasure = measure(repeat, [&] { field.computeVectorField(); });
+            bool isSameField = true;
+            for (int i = 0; i < field.getCellCount() && isSameField; i++)
+            {
+                isSameField = field.getNextIndex(i) == scalarNextIndices[i];
+            }
+
+            // A cell pointing to a cell the goal was never reached from would leave the agents stuck there
+            int unvisitedNextCount = 0;
+            for (int i = 0; i < field.getCellCount(); i++)
+            {
+                const int next = field.getNextIndex(i);
+                if (next >= 0 && field.getCostDistance(next) == FlowField::Unvisited) unvisitedNextCount++;
+            }
+
+            char speedup[32];
+            std::snprintf(speedup, sizeof(speedup), "%.2f",
+                          scalarMeasure.bestMilliseconds / simdMeasure.bestMilliseconds);
+            printRow(scenario, "vector", simdMeasure, cellCount,
+                     std::string(VectorFieldKernel::getName(bestSet)) + ", " + speedup + "x faster, " +
+                     (isSameField ? "same codes" : "CODES DIFFER") +
+                     (unvisitedNextCount == 0 ? ""
+                                              : ", " + std::to_string(unvisitedNextCount) + " UNVISITED NEXT CELLS"));
+        }
+
+        // The line of sight pass, cleared afterwards so the agents below follow the vector field everywhere
+        {
+            const Measure sightMeasure = measure(repeat, [&] { field.computeLineOfSight(); });
+            int reachableCount = 0;
+            int sightCount = 0;
+            for (int i = 0; i < field.getCellCount(); i++)
+            {
+                if (field.isObstacle(i) || field.getCostDistance(i) == FlowField::Unvisited) continue;
+
+                reachableCount++;
+                if (field.hasLineOfSight(i)) sightCount++;
+            }
+            field.setLineOfSightEnabled(false);
+
+            char share[32];
+            std::snprintf(share, sizeof(share), "%.1f",
+                          reachableCount > 0 ? 100.0 * sightCount / reachableCount : 0.0);
+            printRow(scenario, "sight", sightMeasure, cellCount, std::string(share) + "% of the reachable cells");
+        }
+        printRow(scenario, "calculate", measure(repeat, [&] { field.calculate(); }), cellCount);
+
+        // Frames asking for new fields calculated in the background, until the last one is published. A frame only
+        // copies the map and publishes, the superseded requests are cancelled by the worker.
+        {
+            AsyncFlowField asyncField(size, size, CellSize);
+            double longestFrameMilliseconds = 0;
+            const Measure asyncMeasure = measure(1, [&]
+            {
+                const int requestFrameCount = AsyncRequestCount * AsyncFramesPerRequest;
+                for (int frame = 0; frame < requestFrameCount || asyncField.isBusy(); frame++)
+                {
+                    const auto frameStart = Clock::now();
+                    if (frame < requestFrameCount && frame % AsyncFramesPerRequest == 0)
+                    {
+                        asyncField.request(field, goal, scenario.integrator);
+                    }
+                    asyncField.publish();
+
+                    const double frameMilliseconds =
+                        std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+                    longestFrameMilliseconds = std::max(longestFrameMilliseconds, frameMilliseconds);
+
+                    std::this_thread::sleep_for(AsyncFrameInterval);
+                }
+            });
+            printRow(scenario, "async", asyncMeasure, AsyncRequestCount,
+                     std::to_string(asyncField.getCompletedCount()) + " completed, " +
+                     std::to_string(asyncField.getCancelledCount()) + " cancelled, longest frame " +
+                     std::to_string(static_cast<long long>(longestFrameMilliseconds * 1000)) + " us");
+        }
+
+        // Vertices of the heatmap, grid lines and arrows, one draw call per layer
+        GridMesh mesh(size, size, CellSize);
+        const Measure meshMeasure = measure(repeat, [&] { mesh.update(field); });
+        printRow(scenario, "mesh", meshMeasure, cellCount,
+                 std::to_string(mesh.getQuadVertices().size() + mesh.getLineVertices().size() +
+                     mesh.getArrowVertices().size()) + " vertices in 3 layers");
+
+        // Toggle obstacles on random cells, each toggle is undone right after so the map does not drift. The dirty
+        // cells are the ones the game refreshes after each toggle.
+        const std::vector<int> toggledCells = pickReachableCells(field, options.repairCount);
+        long long repairedCellCount = 0;
+        long long dirtyCellCount = 0;
+        field.setDirtyTracking(true);
+        const Measure repairMeasure = measure(1, [&]
+        {
+            for (const int cell : toggledCells)
+            {
+                for (const bool isObstacle : {true, false})
+                {
+                    repairedCellCount += field.updateObstacle(cell % size, cell / size, isObstacle);
+                    dirtyCellCount += static_cast<long long>(field.getDirtyCells().size());
+                    field.clearDirtyCells();
+                }
+            }
+        });
+        field.setDirtyTracking(false);
+        const double toggleCount = std::max(1.0, 2.0 * static_cast<double>(toggledCells.size()));
+        printRow(scenario, "repair", repairMeasure, toggleCount,
+                 std::to_string(static_cast<long long>(repairedCellCount / toggleCount)) + " cells/toggle, " +
+                 std::to_string(static_cast<long long>(dirtyCellCount / toggleCount)) + " dirty");
+
+        const std::vector<int> starts = pickReachableCells(field, options.pathCount);
+        long long steps = 0;
+        const Measure pathMeasure = measure(repeat, [&] { steps = walkPaths(field, starts); });
+        printRow(scenario, "path", pathMeasure, static_cast<double>(steps));
+
+        // Same paths in one batch, each cell walked once, then pulled tight
+        PathExtractor extractor(field);
+        extractor.extract(starts);
+        const Measure batchMeasure = measure(repeat, [&] { extractor.extract(starts); });
+        printRow(scenario, "paths", batchMeasure, static_cast<double>(steps),
+                 std::to_string(extractor.getWalkedCellCount()) + " cells walked");
+
+        long long waypointCount = 0;
+        extractor.smoothPaths();
+        const Measure smoothMeasure = measure(repeat, [&] { extractor.smoothPaths(); });
+        for (int path = 0; path < extractor.getPathCount(); path++)
+        {
+            waypointCount += extractor.getWaypointCount(path);
+        }
+        printRow(scenario, "waypoints", smoothMeasure, static_cast<double>(extractor.getPathCount()),
+                 std::to_string(waypointCount / std::max(1, extractor.getPathCount())) + " waypoints/path, " +
+                 std::to_string(steps / std::max(1, extractor.getPathCount())) + " steps/path");
+
+        // Sectors only use the terrain costs of the weighted integrator, compare with its full calculation above
+        if (scenario.integrator == FlowField::Integrator::Weighted && !starts.empty())
+        {
+            HierarchicalFlowField sectors(field, options.sectorSize);
+            const Measure buildMeasure = measure(repeat, [&] { sectors.build(); });
+            printRow(scenario, "sectors", buildMeasure, cellCount,
+                     std::to_string(sectors.getRegionCount()) + " regions, " +
+                     std::to_string(sectors.getPortalCount()) + " portals");
+
+            // One group of agents, then agents spread over the whole map, without any field cached
+            const int goalX = goal % size;
+            const int goalY = goal / size;
+            const std::vector<int> group(1, starts.front());
+            for (const auto& [phase, routeStarts] : {std::make_pair("route", &group), std::make_pair("route all", &starts)})
+            {
+                const Measure routeMeasure = measure(repeat, [&]
+                {
+                    sectors.clearSectorFields();
+                    sectors.calculate(goalX, goalY, *routeStarts);
+                });
+                printRow(scenario, phase, routeMeasure, cellCount,
+                         std::to_string(sectors.getRouteFieldCount()) + " of " +
+                         std::to_string(sectors.getRegionCount()) + " regions");
+            }
+
+            long long routeSteps = 0;
+            const Measure routePathMeasure = measure(repeat, [&] { routeSteps = walkPaths(sectors, starts); });
+
+            // Every start the full field reaches must be routed to the goal
+            int unroutedCount = 0;
+            for (const int start : starts)
+            {
+                if (field.getIntegration(start) == FlowField::Unvisited) continue;
+
+                int current = start;
+                for (int next = sectors.getNextIndex(current); next != -1; next = sectors.getNextIndex(current))
+                {
+                    current = next;
+                }
+                if (current != goal) unroutedCount++;
+            }
+            printRow(scenario, "route path", routePathMeasure, static_cast<double>(routeSteps),
+                     std::to_string(routeSteps * 100 / std::max(1LL, steps)) + "% of the steps of path, " +
+                     (unroutedCount == 0
+                          ? std::string("every start routed")
+                          : std::to_string(unroutedCount) + " STARTS NOT ROUTED"));
+
+            // Another goal, its routes share some portals with the previous ones
+            const int otherGoal = starts[starts.size() / 2];
+            const Measure reuseMeasure = measure(1, [&]
+            {
+                sectors.calculate(otherGoal % size, otherGoal / size, starts);
+            });
+            printRow(scenario, "route reuse", reuseMeasure, cellCount,
+                     std::to_string(sectors.getBuiltFieldCount()) + " of " +
+                     std::to_string(sectors.getRouteFieldCount()) + " fields built");
+        }
+
+        // Same crowd updated on the calling thread only, then on the thread pool, both must end at the same positions
+        const std::vector<int> agentCells = pickReachableCells(field, options.agentCount);
+        const double agentUpdateCount = static_cast<double>(agentCells.size()) * options.agentTicks;
+        AgentStore serialAgents = spawnAgents(field, agentCells);
+        AgentStore pooledAgents = spawnAgents(field, agentCells);
+        for (AgentStore* agents : {&serialAgents, &pooledAgents})
+        {
+            ThreadPool* agentPool = agents == &pooledAgents ? &pool : nullptr;
+            const Measure agentMeasure = measure(1, [&]
+            {
+                for (int tick = 0; tick < options.agentTicks; tick++)
+                {
+                    agents->update(field, TimeStep, agentPool);
+                }
+            });
+
+            std::string notes = std::to_string(static_cast<long long>(agentUpdateCount /
+                std::max(1e-6, agentMeasure.bestMilliseconds))) + " agents/ms";
+            if (agentPool != nullptr)
+            {
+                const bool isDeterministic = pooledAgents.getPositionsX() == serialAgents.getPositionsX() &&
+                    pooledAgents.getPositionsY() == serialAgents.getPositionsY();
+                notes += ", " + std::to_string(pool.getThreadCount()) + " threads, " +
+                    (isDeterministic ? "same positions" : "POSITIONS DIFFER");
+            }
+            printRow(scenario, agentPool != nullptr ? "agents" : "agents 1t", agentMeasure, agentUpdateCount, notes);
+        }
+
+        // Same crowd pushing its agents apart, the neighbours are found with the spatial grid built every tick
+        AgentStore separatedAgents = spawnAgents(field, agentCells);
+        separatedAgents.setSeparation(CellSize / 2, 1.f);
+        const Measure separationMeasure = measure(1, [&]
+        {
+            for (int tick = 0; tick < options.agentTicks; tick++)
+            {
+                separatedAgents.update(field, TimeStep, &pool);
+            }
+        });
+        printRow(scenario, "separation", separationMeasure, agentUpdateCount,
+                 std::to_string(static_cast<long long>(agentUpdateCount /
+                     std::max(1e-6, separationMeasure.bestMilliseconds))) + " agents/ms");
+
+        // Groups of agents going to a few recurring goals, the goal of the field changes from here
+        const std::vector<int> goals = pickReachableCells(field, options.cacheGoalCount);
+        if (goals.empty()) return;
+
+        FlowFieldCache cache(field, std::numeric_limits<std::size_t>::max());
+        const Measure missMeasure = measure(1, [&]
+        {
+            for (const int cacheGoal : goals) cache.get(cacheGoal % size, cacheGoal / size);
+        });
+        const std::size_t uncompressedSize = field.getDirectionCodes().size();
+        printRow(scenario, "cache miss", missMeasure, static_cast<double>(goals.size()),
+                 std::to_string(cache.getMemoryUsage() / 1024) + " KiB for " +
+                 std::to_string(cache.getFieldCount()) + " fields, " +
+                 std::to_string(uncompressedSize / 1024) + " KiB per uncompressed field");
+
+        std::mt19937 random(Seed);
+        std::vector<int> lookups;
+        lookups.reserve(options.cacheLookupCount);
+        for (int i = 0; i < options.cacheLookupCount; i++) lookups.push_back(goals[random() % goals.size()]);
+
+        const Measure hitMeasure = measure(repeat, [&]
+        {
+            for (const int cacheGoal : lookups) cache.get(cacheGoal % size, cacheGoal / size);
+        });
+        printRow(scenario, "cache hit", hitMeasure, static_cast<double>(lookups.size()),
+                 std::to_string(cache.getMissCount()) + " misses");
+
+        // The field of the first goal packed row by row then in tiles, the same paths walked on both
+        field.setGoal(goals[0] % size, goals[0] / size);
+        field.calculate();
+        long long rowMajorSteps = 0;
+        double rowMajorMilliseconds = 0;
+        for (const auto layout : {CompactFlowField::Layout::RowMajor, CompactFlowField::Layout::Tiled})
+        {
+            const CompactFlowField compactField(field, layout);
+            long long compactSteps = 0;
+            const Measure compactMeasure = measure(repeat, [&] { compactSteps = walkPaths(compactField, starts); });
+
+            if (layout == CompactFlowField::Layout::RowMajor)
+            {
+                rowMajorSteps = compactSteps;
+                rowMajorMilliseconds = compactMeasure.bestMilliseconds;
+                printRow(scenario, "compact path", compactMeasure, static_cast<double>(compactSteps));
+                continue;
+            }
+
+            char speedup[32];
+            std::snprintf(speedup, sizeof(speedup), "%.2f", rowMajorMilliseconds / compactMeasure.bestMilliseconds);
+            printRow(scenario, "tiled path", compactMeasure, static_cast<double>(compactSteps),
+                     std::string(speedup) + "x faster, " +
+                     (compactSteps == rowMajorSteps ? "same paths" : "PATHS DIFFER"));
+        }
+
+        // The map and the fields of the same goals saved to a file, then read back in place
+        const std::string mapFilePath = "FlowFieldBenchmark.flowmap";
+        bool isSaved = false;
+        const Measure saveMeasure = measure(1, [&] { isSaved = MapFile::save(mapFilePath, field, goals); });
+        MapFile mapFile;
+        if (isSaved && mapFile.open(mapFilePath))
+        {
+            printRow(scenario, "file save", saveMeasure, static_cast<double>(goals.size()),
+                     std::to_string(mapFile.getSize() / 1024) + " KiB for " +
+                     std::to_string(mapFile.getFieldCount()) + " fields");
+
+            const Measure openMeasure = measure(repeat, [&] { mapFile.open(mapFilePath); });
+            printRow(scenario, "file open", openMeasure, cellCount);
+
+            FlowField loaded(size, size, CellSize);
+            const Measure loadMeasure = measure(1, [&] { mapFile.loadMap(loaded); });
+            bool isSameMap = true;
+            for (int cell = 0; cell < field.getCellCount() && isSameMap; cell++)
+            {
+                isSameMap = loaded.isObstacle(cell) == field.isObstacle(cell) &&
+                    loaded.getTerrainCost(cell) == field.getTerrainCost(cell);
+            }
+            printRow(scenario, "file load", loadMeasure, cellCount, isSameMap ? "same map" : "MAPS DIFFER");
+
+            // Paths walked straight on the mapped field of the first goal, compared to its cached field
+            const MapFile::Field fileField = mapFile.getField(mapFile.findField(goals[0], scenario.integrator));
+            long long fileSteps = 0;
+            const Measure filePathMeasure = measure(repeat, [&] { fileSteps = walkPaths(fileField, starts); });
+            const long long cacheSteps = walkPaths(*cache.get(goals[0] % size, goals[0] / size), starts);
+            printRow(scenario, "file path", filePathMeasure, static_cast<double>(fileSteps),
+                     fileSteps == cacheSteps ? "same paths" : "PATHS DIFFER");
+
+            mapFile.close();
+        }
+        std::remove(mapFilePath.c_str());
+
+        // Fields of many goals at once, by a single worker then by one worker per thread
+        std::vector<FlowFieldJobs::Request> jobRequests;
+        for (const int jobGoal : pickReachableCells(field, options.jobGoalCount))
+        {
+            jobRequests.push_back({jobGoal, scenario.integrator});
+        }
+
+        std::vector<FlowFieldJobs::Result> serialFields;
+        double serialMilliseconds = 0;
+        for (const bool isParallel : {false, true})
+        {
+            FlowFieldJobs jobs(isParallel ? options.threadCount : 1);
+            std::vector<FlowFieldJobs::Result> fields;
+            const Measure jobMeasure = measure(1, [&]
+            {
+                fields.clear();
+                for (auto& future : jobs.submit(field, jobRequests)) fields.push_back(future.get());
+            });
+
+            if (!isParallel)
+            {
+                serialFields = fields;
+                serialMilliseconds = jobMeasure.bestMilliseconds;
+                printRow(scenario, "jobs 1t", jobMeasure, static_cast<double>(jobRequests.size()));
+                continue;
+            }
+
+            bool isDeterministic = fields.size() == serialFields.size();
+            for (size_t i = 0; i < fields.size() && isDeterministic; i++)
+            {
+                for (int cell = 0; cell < field.getCellCount() && isDeterministic; cell++)
+                {
+                    isDeterministic = fields[i]->getDirectionCode(cell) == serialFields[i]->getDirectionCode(cell);
+                }
+            }
+
+            char speedup[32];
+            std::snprintf(speedup, sizeof(speedup), "%.2f", serialMilliseconds / jobMeasure.bestMilliseconds);
+            printRow(scenario, "jobs", jobMeasure, static_cast<double>(jobRequests.size()),
+                     std::to_string(jobs.getWorkerCount()) + " workers, " +
+                     std::to_string(jobs.getStolenJobCount()) + " stolen, " + speedup + "x faster, " +
+                     (isDeterministic ? "same fields" : "FIELDS DIFFER"));
+        }
+    }
+
+    std::vector<std::string> split(const std::string& text)
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= text.size())
+        {
+            const size_t end = std::min(text.find(',', start), text.size());
+            if (end > start) parts.push_back(text.substr(start, end - start));
+            start = end + 1;
+        }
+
+        return parts;
+    }
+
+    void printUsage(const char* program)
+    {
+        std::printf("Usage: %s [--sizes 50,256,...] [--maps open,maze,rooms,random] [--integrators bfs,weighted,eikonal]"
+                    " [--repeat N]"
+                    " [--paths N] [--agents N] [--ticks N] [--repairs N] [--goals N] [--lookups N] [--jobs N]"
+                    " [--sector-size N] [--threads N]\n", program);
+    }
+
+    bool parseOptions(const int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string argument = argv[i];
+            if (argument == "--help" || i + 1 >= argc) return false;
+
+            const std::string value = argv[++i];
+            if (argument == "--sizes")
+            {
+                options.sizes.clear();
+                for (const auto& size : split(value)) options.sizes.push_back(std::atoi(size.c_str()));
+            }
+            else if (argument == "--maps")
+            {
+                options.maps.clear();
+                for (const auto& name : split(value))
+                {
+                    MapType map;
+                    if (!MapGenerator::parse(name, map)) return false;
+                    options.maps.push_back(map);
+                }
+            }
+            else if (argument == "--integrators")
+            {
+                options.integrators.clear();
+                for (const auto& name : split(value))
+                {
+                    FlowField::Integrator integrator;
+                    if (!parseIntegrator(name, integrator)) return false;
+                    options.integrators.push_back(integrator);
+                }
+            }
+            else if (argument == "--repeat") options.repeat = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--paths") options.pathCount = std::atoi(value.c_str());
+            else if (argument == "--agents") options.agentCount = std::atoi(value.c_str());
+            else if (argument == "--ticks") options.agentTicks = std::atoi(value.c_str());
+            else if (argument == "--repairs") options.repairCount = std::atoi(value.c_str());
+            else if (argument == "--goals") options.cacheGoalCount = std::atoi(value.c_str());
+            else if (argument == "--lookups") options.cacheLookupCount = std::atoi(value.c_str());
+            else if (argument == "--jobs") options.jobGoalCount = std::atoi(value.c_str());
+            else if (argument == "--sector-size") options.sectorSize = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--threads") options.threadCount = std::max(1, std::atoi(value.c_str()));
+            else return false;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Started once, like in the game
+    ThreadPool pool(options.threadCount - 1);
+
+    printHeader();
+    for (const int size : options.sizes)
+    {
+        for (const MapType map : options.maps)
+        {
+            for (const FlowField::Integrator integrator : options.integrators)
+            {
+                runBenchmark({size, map, integrator}, options, pool);
+            }
+        }
+    }
+
+    return 0;
+}
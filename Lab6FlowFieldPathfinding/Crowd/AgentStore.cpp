@@ -0,0 +1,393 @@
+#include "AgentStore.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include "ThreadPool.hpp"
+#include "../FlowField/FlowField.hpp"
+#include "../Profiling/Profiler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LAB6FLOWFIELD_AGENTSTORE_SSE2
+#endif
+
+namespace
+{
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+    constexpr float RadiansToDegrees = 180.f / 3.14159265358979323846f;
+
+    // Agents updated by one task of the thread pool, a multiple of the SIMD width so that the grouping of the agents
+    // does not depend on the number of threads
+    constexpr int AgentsPerTask = 2048;
+
+    constexpr int LaneCount = 4;
+}
+
+AgentStore::AgentStore(const float maxSpeed, const float maxForce) :
+    m_maxSpeed(maxSpeed),
+    m_maxForce(maxForce),
+    m_left(-Infinity),
+    m_top(-Infinity),
+    m_right(Infinity),
+    m_bottom(Infinity),
+    m_separationRadius(0),
+    m_separationStrength(0)
+{
+}
+
+int AgentStore::add(const float x, const float y)
+{
+    m_positionX.push_back(x);
+    m_positionY.push_back(y);
+    m_velocityX.push_back(0);
+    m_velocityY.push_back(0);
+    m_separationX.push_back(0);
+    m_separationY.push_back(0);
+
+    return static_cast<int>(m_positionX.size()) - 1;
+}
+
+void AgentStore::clear()
+{
+    m_positionX.clear();
+    m_positionY.clear();
+    m_velocityX.clear();
+    m_velocityY.clear();
+    m_separationX.clear();
+    m_separationY.clear();
+}
+
+void AgentStore::reserve(const int count)
+{
+    m_positionX.reserve(count);
+    m_positionY.reserve(count);
+    m_velocityX.reserve(count);
+    m_velocityY.reserve(count);
+    m_separationX.reserve(count);
+    m_separationY.reserve(count);
+}
+
+int AgentStore::size() const
+{
+    return static_cast<int>(m_positionX.size());
+}
+
+void AgentStore::setBounds(const float left, const float top, const float right, const float bottom)
+{
+    m_left = left;
+    m_top = top;
+    m_right = right;
+    m_bottom = bottom;
+}
+
+void AgentStore::setSeparation(const float radius, const float strength)
+{
+    m_separationRadius = std::max(0.f, radius);
+    m_separationStrength = strength;
+
+    if (m_separationRadius == 0)
+    {
+        std::fill(m_separationX.begin(), m_separationX.end(), 0.f);
+        std::fill(m_separationY.begin(), m_separationY.end(), 0.f);
+    }
+}
+
+float AgentStore::getSeparationRadius() const
+{
+    return m_separationRadius;
+}
+
+const SpatialGrid& AgentStore::getNeighbours() const
+{
+    return m_neighbours;
+}
+
+void AgentStore::update(const FlowField& field, const float dt, ThreadPool* pool)
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("AgentStore::update");
+
+    const int agentCount = size();
+
+    // Snapshot of the positions before any agent moves, so the order the chunks run in does not matter
+    if (m_separationRadius > 0)
+    {
+        m_neighbours.build(field.getWidth(), field.getHeight(), field.getCellSize(), m_positionX, m_positionY);
+    }
+
+    if (pool == nullptr || agentCount <= AgentsPerTask)
+    {
+        updateRange(field, dt, 0, agentCount);
+        return;
+    }
+
+    const int taskCount = (agentCount + AgentsPerTask - 1) / AgentsPerTask;
+    const auto updateTask = [this, &field, dt, agentCount](const int task)
+    {
+        const int begin = task * AgentsPerTask;
+        updateRange(field, dt, begin, std::min(begin + AgentsPerTask, agentCount));
+    };
+
+    // Passed by reference, the captures do not fit in a std::function without an allocation every frame
+    pool->run(taskCount, std::cref(updateTask));
+}
+
+void AgentStore::setPosition(const int index, const float x, const float y)
+{
+    m_positionX[index] = x;
+    m_positionY[index] = y;
+}
+
+float AgentStore::getPositionX(const int index) const
+{
+    return m_positionX[index];
+}
+
+float AgentStore::getPositionY(const int index) const
+{
+    return m_positionY[index];
+}
+
+float AgentStore::getVelocityX(const int index) const
+{
+    return m_velocityX[index];
+}
+
+float AgentStore::getVelocityY(const int index) const
+{
+    return m_velocityY[index];
+}
+
+float AgentStore::getRotation(const int index) const
+{
+    return std::atan2(m_velocityY[index], m_velocityX[index]) * RadiansToDegrees;
+}
+
+const std::vector<float>& AgentStore::getPositionsX() const
+{
+    return m_positionX;
+}
+
+const std::vector<float>& AgentStore::getPositionsY() const
+{
+    return m_positionY;
+}
+
+void AgentStore::updateRange(const FlowField& field, const float dt, const int begin, const int end)
+{
+    if (m_separationRadius > 0)
+    {
+        for (int agent = begin; agent < end; agent++)
+        {
+            computeSeparation(agent);
+        }
+    }
+
+    int i = begin;
+
+#ifdef LAB6FLOWFIELD_AGENTSTORE_SSE2
+    const float cellSize = field.getCellSize();
+    const int width = field.getWidth();
+    const int height = field.getHeight();
+    const std::uint8_t* codes = field.getDirectionCodes().data();
+    const std::uint8_t* lineOfSight = field.getLineOfSight().data();
+    const auto goalX = static_cast<float>(field.getGoalIndex() % width);
+    const auto goalY = static_cast<float>(field.getGoalIndex() / width);
+
+    const auto isInside = [width, height](const int cellX, const int cellY)
+    {
+        return cellX >= 0 && cellX < width && cellY >= 0 && cellY < height;
+    };
+
+    const __m128 halfSizes = _mm_set1_ps(cellSize / 2);
+    const __m128 cellSizes = _mm_set1_ps(cellSize);
+    const __m128 ones = _mm_set1_ps(1);
+    const __m128 zeros = _mm_setzero_ps();
+    const __m128 maxSpeeds = _mm_set1_ps(m_maxSpeed);
+    const __m128 forceFactors = _mm_set1_ps(m_maxForce / m_maxSpeed);
+    const __m128 dts = _mm_set1_ps(dt);
+    const __m128 lefts = _mm_set1_ps(m_left);
+    const __m128 tops = _mm_set1_ps(m_top);
+    const __m128 rights = _mm_set1_ps(m_right);
+    const __m128 bottoms = _mm_set1_ps(m_bottom);
+
+    for (; i + LaneCount <= end; i += LaneCount)
+    {
+        __m128 positionX = _mm_loadu_ps(&m_positionX[i]);
+        __m128 positionY = _mm_loadu_ps(&m_positionY[i]);
+        __m128 velocityX = _mm_loadu_ps(&m_velocityX[i]);
+        __m128 velocityY = _mm_loadu_ps(&m_velocityY[i]);
+
+        alignas(16) float gridX[LaneCount];
+        alignas(16) float gridY[LaneCount];
+        _mm_store_ps(gridX, _mm_div_ps(_mm_sub_ps(positionX, halfSizes), cellSizes));
+        _mm_store_ps(gridY, _mm_div_ps(_mm_sub_ps(positionY, halfSizes), cellSizes));
+
+        // Gather the 4 cells around each agent, one lane at a time, like FlowField::sampleDirections()
+        alignas(16) float f00X[LaneCount], f00Y[LaneCount], f01X[LaneCount], f01Y[LaneCount];
+        alignas(16) float f10X[LaneCount], f10Y[LaneCount], f11X[LaneCount], f11Y[LaneCount];
+        alignas(16) float xWeights[LaneCount], yWeights[LaneCount];
+        // Direction to the goal of the agents in line of sight of it, which skip the gather
+        alignas(16) float goalDirectionX[LaneCount], goalDirectionY[LaneCount];
+        alignas(16) std::int32_t isInSight[LaneCount];
+        for (int lane = 0; lane < LaneCount; lane++)
+        {
+            const int x = static_cast<int>(std::round(gridX[lane]));
+            const int y = static_cast<int>(std::round(gridY[lane]));
+
+            FlowField::Direction f00{0, 0}, f01{0, 0}, f10{0, 0}, f11{0, 0};
+            float xWeight = 0;
+            float yWeight = 0;
+            isInSight[lane] = isInside(x, y) && lineOfSight[x + width * y] ? -1 : 0;
+            goalDirectionX[lane] = goalX - gridX[lane];
+            goalDirectionY[lane] = goalY - gridY[lane];
+            if (isInside(x, y) && !isInSight[lane])
+            {
+                const int index = x + width * y;
+                f00 = FlowField::decodeDirection(codes[index]);
+                f01 = isInside(x, y + 1) ? FlowField::decodeDirection(codes[index + width])
+                                         : FlowField::Direction{0, -1};
+                f10 = isInside(x + 1, y) ? FlowField::decodeDirection(codes[index + 1]) : FlowField::Direction{-1, 0};
+                f11 = isInside(x + 1, y + 1) ? FlowField::decodeDirection(codes[index + width + 1])
+                                             : FlowField::Direction{1, 1};
+                xWeight = gridX[lane] - static_cast<float>(x);
+                yWeight = gridY[lane] - static_cast<float>(y);
+            }
+
+            f00X[lane] = f00.x;
+            f00Y[lane] = f00.y;
+            f01X[lane] = f01.x;
+            f01Y[lane] = f01.y;
+            f10X[lane] = f10.x;
+            f10Y[lane] = f10.y;
+            f11X[lane] = f11.x;
+            f11Y[lane] = f11.y;
+            xWeights[lane] = xWeight;
+            yWeights[lane] = yWeight;
+        }
+
+        const __m128 xWeight = _mm_load_ps(xWeights);
+        const __m128 yWeight = _mm_load_ps(yWeights);
+        const __m128 xComplement = _mm_sub_ps(ones, xWeight);
+        const __m128 yComplement = _mm_sub_ps(ones, yWeight);
+
+        const __m128 topX = _mm_add_ps(_mm_mul_ps(_mm_load_ps(f00X), xComplement),
+                                       _mm_mul_ps(_mm_load_ps(f10X), xWeight));
+        const __m128 topY = _mm_add_ps(_mm_mul_ps(_mm_load_ps(f00Y), xComplement),
+                                       _mm_mul_ps(_mm_load_ps(f10Y), xWeight));
+        const __m128 bottomX = _mm_add_ps(_mm_mul_ps(_mm_load_ps(f01X), xComplement),
+                                          _mm_mul_ps(_mm_load_ps(f11X), xWeight));
+        const __m128 bottomY = _mm_add_ps(_mm_mul_ps(_mm_load_ps(f01Y), xComplement),
+                                          _mm_mul_ps(_mm_load_ps(f11Y), xWeight));
+        const __m128 interpolatedX = _mm_add_ps(_mm_mul_ps(topX, yComplement), _mm_mul_ps(bottomX, yWeight));
+        const __m128 interpolatedY = _mm_add_ps(_mm_mul_ps(topY, yComplement), _mm_mul_ps(bottomY, yWeight));
+
+        // Same direction as FlowField::getSteeringDirection()
+        const __m128 inSight = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(isInSight)));
+        const __m128 sampleX = _mm_or_ps(_mm_and_ps(inSight, _mm_load_ps(goalDirectionX)),
+                                         _mm_andnot_ps(inSight, interpolatedX));
+        const __m128 sampleY = _mm_or_ps(_mm_and_ps(inSight, _mm_load_ps(goalDirectionY)),
+                                         _mm_andnot_ps(inSight, interpolatedY));
+
+        // Steering force, only for the agents with a direction to follow
+        const __m128 sampleLength = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(sampleX, sampleX),
+                                                           _mm_mul_ps(sampleY, sampleY)));
+        const __m128 hasDirection = _mm_cmpgt_ps(sampleLength, zeros);
+        const __m128 desiredX = _mm_mul_ps(_mm_div_ps(sampleX, sampleLength), maxSpeeds);
+        const __m128 desiredY = _mm_mul_ps(_mm_div_ps(sampleY, sampleLength), maxSpeeds);
+        const __m128 forceX = _mm_add_ps(_mm_and_ps(hasDirection, _mm_mul_ps(_mm_sub_ps(desiredX, velocityX),
+                                                                          forceFactors)),
+                                         _mm_loadu_ps(&m_separationX[i]));
+        const __m128 forceY = _mm_add_ps(_mm_and_ps(hasDirection, _mm_mul_ps(_mm_sub_ps(desiredY, velocityY),
+                                                                          forceFactors)),
+                                         _mm_loadu_ps(&m_separationY[i]));
+
+        velocityX = _mm_add_ps(velocityX, _mm_mul_ps(forceX, dts));
+        velocityY = _mm_add_ps(velocityY, _mm_mul_ps(forceY, dts));
+
+        const __m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(velocityX, velocityX),
+                                                    _mm_mul_ps(velocityY, velocityY)));
+        const __m128 isTooFast = _mm_cmpgt_ps(speed, maxSpeeds);
+        const __m128 speedScale = _mm_div_ps(maxSpeeds, speed);
+        velocityX = _mm_or_ps(_mm_and_ps(isTooFast, _mm_mul_ps(velocityX, speedScale)),
+                              _mm_andnot_ps(isTooFast, velocityX));
+        velocityY = _mm_or_ps(_mm_and_ps(isTooFast, _mm_mul_ps(velocityY, speedScale)),
+                              _mm_andnot_ps(isTooFast, velocityY));
+
+        // Operands in the order of std::max/std::min so equal values and NaN give the same result as the scalar path
+        positionX = _mm_add_ps(positionX, _mm_mul_ps(velocityX, dts));
+        positionY = _mm_add_ps(positionY, _mm_mul_ps(velocityY, dts));
+        positionX = _mm_min_ps(rights, _mm_max_ps(lefts, positionX));
+        positionY = _mm_min_ps(bottoms, _mm_max_ps(tops, positionY));
+
+        _mm_storeu_ps(&m_positionX[i], positionX);
+        _mm_storeu_ps(&m_positionY[i], positionY);
+        _mm_storeu_ps(&m_velocityX[i], velocityX);
+        _mm_storeu_ps(&m_velocityY[i], velocityY);
+    }
+#endif
+
+    for (; i < end; i++)
+    {
+        updateAgent(field, dt, i);
+    }
+}
+
+void AgentStore::computeSeparation(const int index)
+{
+    const SpatialGrid::Separation separation = m_neighbours.getSeparation(
+        m_positionX[index], m_positionY[index], m_separationRadius, index);
+
+    float forceX = separation.x * m_separationStrength * m_maxForce;
+    float forceY = separation.y * m_separationStrength * m_maxForce;
+
+    const float force = std::sqrt(forceX * forceX + forceY * forceY);
+    if (force > m_maxForce)
+    {
+        forceX *= m_maxForce / force;
+        forceY *= m_maxForce / force;
+    }
+
+    m_separationX[index] = forceX;
+    m_separationY[index] = forceY;
+}
+
+void AgentStore::updateAgent(const FlowField& field, const float dt, const int index)
+{
+    const float cellSize = field.getCellSize();
+    const float halfSize = cellSize / 2;
+
+    const FlowField::Direction sample = field.getSteeringDirection((m_positionX[index] - halfSize) / cellSize,
+                                                                   (m_positionY[index] - halfSize) / cellSize);
+
+    float forceX = 0;
+    float forceY = 0;
+    const float sampleLength = std::sqrt(sample.x * sample.x + sample.y * sample.y);
+    if (sampleLength > 0)
+    {
+        const float desiredX = sample.x / sampleLength * m_maxSpeed;
+        const float desiredY = sample.y / sampleLength * m_maxSpeed;
+        forceX = (desiredX - m_velocityX[index]) * (m_maxForce / m_maxSpeed);
+        forceY = (desiredY - m_velocityY[index]) * (m_maxForce / m_maxSpeed);
+    }
+
+    forceX += m_separationX[index];
+    forceY += m_separationY[index];
+
+    float velocityX = m_velocityX[index] + forceX * dt;
+    float velocityY = m_velocityY[index] + forceY * dt;
+
+    const float speed = std::sqrt(velocityX * velocityX + velocityY * velocityY);
+    if (speed > m_maxSpeed)
+    {
+        velocityX *= m_maxSpeed / speed;
+        velocityY *= m_maxSpeed / speed;
+    }
+
+    m_velocityX[index] = velocityX;
+    m_velocityY[index] = velocityY;
+    m_positionX[index] = std::min(std::max(m_positionX[index] + velocityX * dt, m_left), m_right);
+    m_positionY[index] = std::min(std::max(m_positionY[index] + velocityY * dt, m_top), m_bottom);
+}
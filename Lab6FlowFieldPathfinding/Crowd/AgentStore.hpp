@@ -0,0 +1,116 @@
+#ifndef LAB6FLOWFIELD_AGENTSTORE_HPP
+#define LAB6FLOWFIELD_AGENTSTORE_HPP
+
+#include <vector>
+
+#include "SpatialGrid.hpp"
+
+class FlowField;
+class ThreadPool;
+
+/**
+ * \brief Crowd of agents following a flow field, stored as one array per component
+ * \details update() moves every agent like Agent::update() does for a single one: bilinear sample of the vector field
+ * at its position (or the direction to the goal when it sees it, see FlowField::getSteeringDirection()), steering force
+ * toward the sampled direction, integration. Agents are processed by chunks spread over a thread pool, 4 at a time with
+ * SSE2 when available. Each agent only depends on its own values and on positions from before the update, and the SIMD
+ * path does the same float operations in the same order as the scalar one, so the positions after an update are the
+ * same bit for bit whatever the number of threads or the instruction set.
+ *
+ * With separation enabled, the agents also push each other away so a crowd does not collapse on the same cells. The
+ * neighbours come from a SpatialGrid built on the cells of the flow field at the start of each update, so the cost of
+ * an update stays linear in the number of agents instead of comparing every pair.
+ *
+ * The rotation of an agent is not stored, getRotation() computes it from its velocity when it is drawn.
+ */
+class AgentStore
+{
+public:
+    AgentStore(float maxSpeed, float maxForce);
+
+    /**
+     * \brief Add an agent at rest
+     * \return index of the agent
+     */
+    int add(float x, float y);
+    void clear();
+    void reserve(int count);
+
+    int size() const;
+
+    /**
+     * \brief Rectangle the agents are kept in, in world coordinates
+     */
+    void setBounds(float left, float top, float right, float bottom);
+
+    /**
+     * \brief Push the agents away from the neighbours closer than radius, disabled when radius is 0
+     * \param strength force of the push from a neighbour on the same position, relative to the max force
+     */
+    void setSeparation(float radius, float strength);
+    float getSeparationRadius() const;
+
+    /**
+     * \brief Positions of the agents at the start of the last update, only built when separation is enabled
+     */
+    const SpatialGrid& getNeighbours() const;
+
+    /**
+     * \brief Move every agent along the flow field during dt seconds
+     * \param pool threads to spread the agents over, the update runs on the calling thread only when nullptr
+     */
+    void update(const FlowField& field, float dt, ThreadPool* pool = nullptr);
+
+    void setPosition(int index, float x, float y);
+    float getPositionX(int index) const;
+    float getPositionY(int index) const;
+    float getVelocityX(int index) const;
+    float getVelocityY(int index) const;
+
+    /**
+     * \brief Angle of the velocity of an agent in degrees, like VectorUtils::vectorToAngle()
+     */
+    float getRotation(int index) const;
+
+    const std::vector<float>& getPositionsX() const;
+    const std::vector<float>& getPositionsY() const;
+
+private:
+    /**
+     * \brief Update the agents in [begin, end), 4 at a time when SIMD is available
+     */
+    void updateRange(const FlowField& field, float dt, int begin, int end);
+
+    /**
+     * \brief Force pushing one agent away from its neighbours, no longer than the max force
+     */
+    void computeSeparation(int index);
+
+    /**
+     * \brief Scalar update of one agent, the reference of the SIMD path
+     */
+    void updateAgent(const FlowField& field, float dt, int index);
+
+    float m_maxSpeed;
+    float m_maxForce;
+
+    float m_left;
+    float m_top;
+    float m_right;
+    float m_bottom;
+
+    float m_separationRadius;
+    float m_separationStrength;
+    SpatialGrid m_neighbours;
+
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_velocityX;
+    std::vector<float> m_velocityY;
+    // Separation force of each agent for the current update, 0 when separation is disabled
+    std::vector<float> m_separationX;
+    std::vector<float> m_separationY;
+};
+
+
+#endif //LAB6FLOWFIELD_AGENTSTORE_HPP
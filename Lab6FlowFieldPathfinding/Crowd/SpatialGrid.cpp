@@ -0,0 +1,98 @@
+#include "SpatialGrid.hpp"
+
+SpatialGrid::SpatialGrid() :
+    m_width(0),
+    m_height(0),
+    m_cellSize(1)
+{
+}
+
+void SpatialGrid::build(const int width, const int height, const float cellSize, const std::vector<float>& positionX,
+                        const std::vector<float>& positionY)
+{
+    m_width = width;
+    m_height = height;
+    m_cellSize = cellSize;
+
+    const int agentCount = static_cast<int>(positionX.size());
+    const int cellCount = width * height;
+
+    // Count the agents of each cell, shifted by one so the prefix sum gives the start of each cell
+    m_cellStarts.assign(static_cast<size_t>(cellCount) + 1, 0);
+    m_agentCells.resize(agentCount);
+    for (int agent = 0; agent < agentCount; agent++)
+    {
+        const int cell = getCellX(positionX[agent]) + width * getCellY(positionY[agent]);
+        m_agentCells[agent] = cell;
+        m_cellStarts[cell + 1]++;
+    }
+
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        m_cellStarts[cell + 1] += m_cellStarts[cell];
+    }
+
+    // Stable placement, the agents of a cell stay ordered by index. The starts are used as insertion points then
+    // shifted back.
+    m_agents.resize(agentCount);
+    m_positionX.resize(agentCount);
+    m_positionY.resize(agentCount);
+    for (int agent = 0; agent < agentCount; agent++)
+    {
+        const int sorted = m_cellStarts[m_agentCells[agent]]++;
+        m_agents[sorted] = agent;
+        m_positionX[sorted] = positionX[agent];
+        m_positionY[sorted] = positionY[agent];
+    }
+
+    for (int cell = cellCount; cell > 0; cell--)
+    {
+        m_cellStarts[cell] = m_cellStarts[cell - 1];
+    }
+    m_cellStarts[0] = 0;
+}
+
+SpatialGrid::Separation SpatialGrid::getSeparation(const float x, const float y, const float radius,
+                                                   const int excludedAgent) const
+{
+    Separation separation{0, 0};
+    int neighbourCount = 0;
+    const float squaredRadius = radius * radius;
+
+    forEachNeighbour(x, y, radius, [&](const int agent, const float neighbourX, const float neighbourY)
+    {
+        if (agent == excludedAgent) return true;
+
+        const float offsetX = x - neighbourX;
+        const float offsetY = y - neighbourY;
+        const float squaredDistance = offsetX * offsetX + offsetY * offsetY;
+        if (squaredDistance >= squaredRadius) return true;
+
+        if (squaredDistance == 0)
+        {
+            // Agents on the same position, split them along x by index so they do not push the same way
+            separation.x += agent < excludedAgent ? 1.f : -1.f;
+        }
+        else
+        {
+            const float distance = std::sqrt(squaredDistance);
+            const float push = (radius - distance) / radius;
+            separation.x += offsetX / distance * push;
+            separation.y += offsetY / distance * push;
+        }
+
+        return ++neighbourCount < MaxSeparationNeighbours;
+    });
+
+    return separation;
+}
+
+int SpatialGrid::getAgentCount() const
+{
+    return static_cast<int>(m_agents.size());
+}
+
+int SpatialGrid::getCellCount() const
+{
+    return m_width * m_height;
+}
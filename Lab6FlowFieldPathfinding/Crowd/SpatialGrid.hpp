@@ -0,0 +1,111 @@
+#ifndef LAB6FLOWFIELD_SPATIALGRID_HPP
+#define LAB6FLOWFIELD_SPATIALGRID_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * \brief Index of agent positions by cell, the cells being the ones of the flow field
+ * \details build() sorts the agents by cell with a counting sort, in time linear in the number of agents and cells.
+ * The positions are copied in that order, so the agents of a cell are contiguous in memory and the index is a snapshot
+ * which stays valid while the agents move. Agents outside of the grid are put in the closest cell.
+ *
+ * A neighbour query only visits the cells overlapping the query circle. Agents of a cell are visited by increasing
+ * agent index and cells row by row, so the queries are deterministic.
+ */
+class SpatialGrid
+{
+public:
+    struct Separation
+    {
+        float x;
+        float y;
+    };
+
+    // Neighbours taken into account by getSeparation(), so a packed crowd does not cost more per agent
+    static constexpr int MaxSeparationNeighbours = 16;
+
+    SpatialGrid();
+
+    /**
+     * \brief Index the positions of the agents
+     * \param width number of cells of a row, like the flow field
+     * \param cellSize size of a cell in world coordinates, like the flow field
+     */
+    void build(int width, int height, float cellSize, const std::vector<float>& positionX,
+               const std::vector<float>& positionY);
+
+    /**
+     * \brief Call visit(agent, x, y) for each agent in a cell overlapping the circle, not only the ones inside it
+     * \details The visit stops as soon as visit returns false.
+     */
+    template <typename Visitor>
+    void forEachNeighbour(float x, float y, float radius, const Visitor& visit) const;
+
+    /**
+     * \brief Sum of the pushes away from the neighbours closer than radius, each one growing from 0 at radius to 1
+     * when the neighbour is on the position
+     * \param excludedAgent agent at the position, not its own neighbour, -1 if there is none
+     */
+    Separation getSeparation(float x, float y, float radius, int excludedAgent) const;
+
+    int getAgentCount() const;
+    int getCellCount() const;
+
+private:
+    int getCellX(float x) const;
+    int getCellY(float y) const;
+
+    int m_width;
+    int m_height;
+    float m_cellSize;
+
+    // First sorted agent of each cell, with one more entry at the end for the end of the last cell
+    std::vector<int> m_cellStarts;
+
+    // Agents sorted by cell, with their position when the grid was built
+    std::vector<int> m_agents;
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+
+    // Cell of each agent by agent index, only used by build()
+    std::vector<int> m_agentCells;
+};
+
+template <typename Visitor>
+void SpatialGrid::forEachNeighbour(const float x, const float y, const float radius, const Visitor& visit) const
+{
+    if (m_agents.empty()) return;
+
+    const int firstX = getCellX(x - radius);
+    const int lastX = getCellX(x + radius);
+    const int firstY = getCellY(y - radius);
+    const int lastY = getCellY(y + radius);
+
+    for (int cellY = firstY; cellY <= lastY; cellY++)
+    {
+        for (int cellX = firstX; cellX <= lastX; cellX++)
+        {
+            const int cell = cellX + m_width * cellY;
+            for (int sorted = m_cellStarts[cell]; sorted < m_cellStarts[cell + 1]; sorted++)
+            {
+                if (!visit(m_agents[sorted], m_positionX[sorted], m_positionY[sorted])) return;
+            }
+        }
+    }
+}
+
+inline int SpatialGrid::getCellX(const float x) const
+{
+    // Compared as floats first, a position far outside the grid does not fit in an int
+    return static_cast<int>(std::min(std::max(std::floor(x / m_cellSize), 0.f), static_cast<float>(m_width - 1)));
+}
+
+inline int SpatialGrid::getCellY(const float y) const
+{
+    return static_cast<int>(std::min(std::max(std::floor(y / m_cellSize), 0.f), static_cast<float>(m_height - 1)));
+}
+
+
+#endif //LAB6FLOWFIELD_SPATIALGRID_HPP
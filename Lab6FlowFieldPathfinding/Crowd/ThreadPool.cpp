@@ -0,0 +1,114 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+#include "../Profiling/Profiler.hpp"
+
+ThreadPool::ThreadPool(const int workerCount) :
+    m_generation(0),
+    m_isStopping(false),
+    m_busyWorkerCount(0),
+    m_task(nullptr),
+    m_taskCount(0),
+    m_nextTask(0)
+{
+    m_workers.reserve(std::max(0, workerCount));
+    for (int i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(const int taskCount, const std::function<void(int)>& task)
+{
+    if (taskCount <= 0) return;
+
+    // Not worth waking the workers for a single task
+    if (m_workers.empty() || taskCount == 1)
+    {
+        for (int i = 0; i < taskCount; i++) task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_taskCount = taskCount;
+        m_nextTask.store(0, std::memory_order_relaxed);
+        m_busyWorkerCount = static_cast<int>(m_workers.size());
+        m_generation++;
+    }
+    m_wakeCondition.notify_all();
+
+    runTasks();
+
+    // The task must outlive every worker still using it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_busyWorkerCount == 0; });
+    m_task = nullptr;
+}
+
+int ThreadPool::getThreadCount() const
+{
+    return static_cast<int>(m_workers.size()) + 1;
+}
+
+int ThreadPool::getDefaultWorkerCount()
+{
+    return std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+}
+
+void ThreadPool::work()
+{
+    Profiler::setThreadName("thread pool worker");
+
+    std::uint64_t seenGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this, seenGeneration]
+            {
+                return m_isStopping || m_generation != seenGeneration;
+            });
+
+            if (m_isStopping) return;
+            seenGeneration = m_generation;
+        }
+
+        runTasks();
+
+        bool isLast;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            isLast = --m_busyWorkerCount == 0;
+        }
+        if (isLast) m_doneCondition.notify_one();
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    while (true)
+    {
+        const int taskIndex = m_nextTask.fetch_add(1, std::memory_order_relaxed);
+        if (taskIndex >= m_taskCount) return;
+
+        (*m_task)(taskIndex);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef LAB6FLOWFIELD_THREADPOOL_HPP
+#define LAB6FLOWFIELD_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Fixed set of worker threads running the tasks of a parallel loop
+ * \details The workers are started once and sleep between two loops, so a loop every frame does not pay for the
+ * creation of threads. The thread calling run() works on the tasks too, and only returns once every task is done.
+ * Tasks are taken in any order by any thread: a loop is deterministic as long as its tasks write to separate data.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * \param workerCount number of threads besides the caller of run(), by default one less than the cores
+     */
+    explicit ThreadPool(int workerCount = getDefaultWorkerCount());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * \brief Call task(i) for every i in [0, taskCount), spread over the workers and the calling thread
+     * \details Not reentrant: a task must not call run() on the same pool.
+     */
+    void run(int taskCount, const std::function<void(int)>& task);
+
+    /**
+     * \brief Number of threads working on a loop, the caller included
+     */
+    int getThreadCount() const;
+
+    static int getDefaultWorkerCount();
+
+private:
+    void work();
+
+    /**
+     * \brief Take and run tasks of the current loop until there are none left
+     */
+    void runTasks();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_doneCondition;
+
+    // Incremented for each loop so the workers know a new one started
+    std::uint64_t m_generation;
+    bool m_isStopping;
+    // Workers still running tasks of the current loop
+    int m_busyWorkerCount;
+
+    const std::function<void(int)>* m_task;
+    int m_taskCount;
+    std::atomic<int> m_nextTask;
+};
+
+
+#endif //LAB6FLOWFIELD_THREADPOOL_HPP
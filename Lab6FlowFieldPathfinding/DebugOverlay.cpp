@@ -0,0 +1,160 @@
+#include "DebugOverlay.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include "FlowField/FlowField.hpp"
+
+namespace
+{
+    constexpr unsigned CharacterSize = 15;
+
+    // Position of the texts from the top-left corner of their cell
+    const sf::Vector2f CostTextOffset = {0, 0};
+    const sf::Vector2f IntegrationTextOffset = {30, 0};
+
+    // The texts overflow their cell on the right and at the bottom, cells a bit outside the visible area are built too
+    constexpr float VisibleMargin = 64;
+
+    constexpr float PointRadius = 2;
+
+    // Space left around each glyph in the texture of the font, same as sf::Text
+    constexpr float GlyphPadding = 1;
+
+    constexpr int MinusGlyph = 10;
+}
+
+DebugOverlay::DebugOverlay(const sf::Font& font, const FlowField& field) :
+    m_font(font),
+    m_field(field),
+    m_textVertices(sf::Quads),
+    m_pointVertices(sf::Quads),
+    m_isValid(false)
+{
+    // Every glyph is added to the texture of the font now, so the texture never changes while drawing
+    for (int digit = 0; digit < 10; digit++)
+    {
+        m_glyphs[digit] = m_font.getGlyph('0' + digit, CharacterSize, false);
+    }
+    m_glyphs[MinusGlyph] = m_font.getGlyph('-', CharacterSize, false);
+}
+
+void DebugOverlay::invalidate()
+{
+    m_isValid = false;
+}
+
+void DebugOverlay::update(const sf::FloatRect& visibleArea)
+{
+    const float cellSize = m_field.getCellSize();
+    const int width = m_field.getWidth();
+    const int height = m_field.getHeight();
+
+    const auto toCell = [cellSize](const float position, const int cellCount)
+    {
+        return static_cast<int>(std::min(std::max(std::floor(position / cellSize), 0.f),
+                                         static_cast<float>(cellCount)));
+    };
+
+    const int firstX = toCell(visibleArea.left - VisibleMargin, width);
+    const int firstY = toCell(visibleArea.top - VisibleMargin, height);
+    const int endX = toCell(visibleArea.left + visibleArea.width + cellSize, width);
+    const int endY = toCell(visibleArea.top + visibleArea.height + cellSize, height);
+    const sf::IntRect cells(firstX, firstY, endX - firstX, endY - firstY);
+
+    if (m_isValid && cells == m_builtCells) return;
+
+    m_textVertices.clear();
+    m_pointVertices.clear();
+
+    for (int y = firstY; y < endY; y++)
+    {
+        for (int x = firstX; x < endX; x++)
+        {
+            const int index = m_field.toIndex(x, y);
+            const float left = static_cast<float>(x) * cellSize;
+            const float top = static_cast<float>(y) * cellSize;
+
+            const int costDistance = m_field.getCostDistance(index);
+            if (costDistance != FlowField::Impassable)
+            {
+                appendNumber(costDistance, left + CostTextOffset.x, top + CostTextOffset.y);
+            }
+            appendNumber(m_field.getIntegration(index), left + IntegrationTextOffset.x, top + IntegrationTextOffset.y);
+
+            appendPoint(left + cellSize / 2, top + cellSize / 2);
+        }
+    }
+
+    m_builtCells = cells;
+    m_isValid = true;
+}
+
+std::size_t DebugOverlay::getTextVertexCount() const
+{
+    return m_textVertices.getVertexCount();
+}
+
+void DebugOverlay::appendNumber(const int value, const float x, const float y)
+{
+    // Digits from the last one, the magnitude is unsigned so the lowest int does not overflow
+    int digits[10];
+    int digitCount = 0;
+    unsigned magnitude = value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value);
+    do
+    {
+        digits[digitCount++] = static_cast<int>(magnitude % 10);
+        magnitude /= 10;
+    }
+    while (magnitude != 0);
+
+    // Like sf::Text, the baseline is one character size below the top of the text
+    float penX = x;
+    const float baseline = y + static_cast<float>(CharacterSize);
+
+    const auto appendGlyph = [this, &penX, baseline](const sf::Glyph& glyph)
+    {
+        const float left = penX + glyph.bounds.left - GlyphPadding;
+        const float top = baseline + glyph.bounds.top - GlyphPadding;
+        const float right = penX + glyph.bounds.left + glyph.bounds.width + GlyphPadding;
+        const float bottom = baseline + glyph.bounds.top + glyph.bounds.height + GlyphPadding;
+
+        const float u1 = static_cast<float>(glyph.textureRect.left) - GlyphPadding;
+        const float v1 = static_cast<float>(glyph.textureRect.top) - GlyphPadding;
+        const float u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width) + GlyphPadding;
+        const float v2 = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height) + GlyphPadding;
+
+        m_textVertices.append(sf::Vertex({left, top}, sf::Color::White, {u1, v1}));
+        m_textVertices.append(sf::Vertex({right, top}, sf::Color::White, {u2, v1}));
+        m_textVertices.append(sf::Vertex({right, bottom}, sf::Color::White, {u2, v2}));
+        m_textVertices.append(sf::Vertex({left, bottom}, sf::Color::White, {u1, v2}));
+
+        penX += glyph.advance;
+    };
+
+    if (value < 0) appendGlyph(m_glyphs[MinusGlyph]);
+    while (digitCount > 0)
+    {
+        appendGlyph(m_glyphs[digits[--digitCount]]);
+    }
+}
+
+void DebugOverlay::appendPoint(const float centerX, const float centerY)
+{
+    m_pointVertices.append(sf::Vertex({centerX - PointRadius, centerY - PointRadius}, sf::Color::Red));
+    m_pointVertices.append(sf::Vertex({centerX + PointRadius, centerY - PointRadius}, sf::Color::Red));
+    m_pointVertices.append(sf::Vertex({centerX + PointRadius, centerY + PointRadius}, sf::Color::Red));
+    m_pointVertices.append(sf::Vertex({centerX - PointRadius, centerY + PointRadius}, sf::Color::Red));
+}
+
+void DebugOverlay::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    // Points over the texts
+    sf::RenderStates textStates = states;
+    textStates.texture = &m_font.getTexture(CharacterSize);
+    target.draw(m_textVertices, textStates);
+
+    target.draw(m_pointVertices, states);
+}
@@ -0,0 +1,66 @@
+#ifndef LAB6FLOWFIELD_DEBUGOVERLAY_HPP
+#define LAB6FLOWFIELD_DEBUGOVERLAY_HPP
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+
+class FlowField;
+
+/**
+ * \brief Cost and integration of each visible cell, and a point on its center, drawn over the grid
+ * \details The overlay is only built when update() is called, so nothing is spent on it while the debug data is hidden,
+ * and only for the cells in the visible area. Every number is made of the quads of its glyphs, taken from the texture
+ * of the font, so all the texts are drawn in a single call, and the points in another one.
+ */
+class DebugOverlay : public sf::Drawable
+{
+public:
+    DebugOverlay(const sf::Font& font, const FlowField& field);
+
+    /**
+     * \brief The values of the flow field changed, the overlay is built again on the next update()
+     */
+    void invalidate();
+
+    /**
+     * \brief Build the overlay for the cells in the visible area, if the area or the values changed since the last
+     * time
+     * \param visibleArea area in world coordinates
+     */
+    void update(const sf::FloatRect& visibleArea);
+
+    /**
+     * \brief Number of vertices of the texts, 4 per glyph
+     */
+    std::size_t getTextVertexCount() const;
+
+private:
+    // Glyphs of the digits, then of the minus sign
+    static constexpr int GlyphCount = 11;
+
+    /**
+     * \brief Add the quads of the glyphs of a number, the top-left corner of the text being at (x, y) like sf::Text
+     */
+    void appendNumber(int value, float x, float y);
+
+    void appendPoint(float centerX, float centerY);
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+    const sf::Font& m_font;
+    const FlowField& m_field;
+
+    sf::Glyph m_glyphs[GlyphCount];
+
+    sf::VertexArray m_textVertices;
+    sf::VertexArray m_pointVertices;
+
+    // Cells the overlay was built for, first cell included and last excluded
+    sf::IntRect m_builtCells;
+    bool m_isValid;
+};
+
+
+#endif //LAB6FLOWFIELD_DEBUGOVERLAY_HPP
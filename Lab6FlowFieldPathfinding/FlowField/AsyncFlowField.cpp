@@ -0,0 +1,146 @@
+#include "AsyncFlowField.hpp"
+
+#include "../Profiling/Profiler.hpp"
+
+AsyncFlowField::AsyncFlowField(const int width, const int height, const float cellSize) :
+    m_buffers{FlowField(width, height, cellSize), FlowField(width, height, cellSize)},
+    m_frontIndex(0),
+    m_bufferRequests{0, 0},
+    m_requestMap(width, height, cellSize),
+    m_requestGoal(0),
+    m_requestIntegrator(FlowField::Integrator::BreadthFirst),
+    m_isLineOfSightEnabled(false),
+    m_requestCount(0),
+    m_hasRequest(false),
+    m_isStopping(false),
+    m_isReady(false),
+    m_isCancelled(false),
+    m_completedCount(0),
+    m_cancelledCount(0)
+{
+    for (auto& buffer : m_buffers)
+    {
+        buffer.setCancelFlag(&m_isCancelled);
+    }
+
+    m_worker = std::thread([this] { work(); });
+}
+
+AsyncFlowField::~AsyncFlowField()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+        m_isCancelled.store(true, std::memory_order_relaxed);
+    }
+    m_condition.notify_all();
+
+    m_worker.join();
+}
+
+void AsyncFlowField::request(const FlowField& map, const int goalIndex, const FlowField::Integrator integrator)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requestMap.copyMap(map);
+        m_requestGoal = goalIndex;
+        m_requestIntegrator = integrator;
+        m_requestCount++;
+        m_hasRequest = true;
+
+        // The calculation running, if any, is for an older request
+        m_isCancelled.store(true, std::memory_order_relaxed);
+    }
+    m_condition.notify_all();
+}
+
+void AsyncFlowField::setLineOfSightEnabled(const bool isEnabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isLineOfSightEnabled = isEnabled;
+}
+
+bool AsyncFlowField::publish()
+{
+    if (!m_isReady.load(std::memory_order_acquire)) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frontIndex = 1 - m_frontIndex;
+        m_isReady.store(false, std::memory_order_relaxed);
+    }
+
+    // The worker may be waiting for the back buffer to start the next request
+    m_condition.notify_all();
+
+    return true;
+}
+
+FlowField& AsyncFlowField::getField()
+{
+    return m_buffers[m_frontIndex];
+}
+
+const FlowField& AsyncFlowField::getField() const
+{
+    return m_buffers[m_frontIndex];
+}
+
+bool AsyncFlowField::isBusy() const
+{
+    // Only the thread calling request() changes the request count
+    return m_bufferRequests[m_frontIndex] != m_requestCount;
+}
+
+int AsyncFlowField::getCompletedCount() const
+{
+    return m_completedCount.load(std::memory_order_relaxed);
+}
+
+int AsyncFlowField::getCancelledCount() const
+{
+    return m_cancelledCount.load(std::memory_order_relaxed);
+}
+
+void AsyncFlowField::work()
+{
+    Profiler::setThreadName("flow field worker");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        // The back buffer is free once the last completed field is published
+        m_condition.wait(lock, [this]
+        {
+            return m_isStopping || (m_hasRequest && !m_isReady.load(std::memory_order_relaxed));
+        });
+
+        if (m_isStopping) return;
+
+        const int backIndex = 1 - m_frontIndex;
+        FlowField& back = m_buffers[backIndex];
+        back.copyMap(m_requestMap);
+        back.setGoal(m_requestGoal % back.getWidth(), m_requestGoal / back.getWidth());
+        back.setIntegrator(m_requestIntegrator);
+        back.setLineOfSightEnabled(m_isLineOfSightEnabled);
+
+        const std::uint64_t request = m_requestCount;
+        m_hasRequest = false;
+        m_isCancelled.store(false, std::memory_order_relaxed);
+
+        lock.unlock();
+        back.calculate();
+        lock.lock();
+
+        // A newer request came during the calculation, this field is already outdated
+        if (!back.isCalculated() || m_hasRequest)
+        {
+            m_cancelledCount.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        m_bufferRequests[backIndex] = request;
+        m_completedCount.fetch_add(1, std::memory_order_relaxed);
+        m_isReady.store(true, std::memory_order_release);
+    }
+}
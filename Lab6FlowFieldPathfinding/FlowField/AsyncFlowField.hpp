@@ -0,0 +1,112 @@
+#ifndef LAB6FLOWFIELD_ASYNCFLOWFIELD_HPP
+#define LAB6FLOWFIELD_ASYNCFLOWFIELD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "FlowField.hpp"
+
+/**
+ * \brief Flow field calculated on a background thread, so a big calculation does not block the thread asking for it
+ * \details Double buffered: the worker calculates in the back buffer while the front one is only read. Once a
+ * calculation completes, publish() swaps the two buffers on the thread reading the field, between two frames, so the
+ * agents keep steering on the last complete field until then.
+ *
+ * Only the last request matters: a request still waiting is replaced by a newer one, and the calculation of an older
+ * request is cancelled (see FlowField::setCancelFlag()). The map of each request is copied, so it can be edited as
+ * soon as request() returns. Takes three times the memory of a flow field: both buffers and the copy of the map.
+ */
+class AsyncFlowField
+{
+public:
+    /**
+     * \param width number of cells on the x axis
+     * \param height number of cells on the y axis
+     * \param cellSize size of one cell in world units (see FlowField)
+     */
+    AsyncFlowField(int width, int height, float cellSize = 1.f);
+
+    /**
+     * \brief Cancel the calculation running and wait for the worker to stop
+     */
+    ~AsyncFlowField();
+
+    AsyncFlowField(const AsyncFlowField&) = delete;
+    AsyncFlowField& operator=(const AsyncFlowField&) = delete;
+
+    /**
+     * \brief Ask for the fields of a goal on the obstacles and terrain costs of a flow field of the same size
+     * \details Returns right away: the map is copied and the fields are calculated by the worker.
+     * \param goalIndex index of the goal cell, inside the grid
+     */
+    void request(const FlowField& map, int goalIndex, FlowField::Integrator integrator);
+
+    /**
+     * \brief Mark the cells in line of sight of the goal from the next calculation, see FlowField::computeLineOfSight()
+     */
+    void setLineOfSightEnabled(bool isEnabled);
+
+    /**
+     * \brief Swap the buffers if a calculation completed since the last call, to call from the thread reading the field
+     * \return true if getField() is a new field
+     */
+    bool publish();
+
+    /**
+     * \brief Last field published, only changed by publish()
+     * \details Not const, so its fields can be moved out with FlowField::swapFields(): the worker never touches it.
+     */
+    FlowField& getField();
+    const FlowField& getField() const;
+
+    /**
+     * \brief Whether the field of the last request is not published yet
+     */
+    bool isBusy() const;
+
+    /**
+     * \brief Number of calculations completed, and cancelled because a newer request came
+     */
+    int getCompletedCount() const;
+    int getCancelledCount() const;
+
+private:
+    void work();
+
+    FlowField m_buffers[2];
+    // Only changed by publish(), while the worker waits for it
+    int m_frontIndex;
+
+    // Request of each buffer, the one of the front buffer is the last one published
+    std::uint64_t m_bufferRequests[2];
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    // Last request, its map is copied in m_requestMap
+    FlowField m_requestMap;
+    int m_requestGoal;
+    FlowField::Integrator m_requestIntegrator;
+    bool m_isLineOfSightEnabled;
+    std::uint64_t m_requestCount;
+    bool m_hasRequest;
+
+    bool m_isStopping;
+
+    // Set by the worker once the back buffer is complete, until publish() swaps the buffers
+    std::atomic<bool> m_isReady;
+    // Set by a newer request, read by the calculation running
+    std::atomic<bool> m_isCancelled;
+
+    std::atomic<int> m_completedCount;
+    std::atomic<int> m_cancelledCount;
+
+    // Started last, once everything it uses is constructed
+    std::thread m_worker;
+};
+
+
+#endif //LAB6FLOWFIELD_ASYNCFLOWFIELD_HPP
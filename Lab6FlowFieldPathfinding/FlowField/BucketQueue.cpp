@@ -0,0 +1,61 @@
+#include "BucketQueue.hpp"
+
+#include <cassert>
+
+BucketQueue::BucketQueue(const int maxKeyStep) :
+    m_buckets(maxKeyStep + 1),
+    m_currentKey(0),
+    m_size(0)
+{
+}
+
+void BucketQueue::clear()
+{
+    // Every bucket is already empty once the queue has been emptied by pop()
+    if (m_size != 0)
+    {
+        for (auto& bucket : m_buckets)
+        {
+            bucket.clear();
+        }
+    }
+
+    m_currentKey = 0;
+    m_size = 0;
+}
+
+void BucketQueue::push(const int key, const int value)
+{
+    const int bucketCount = static_cast<int>(m_buckets.size());
+
+    assert(key >= m_currentKey && key - m_currentKey < bucketCount);
+
+    m_buckets[key % bucketCount].push_back(value);
+    m_size++;
+}
+
+bool BucketQueue::pop(int& key, int& value)
+{
+    if (m_size == 0) return false;
+
+    const int bucketCount = static_cast<int>(m_buckets.size());
+    int bucketIndex = m_currentKey % bucketCount;
+    while (m_buckets[bucketIndex].empty())
+    {
+        m_currentKey++;
+        if (++bucketIndex == bucketCount) bucketIndex = 0;
+    }
+
+    auto& bucket = m_buckets[bucketIndex];
+    key = m_currentKey;
+    value = bucket.back();
+    bucket.pop_back();
+    m_size--;
+
+    return true;
+}
+
+bool BucketQueue::isEmpty() const
+{
+    return m_size == 0;
+}
@@ -0,0 +1,44 @@
+#ifndef LAB6FLOWFIELD_BUCKETQUEUE_HPP
+#define LAB6FLOWFIELD_BUCKETQUEUE_HPP
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * \brief Monotone priority queue of integer keys, as used by Dial's algorithm
+ * \details Values are stored in a circular array of buckets, one per key. Push and pop are O(1) (plus the empty
+ * buckets skipped by pop), as long as the key of a pushed value is never lower than the key of the last popped
+ * value (0 after clear()) and never higher than it by more than maxKeyStep.
+ */
+class BucketQueue
+{
+public:
+    /**
+     * \param maxKeyStep biggest difference between the key of a pushed value and the key of the last popped value
+     */
+    explicit BucketQueue(int maxKeyStep);
+
+    /**
+     * \brief Remove every value, the buckets keep their memory
+     */
+    void clear();
+
+    void push(int key, int value);
+
+    /**
+     * \brief Remove one of the values with the lowest key
+     * \return false if the queue is empty
+     */
+    bool pop(int& key, int& value);
+
+    bool isEmpty() const;
+
+private:
+    std::vector<std::vector<int>> m_buckets;
+
+    int m_currentKey;
+    std::size_t m_size;
+};
+
+
+#endif //LAB6FLOWFIELD_BUCKETQUEUE_HPP
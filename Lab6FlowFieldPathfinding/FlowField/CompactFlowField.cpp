@@ -0,0 +1,120 @@
+#include "CompactFlowField.hpp"
+
+namespace
+{
+    // Tiles of 8x8 cells, 4 bits per cell
+    constexpr int TileShift = 3;
+    constexpr int TileSize = 1 << TileShift;
+    constexpr int TileMask = TileSize - 1;
+}
+
+CompactFlowField::CompactFlowField(const FlowField& field) :
+    CompactFlowField(field, getDefaultLayout(field.getWidth(), field.getHeight()))
+{
+}
+
+CompactFlowField::CompactFlowField(const FlowField& field, const Layout layout) :
+    m_width(field.getWidth()),
+    m_height(field.getHeight()),
+    m_goalIndex(field.getGoalIndex()),
+    m_integrator(field.getIntegrator()),
+    m_mapVersion(field.getMapVersion()),
+    m_layout(layout),
+    m_tilesPerRow((m_width + TileMask) / TileSize),
+    m_rowMultiplier(0),
+    m_rowShift(32)
+{
+    // Granlund-Montgomery: with 2^(l-1) < width <= 2^l, the multiplier has 33 bits and index * multiplier fits in 64
+    while ((std::int64_t{1} << (m_rowShift - 32)) < m_width) m_rowShift++;
+    m_rowMultiplier = (std::uint64_t{1} << m_rowShift) / static_cast<std::uint64_t>(m_width) + 1;
+
+    // The tiles on the right and bottom edges are complete, their cells outside the grid are never read
+    const int slotCount = layout == Layout::RowMajor
+                              ? field.getCellCount()
+                              : m_tilesPerRow * ((m_height + TileMask) / TileSize) * TileSize * TileSize;
+    m_codes.resize((slotCount + 1) / 2, 0);
+
+    const std::vector<std::uint8_t>& codes = field.getDirectionCodes();
+    for (int i = 0; i < field.getCellCount(); i++)
+    {
+        const std::uint8_t code = codes[i];
+        const int slot = toSlot(i);
+        m_codes[slot / 2] |= static_cast<std::uint8_t>(slot % 2 == 0 ? code : code << 4);
+    }
+}
+
+CompactFlowField::Layout CompactFlowField::getDefaultLayout(const int width, const int height)
+{
+    return static_cast<long long>(width) * height >= TiledMinCellCount ? Layout::Tiled : Layout::RowMajor;
+}
+
+CompactFlowField::Layout CompactFlowField::getLayout() const
+{
+    return m_layout;
+}
+
+int CompactFlowField::getWidth() const
+{
+    return m_width;
+}
+
+int CompactFlowField::getHeight() const
+{
+    return m_height;
+}
+
+int CompactFlowField::getGoalIndex() const
+{
+    return m_goalIndex;
+}
+
+FlowField::Integrator CompactFlowField::getIntegrator() const
+{
+    return m_integrator;
+}
+
+std::uint64_t CompactFlowField::getMapVersion() const
+{
+    return m_mapVersion;
+}
+
+std::uint8_t CompactFlowField::getDirectionCode(const int index) const
+{
+    const int slot = toSlot(index);
+    const std::uint8_t pair = m_codes[slot / 2];
+    return slot % 2 == 0 ? pair & 0x0F : pair >> 4;
+}
+
+FlowField::Direction CompactFlowField::getDirection(const int index) const
+{
+    return FlowField::decodeDirection(getDirectionCode(index));
+}
+
+int CompactFlowField::getNextIndex(const int index) const
+{
+    return FlowField::getNextIndex(index, getDirectionCode(index), m_width);
+}
+
+FlowField::Direction CompactFlowField::sampleDirection(const float gridX, const float gridY) const
+{
+    return FlowField::sampleDirections(m_width, m_height, gridX, gridY, [this](const int index)
+    {
+        return getDirection(index);
+    });
+}
+
+std::size_t CompactFlowField::getMemorySize() const
+{
+    return sizeof(CompactFlowField) + m_codes.capacity();
+}
+
+int CompactFlowField::toSlot(const int index) const
+{
+    if (m_layout == Layout::RowMajor) return index;
+
+    const int y = static_cast<int>(static_cast<std::uint64_t>(index) * m_rowMultiplier >> m_rowShift);
+    const int x = index - y * m_width;
+    const int tile = (y >> TileShift) * m_tilesPerRow + (x >> TileShift);
+
+    return tile << (2 * TileShift) | (y & TileMask) << TileShift | (x & TileMask);
+}
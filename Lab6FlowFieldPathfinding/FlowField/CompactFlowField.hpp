@@ -0,0 +1,110 @@
+#ifndef LAB6FLOWFIELD_COMPACTFLOWFIELD_HPP
+#define LAB6FLOWFIELD_COMPACTFLOWFIELD_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "FlowField.hpp"
+
+/**
+ * \brief Read-only copy of the vector field of a flow field, 4 bits per cell
+ * \details Each cell only stores its direction code (see FlowField::NoDirectionCode), two cells per byte, which is
+ * half the size of the vector field of FlowField. This is enough to move agents and walk paths, but the cost and
+ * integration fields are not kept.
+ *
+ * On big maps, the codes are stored in tiles of 8x8 cells instead of row by row (see Layout): the cells around a
+ * cell, in any direction, are then mostly in the same cache line, where a row-major field of a few thousand cells
+ * wide has every cell above or below in another line and another page. The index of a cell is the same in both
+ * layouts, only the storage differs.
+ */
+class CompactFlowField
+{
+public:
+    /**
+     * \brief Order of the direction codes in memory
+     */
+    enum class Layout
+    {
+        // Cells in index order, row by row
+        RowMajor,
+        // Tiles of 8x8 cells (32 bytes) in row-major order, the cells of a tile row by row. Walking a path or sampling
+        // the field reads fewer cache lines, but finding a cell takes a few more operations.
+        Tiled
+    };
+
+    /**
+     * \brief From this number of cells, the fields are tiled by default: below, a row-major field fits in the caches
+     */
+    static constexpr int TiledMinCellCount = 1 << 23;
+
+    /**
+     * \brief Pack the vector field of a calculated flow field, in the default layout for its size
+     */
+    explicit CompactFlowField(const FlowField& field);
+
+    /**
+     * \brief Pack the vector field of a calculated flow field in the given layout
+     */
+    CompactFlowField(const FlowField& field, Layout layout);
+
+    /**
+     * \brief Tiled from TiledMinCellCount cells, row-major below
+     */
+    static Layout getDefaultLayout(int width, int height);
+
+    Layout getLayout() const;
+
+    int getWidth() const;
+    int getHeight() const;
+    int getGoalIndex() const;
+    FlowField::Integrator getIntegrator() const;
+
+    /**
+     * \brief Version of the map (see FlowField::getMapVersion()) the field was calculated for
+     */
+    std::uint64_t getMapVersion() const;
+
+    std::uint8_t getDirectionCode(int index) const;
+    FlowField::Direction getDirection(int index) const;
+
+    /**
+     * \brief Same as FlowField::getNextIndex()
+     */
+    int getNextIndex(int index) const;
+
+    /**
+     * \brief Same as FlowField::sampleDirection()
+     */
+    FlowField::Direction sampleDirection(float gridX, float gridY) const;
+
+    /**
+     * \brief Number of bytes used by this field
+     */
+    std::size_t getMemorySize() const;
+
+private:
+    /**
+     * \brief Position of the code of a cell in the packed codes, in cells
+     */
+    int toSlot(int index) const;
+
+    int m_width;
+    int m_height;
+    int m_goalIndex;
+    FlowField::Integrator m_integrator;
+    std::uint64_t m_mapVersion;
+
+    Layout m_layout;
+    int m_tilesPerRow;
+
+    // Row of an index without a division, index * m_rowMultiplier >> m_rowShift, exact for every positive index
+    std::uint64_t m_rowMultiplier;
+    int m_rowShift;
+
+    // Direction codes, the low 4 bits of byte i for the slot 2 * i and the high 4 bits for the slot 2 * i + 1
+    std::vector<std::uint8_t> m_codes;
+};
+
+
+#endif //LAB6FLOWFIELD_COMPACTFLOWFIELD_HPP
@@ -0,0 +1,228 @@
+#include "EikonalSolver.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../Crowd/ThreadPool.hpp"
+
+namespace
+{
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+    constexpr int OrderingCount = 4;
+
+    // Length of a diagonal step, in cells
+    constexpr float DiagonalStepLength = 1.41421356f;
+
+    // Safety net, a solve on a reachable map always converges long before
+    constexpr int MaxIterationCount = 100000;
+
+    // Chunks of cells per thread the copies of the times are merged by, to balance the threads
+    constexpr int MergeTasksPerThread = 4;
+}
+
+EikonalSolver::EikonalSolver() :
+    m_width(0),
+    m_height(0),
+    m_obstacles(nullptr),
+    m_terrainCosts(nullptr),
+    m_goalIndex(0),
+    m_isParallel(false),
+    m_threadPool(nullptr),
+    m_iterationCount(0),
+    m_cancelFlag(nullptr)
+{
+}
+
+void EikonalSolver::solve(const int width, const int height, const std::vector<std::uint8_t>& obstacles,
+                          const std::vector<std::uint8_t>& terrainCosts, const int goalIndex,
+                          std::vector<float>& times)
+{
+    m_width = width;
+    m_height = height;
+    m_obstacles = &obstacles;
+    m_terrainCosts = &terrainCosts;
+    m_goalIndex = goalIndex;
+
+    times.assign(static_cast<size_t>(width) * height, Infinity);
+    times[goalIndex] = 0;
+
+    m_iterationCount = 0;
+    if (m_isParallel && m_threadPool != nullptr && m_threadPool->getThreadCount() > 1)
+    {
+        solveParallel(times);
+        return;
+    }
+
+    bool hasChanged = true;
+    while (hasChanged && m_iterationCount < MaxIterationCount)
+    {
+        if (m_cancelFlag != nullptr && m_cancelFlag->load(std::memory_order_relaxed)) return;
+
+        hasChanged = false;
+        m_iterationCount++;
+
+        for (int ordering = 0; ordering < OrderingCount; ordering++)
+        {
+            hasChanged |= sweep(ordering, times);
+        }
+    }
+}
+
+void EikonalSolver::solveParallel(std::vector<float>& times)
+{
+    // Allocated by the first solve only, the copies keep their capacity from a solve to the next
+    for (auto& sweepTimes : m_sweepTimes)
+    {
+        sweepTimes.assign(times.begin(), times.end());
+    }
+
+    bool orderingHasChanged[OrderingCount] = {};
+    const std::function<void(int)> sweepTask = [this, &orderingHasChanged](const int ordering)
+    {
+        orderingHasChanged[ordering] = sweep(ordering, m_sweepTimes[ordering]);
+    };
+
+    // Every copy starts the next iteration from the minimum of the 4
+    const int mergeTaskCount = m_threadPool->getThreadCount() * MergeTasksPerThread;
+    const std::function<void(int)> mergeTask = [this, &times](const int task)
+    {
+        const size_t taskCount = m_threadPool->getThreadCount() * MergeTasksPerThread;
+        const size_t chunkSize = (times.size() + taskCount - 1) / taskCount;
+        const size_t end = std::min(times.size(), chunkSize * (task + 1));
+        for (size_t i = chunkSize * task; i < end; i++)
+        {
+            const float time = std::min(std::min(m_sweepTimes[0][i], m_sweepTimes[1][i]),
+                                        std::min(m_sweepTimes[2][i], m_sweepTimes[3][i]));
+            for (auto& sweepTimes : m_sweepTimes)
+            {
+                sweepTimes[i] = time;
+            }
+        }
+    };
+
+    bool hasChanged = true;
+    while (hasChanged && m_iterationCount < MaxIterationCount)
+    {
+        if (m_cancelFlag != nullptr && m_cancelFlag->load(std::memory_order_relaxed)) return;
+
+        m_iterationCount++;
+        m_threadPool->run(OrderingCount, sweepTask);
+
+        hasChanged = false;
+        for (const bool isChanged : orderingHasChanged)
+        {
+            hasChanged |= isChanged;
+        }
+
+        if (hasChanged) m_threadPool->run(mergeTaskCount, mergeTask);
+    }
+
+    // The copies are all the same once merged, or when no sweep changed them. The buffer of the times is kept for the
+    // next solve.
+    times.swap(m_sweepTimes[0]);
+}
+
+void EikonalSolver::setParallel(const bool isParallel)
+{
+    m_isParallel = isParallel;
+}
+
+bool EikonalSolver::isParallel() const
+{
+    return m_isParallel;
+}
+
+void EikonalSolver::setThreadPool(ThreadPool* pool)
+{
+    m_threadPool = pool;
+}
+
+void EikonalSolver::setCancelFlag(const std::atomic<bool>* isCancelled)
+{
+    m_cancelFlag = isCancelled;
+}
+
+int EikonalSolver::getIterationCount() const
+{
+    return m_iterationCount;
+}
+
+bool EikonalSolver::sweep(const int ordering, std::vector<float>& times) const
+{
+    const std::vector<std::uint8_t>& obstacles = *m_obstacles;
+    const std::vector<std::uint8_t>& terrainCosts = *m_terrainCosts;
+
+    const int stepX = ordering & 1 ? -1 : 1;
+    const int stepY = ordering & 2 ? -1 : 1;
+    const int startX = stepX > 0 ? 0 : m_width - 1;
+    const int startY = stepY > 0 ? 0 : m_height - 1;
+
+    bool hasChanged = false;
+
+    for (int y = startY; y >= 0 && y < m_height; y += stepY)
+    {
+        const int row = m_width * y;
+
+        for (int x = startX; x >= 0 && x < m_width; x += stepX)
+        {
+            const int index = row + x;
+            if (obstacles[index] || index == m_goalIndex) continue;
+
+            // Lowest time of the neighbours on each axis, obstacles are never reached
+            float horizontal = Infinity;
+            if (x > 0 && !obstacles[index - 1]) horizontal = times[index - 1];
+            if (x < m_width - 1 && !obstacles[index + 1]) horizontal = std::min(horizontal, times[index + 1]);
+
+            float vertical = Infinity;
+            if (y > 0 && !obstacles[index - m_width]) vertical = times[index - m_width];
+            if (y < m_height - 1 && !obstacles[index + m_width]) vertical = std::min(vertical, times[index + m_width]);
+
+            // Lowest time of the diagonal neighbours
+            float diagonal = Infinity;
+            if (y > 0)
+            {
+                const int above = index - m_width;
+                if (x > 0 && !obstacles[above - 1]) diagonal = times[above - 1];
+                if (x < m_width - 1 && !obstacles[above + 1]) diagonal = std::min(diagonal, times[above + 1]);
+            }
+            if (y < m_height - 1)
+            {
+                const int below = index + m_width;
+                if (x > 0 && !obstacles[below - 1]) diagonal = std::min(diagonal, times[below - 1]);
+                if (x < m_width - 1 && !obstacles[below + 1]) diagonal = std::min(diagonal, times[below + 1]);
+            }
+
+            const float lowest = std::min(horizontal, vertical);
+            if (lowest == Infinity && diagonal == Infinity) continue;
+
+            // Diagonal step, the only way in when the 2 straight neighbours along the diagonal are obstacles
+            const float slowness = terrainCosts[index];
+            float time = diagonal + DiagonalStepLength * slowness;
+
+            // Godunov upwind update: from one axis only if the other is too far behind, from both axes otherwise
+            if (lowest != Infinity)
+            {
+                const float difference = horizontal - vertical;
+                if (std::abs(difference) >= slowness)
+                {
+                    time = std::min(time, lowest + slowness);
+                }
+                else
+                {
+                    time = std::min(time, (horizontal + vertical +
+                                           std::sqrt(2 * slowness * slowness - difference * difference)) / 2);
+                }
+            }
+
+            if (time < times[index])
+            {
+                times[index] = time;
+                hasChanged = true;
+            }
+        }
+    }
+
+    return hasChanged;
+}
@@ -0,0 +1,91 @@
+#ifndef LAB6FLOWFIELD_EIKONALSOLVER_HPP
+#define LAB6FLOWFIELD_EIKONALSOLVER_HPP
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+class ThreadPool;
+
+/**
+ * \brief Fast sweeping solver of the eikonal equation |grad T| = f on a grid
+ * \details T is the arrival time from the goal and f the terrain cost of each cell (cell size = 1). Every cell is
+ * updated with the upwind Godunov scheme from its 4 straight neighbours, in 4 sweeps going through the grid along
+ * the 4 diagonal orderings, until nothing changes anymore. Compared to a search on the 8 neighbours, the distances
+ * are much more isotropic (no 45 degrees artifacts). The number of iterations grows with the number of turns the
+ * shortest paths take, so this is at its best on open maps. A diagonal step (T of the diagonal neighbour + sqrt(2) f)
+ * is taken instead when it arrives earlier, so the cells only linked by a diagonal between two obstacles are reached,
+ * like with the other integrators.
+ *
+ * When parallel, the 4 orderings of an iteration run on the threads of a pool, each on its own copy of the times, and
+ * the copies are merged by keeping the minimum (parallel fast sweeping of Zhao). Otherwise the sweeps run one after
+ * another in place (Gauss-Seidel), which needs less iterations: the orderings only exchange their times once per
+ * iteration in parallel. The sweeps are serial by default, the benchmark compares both (see README).
+ */
+class EikonalSolver
+{
+public:
+    EikonalSolver();
+
+    /**
+     * \param obstacles one byte per cell, non zero if the cell is impassable
+     * \param terrainCosts one byte per cell, the slowness f
+     * \param goalIndex index of the cell where T = 0
+     * \param times output arrival time of each cell, infinity if the cell cannot be reached
+     */
+    void solve(int width, int height, const std::vector<std::uint8_t>& obstacles,
+               const std::vector<std::uint8_t>& terrainCosts, int goalIndex, std::vector<float>& times);
+
+    /**
+     * \brief Run the 4 sweep orderings of each iteration on the thread pool (see setThreadPool())
+     */
+    void setParallel(bool isParallel);
+    bool isParallel() const;
+
+    /**
+     * \brief Thread pool the parallel sweeps run on, serial without a pool or with a pool of one thread
+     * \details The pool must not run another loop during solve(), ThreadPool::run() is not reentrant.
+     */
+    void setThreadPool(ThreadPool* pool);
+
+    /**
+     * \brief Flag read between two iterations, solve() stops early once it is set (see FlowField::setCancelFlag())
+     */
+    void setCancelFlag(const std::atomic<bool>* isCancelled);
+
+    /**
+     * \brief Number of iterations (4 sweeps each) done by the last solve()
+     */
+    int getIterationCount() const;
+
+private:
+    /**
+     * \brief Sweep the whole grid in one of the 4 diagonal orderings
+     * \param ordering bit 0 set = right to left, bit 1 set = bottom to top
+     * \return true if at least one time decreased
+     */
+    bool sweep(int ordering, std::vector<float>& times) const;
+
+    /**
+     * \brief Iterations of the 4 orderings on the thread pool, each on its own copy of the times
+     */
+    void solveParallel(std::vector<float>& times);
+
+    int m_width;
+    int m_height;
+    const std::vector<std::uint8_t>* m_obstacles;
+    const std::vector<std::uint8_t>* m_terrainCosts;
+    int m_goalIndex;
+
+    bool m_isParallel;
+    ThreadPool* m_threadPool;
+    int m_iterationCount;
+
+    const std::atomic<bool>* m_cancelFlag;
+
+    // One copy of the times per sweep ordering when the sweeps run in parallel, kept between solves
+    std::vector<float> m_sweepTimes[4];
+};
+
+
+#endif //LAB6FLOWFIELD_EIKONALSOLVER_HPP
@@ -0,0 +1,1601 @@
+#include "FlowField.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+
+#include "ObstacleMap.hpp"
+#include "../Crowd/ThreadPool.hpp"
+#include "../Profiling/Profiler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LAB6FLOWFIELD_FLOWFIELD_SSE2
+#endif
+
+namespace
+{
+    // The 8 neighbours of a cell, in the same order as the 3x3 block around it (top-left to bottom-right)
+    constexpr int NeighbourCount = FlowField::NeighbourCount;
+    constexpr int NeighbourX[NeighbourCount] = {-1, 0, 1, -1, 1, -1, 0, 1};
+    constexpr int NeighbourY[NeighbourCount] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+    constexpr bool IsDiagonal[NeighbourCount] = {true, false, true, false, false, true, false, true};
+
+    // Flags used by the repair of the fields
+    enum RepairFlag : std::uint8_t
+    {
+        // The distance of the cell depended on a new obstacle and must be propagated again
+        Invalid = 1 << 0,
+        // The cell is already in the list of updated cells
+        Updated = 1 << 1,
+        // The parents of the cell have already been checked
+        Checked = 1 << 2
+    };
+
+    constexpr int MaxTerrainCost = 255;
+
+    // Number of cells visited by a search between two reads of the cancel flag, a power of 2
+    constexpr int CancelCheckInterval = 4096;
+
+    // Tasks of a parallel loop per thread, so the threads which finish first take the remaining ones
+    constexpr int TasksPerThread = 4;
+
+    // Below this number of cells, a level of the parallel search is cheaper to visit on the calling thread
+    constexpr size_t MinParallelLevelSize = 4096;
+
+    /**
+     * \brief Cost of a cell from its integration, for the integrators working on the terrain costs
+     */
+    int costFromIntegration(const int integration)
+    {
+        if (integration == FlowField::Unvisited || integration == FlowField::Impassable) return integration;
+
+        return integration / FlowField::StraightStepCost;
+    }
+
+    // Flags of a cell in the grids swept by the line of sight pass
+    constexpr std::uint8_t SightBlocker = 1;
+    constexpr std::uint8_t SightUnreachable = 2;
+    constexpr std::uint8_t SightSeen = 4;
+
+    // Side of the blocks of cells the line of sight pass transposes its grid by, and of the tiles of blocks it goes
+    // through so that the lines of the transposed grid are filled while in cache
+    constexpr int SightBlockSize = 8;
+    constexpr int SightTileSize = 64;
+
+    /**
+     * \brief Transpose a block of 8x8 bytes
+     */
+    void transposeBlock(const std::uint8_t* cells, const std::ptrdiff_t stride, std::uint8_t* transposed,
+                        const std::ptrdiff_t transposedStride)
+    {
+#ifdef LAB6FLOWFIELD_FLOWFIELD_SSE2
+        __m128i rows[SightBlockSize];
+        for (int y = 0; y < SightBlockSize; y++)
+        {
+            rows[y] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cells + stride * y));
+        }
+
+        // Interleaving the rows by bytes, then by pairs and by quads of them, leaves the columns in the low and high
+        // halves of 4 registers
+        __m128i pairs[4];
+        for (int i = 0; i < 4; i++)
+        {
+            pairs[i] = _mm_unpacklo_epi8(rows[2 * i], rows[2 * i + 1]);
+        }
+        const __m128i quads[4] = {
+            _mm_unpacklo_epi16(pairs[0], pairs[1]), _mm_unpackhi_epi16(pairs[0], pairs[1]),
+            _mm_unpacklo_epi16(pairs[2], pairs[3]), _mm_unpackhi_epi16(pairs[2], pairs[3])
+        };
+        const __m128i columnPairs[4] = {
+            _mm_unpacklo_epi32(quads[0], quads[2]), _mm_unpackhi_epi32(quads[0], quads[2]),
+            _mm_unpacklo_epi32(quads[1], quads[3]), _mm_unpackhi_epi32(quads[1], quads[3])
+        };
+
+        for (int x = 0; x < SightBlockSize; x++)
+        {
+            const __m128i columnPair = columnPairs[x / 2];
+            const __m128i column = x % 2 == 0 ? columnPair : _mm_unpackhi_epi64(columnPair, columnPair);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(transposed + transposedStride * x), column);
+        }
+#else
+        for (int x = 0; x < SightBlockSize; x++)
+        {
+            for (int y = 0; y < SightBlockSize; y++)
+            {
+                transposed[transposedStride * x + y] = cells[stride * y + x];
+            }
+        }
+#endif
+    }
+
+    /**
+     * \brief Transpose a grid of bytes
+     */
+    void transposeGrid(const std::uint8_t* cells, const int width, const int height, std::uint8_t* transposed)
+    {
+        const int blockWidth = width - width % SightBlockSize;
+        const int blockHeight = height - height % SightBlockSize;
+        for (int tileY = 0; tileY < blockHeight; tileY += SightTileSize)
+        {
+            for (int tileX = 0; tileX < blockWidth; tileX += SightTileSize)
+            {
+                for (int y = tileY; y < std::min(tileY + SightTileSize, blockHeight); y += SightBlockSize)
+                {
+                    for (int x = tileX; x < std::min(tileX + SightTileSize, blockWidth); x += SightBlockSize)
+                    {
+                        transposeBlock(cells + x + static_cast<std::ptrdiff_t>(width) * y, width,
+                                                 transposed + y + static_cast<std::ptrdiff_t>(height) * x, height);
+                    }
+                }
+            }
+        }
+
+        // The columns on the right and the rows at the bottom out of the blocks
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = y < blockHeight ? blockWidth : 0; x < width; x++)
+            {
+                transposed[y + static_cast<std::ptrdiff_t>(height) * x] =
+                    cells[x + static_cast<std::ptrdiff_t>(width) * y];
+            }
+        }
+    }
+
+    /**
+     * \brief First and last columns, at a depth of a quadrant, of the cells whose corners may span a slope of a range
+     * \details A cell spanning a slope s is at most one column away from s * depth.
+     */
+    void getWedgeColumns(const double lowSlope, const double highSlope, const int depth, int& firstColumn,
+                         int& lastColumn)
+    {
+        firstColumn = std::max(-depth, static_cast<int>(std::floor(lowSlope * depth)) - 1);
+        lastColumn = std::min(depth, static_cast<int>(std::ceil(highSlope * depth)) + 1);
+    }
+
+    /**
+     * \brief Whether a slope is lower than another one, both being fractions with a positive denominator
+     * \details Exact: the numerators and denominators are at most twice the size of the grid.
+     */
+    bool isLowerSlope(const int numerator, const int denominator, const int otherNumerator, const int otherDenominator)
+    {
+        return static_cast<std::int64_t>(numerator) * otherDenominator <
+               static_cast<std::int64_t>(otherNumerator) * denominator;
+    }
+}
+
+FlowField::FlowField(const int width, const int height, const float cellSize) :
+    m_width(width),
+    m_height(height),
+    m_cellSize(cellSize),
+    m_paddedWidth(width + 2),
+    m_goalIndex(0),
+    m_mapVersion(0),
+    m_obstacles(width * height, 0),
+    m_terrainCosts(width * height, 1),
+    m_paddedCosts((width + 2) * (height + 2), 0),
+    m_isBorder((width + 2) * (height + 2), 1),
+    m_integrator(Integrator::BreadthFirst),
+    m_instructionSet(VectorFieldKernel::getBestInstructionSet()),
+    m_costDistances((width + 2) * (height + 2), Impassable),
+    m_integrations((width + 2) * (height + 2), Impassable),
+    m_directionCodes(width * height, NoDirectionCode),
+    m_isCalculated(false),
+    m_cancelFlag(nullptr),
+    m_threadPool(nullptr),
+    m_bucketQueue(MaxTerrainCost * DiagonalStepCost),
+    m_repairFlags((width + 2) * (height + 2), 0),
+    m_isDirtyTracking(false),
+    m_isLineOfSightEnabled(false),
+    m_lineOfSight(width * height, 0),
+    m_sightGoalIndex(-1)
+{
+    for (int direction = 0; direction < NeighbourCount; direction++)
+    {
+        m_paddedOffsets[direction] = NeighbourX[direction] + m_paddedWidth * NeighbourY[direction];
+        m_offsets[direction] = NeighbourX[direction] + m_width * NeighbourY[direction];
+    }
+
+    // Only the border stays impassable
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const int padded = toPaddedIndex(toIndex(x, y));
+            m_paddedCosts[padded] = 1;
+            m_isBorder[padded] = 0;
+            m_costDistances[padded] = Unvisited;
+            m_integrations[padded] = Unvisited;
+        }
+    }
+
+    m_openList.reserve(width * height);
+}
+
+int FlowField::getWidth() const
+{
+    return m_width;
+}
+
+int FlowField::getHeight() const
+{
+    return m_height;
+}
+
+int FlowField::getCellCount() const
+{
+    return m_width * m_height;
+}
+
+float FlowField::getCellSize() const
+{
+    return m_cellSize;
+}
+
+bool FlowField::isInside(const int x, const int y) const
+{
+    return x >= 0 && x < m_width && y >= 0 && y < m_height;
+}
+
+int FlowField::toIndex(const int x, const int y) const
+{
+    return x + m_width * y;
+}
+
+void FlowField::setGoal(const int x, const int y)
+{
+    if (!isInside(x, y)) return;
+
+    m_goalIndex = toIndex(x, y);
+}
+
+int FlowField::getGoalIndex() const
+{
+    return m_goalIndex;
+}
+
+std::uint64_t FlowField::getMapVersion() const
+{
+    return m_mapVersion;
+}
+
+void FlowField::setObstacle(const int x, const int y, const bool isObstacle)
+{
+    if (!isInside(x, y)) return;
+
+    const std::uint8_t value = isObstacle ? 1 : 0;
+    std::uint8_t& obstacle = m_obstacles[toIndex(x, y)];
+    if (obstacle == value) return;
+
+    obstacle = value;
+    updatePaddedCost(toIndex(x, y));
+    m_mapVersion++;
+}
+
+bool FlowField::isObstacle(const int index) const
+{
+    return m_obstacles[index] != 0;
+}
+
+void FlowField::clearObstacles()
+{
+    std::fill(m_obstacles.begin(), m_obstacles.end(), 0);
+    for (int i = 0; i < getCellCount(); i++)
+    {
+        updatePaddedCost(i);
+    }
+    m_mapVersion++;
+}
+
+void FlowField::setObstacles(const ObstacleMap& obstacles)
+{
+    setObstacles(obstacles.getRow(0));
+}
+
+void FlowField::setObstacles(const std::uint64_t* rows)
+{
+    const int rowWordCount = (m_width + 63) / 64;
+
+    bool isChanged = false;
+    for (int y = 0; y < m_height; y++)
+    {
+        const std::uint64_t* row = rows + rowWordCount * y;
+        for (int x = 0; x < m_width; x++)
+        {
+            const std::uint8_t value = row[x / 64] >> (x % 64) & 1;
+            std::uint8_t& obstacle = m_obstacles[toIndex(x, y)];
+            if (obstacle == value) continue;
+
+            obstacle = value;
+            updatePaddedCost(toIndex(x, y));
+            isChanged = true;
+        }
+    }
+
+    if (isChanged) m_mapVersion++;
+}
+
+void FlowField::setTerrainCost(const int x, const int y, const std::uint8_t cost)
+{
+    if (!isInside(x, y)) return;
+
+    const std::uint8_t value = std::max<std::uint8_t>(cost, 1);
+    std::uint8_t& terrainCost = m_terrainCosts[toIndex(x, y)];
+    if (terrainCost == value) return;
+
+    terrainCost = value;
+    updatePaddedCost(toIndex(x, y));
+    m_mapVersion++;
+}
+
+void FlowField::setTerrainCosts(const std::uint8_t* costs)
+{
+    bool isChanged = false;
+    for (int i = 0; i < getCellCount(); i++)
+    {
+        const std::uint8_t value = std::max<std::uint8_t>(costs[i], 1);
+        if (m_terrainCosts[i] == value) continue;
+
+        m_terrainCosts[i] = value;
+        updatePaddedCost(i);
+        isChanged = true;
+    }
+
+    if (isChanged) m_mapVersion++;
+}
+
+std::uint8_t FlowField::getTerrainCost(const int index) const
+{
+    return m_terrainCosts[index];
+}
+
+void FlowField::clearTerrainCosts()
+{
+    std::fill(m_terrainCosts.begin(), m_terrainCosts.end(), 1);
+    for (int i = 0; i < getCellCount(); i++)
+    {
+        updatePaddedCost(i);
+    }
+    m_mapVersion++;
+}
+
+void FlowField::setIntegrator(const Integrator integrator)
+{
+    m_integrator = integrator;
+}
+
+FlowField::Integrator FlowField::getIntegrator() const
+{
+    return m_integrator;
+}
+
+void FlowField::setInstructionSet(const VectorFieldKernel::InstructionSet set)
+{
+    m_instructionSet = VectorFieldKernel::isSupported(set) ? set : VectorFieldKernel::getBestInstructionSet();
+}
+
+VectorFieldKernel::InstructionSet FlowField::getInstructionSet() const
+{
+    return m_instructionSet;
+}
+
+void FlowField::setLineOfSightEnabled(const bool isEnabled)
+{
+    m_isLineOfSightEnabled = isEnabled;
+
+    // Marked again by the next calculation or repair once enabled
+    if (!isEnabled)
+    {
+        std::fill(m_lineOfSight.begin(), m_lineOfSight.end(), 0);
+        m_sightGoalIndex = -1;
+    }
+}
+
+bool FlowField::isLineOfSightEnabled() const
+{
+    return m_isLineOfSightEnabled;
+}
+
+void FlowField::setThreadPool(ThreadPool* pool)
+{
+    m_threadPool = pool;
+    m_eikonalSolver.setThreadPool(pool);
+}
+
+bool FlowField::isParallelSearch() const
+{
+    return m_threadPool != nullptr && m_threadPool->getThreadCount() > 1 && getCellCount() >= ParallelSearchMinCellCount;
+}
+
+void FlowField::calculate()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::calculate");
+
+    m_isCalculated = false;
+
+    // resetFields() overwrites every value, the current fields can become the previous ones without a copy
+    if (m_isDirtyTracking)
+    {
+        m_costDistances.swap(m_previousCostDistances);
+        m_integrations.swap(m_previousIntegrations);
+        m_directionCodes.swap(m_previousDirectionCodes);
+    }
+
+    resetFields();
+
+    switch (m_integrator)
+    {
+    case Integrator::BreadthFirst:
+        createCostField();
+        createIntegrationField();
+        break;
+    case Integrator::Weighted:
+        createWeightedIntegrationField();
+        break;
+    case Integrator::Eikonal:
+        createEikonalIntegrationField();
+        break;
+    }
+
+    if (isCancelled())
+    {
+        restorePreviousFields();
+        return;
+    }
+
+    computeVectorField();
+
+    if (isCancelled())
+    {
+        restorePreviousFields();
+        return;
+    }
+
+    if (m_isLineOfSightEnabled) computeLineOfSight();
+
+    if (m_isDirtyTracking)
+    {
+        markChangedCellsDirty(m_previousCostDistances, m_previousIntegrations, m_previousDirectionCodes);
+    }
+
+    m_isCalculated = true;
+}
+
+void FlowField::restorePreviousFields()
+{
+    if (!m_isDirtyTracking) return;
+
+    m_costDistances.swap(m_previousCostDistances);
+    m_integrations.swap(m_previousIntegrations);
+    m_directionCodes.swap(m_previousDirectionCodes);
+}
+
+bool FlowField::isCalculated() const
+{
+    return m_isCalculated;
+}
+
+void FlowField::setCancelFlag(const std::atomic<bool>* isCancelled)
+{
+    m_cancelFlag = isCancelled;
+    m_eikonalSolver.setCancelFlag(isCancelled);
+}
+
+void FlowField::copyMap(const FlowField& other)
+{
+    // Same size, nothing is allocated
+    m_obstacles = other.m_obstacles;
+    m_terrainCosts = other.m_terrainCosts;
+    m_paddedCosts = other.m_paddedCosts;
+    m_mapVersion = other.m_mapVersion;
+}
+
+void FlowField::swapFields(FlowField& other)
+{
+    m_costDistances.swap(other.m_costDistances);
+    m_integrations.swap(other.m_integrations);
+    m_directionCodes.swap(other.m_directionCodes);
+    m_lineOfSight.swap(other.m_lineOfSight);
+    m_sightFlags.swap(other.m_sightFlags);
+    m_transposedSight.swap(other.m_transposedSight);
+    std::swap(m_sightGoalIndex, other.m_sightGoalIndex);
+    std::swap(m_goalIndex, other.m_goalIndex);
+    std::swap(m_integrator, other.m_integrator);
+    std::swap(m_isCalculated, other.m_isCalculated);
+
+    if (m_isDirtyTracking)
+    {
+        markChangedCellsDirty(other.m_costDistances, other.m_integrations, other.m_directionCodes);
+    }
+}
+
+int FlowField::updateObstacle(const int x, const int y, const bool isObstacle)
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::updateObstacle");
+
+    m_updatedCells.clear();
+    if (!isInside(x, y)) return 0;
+
+    const int index = toIndex(x, y);
+    if (this->isObstacle(index) == isObstacle) return 0;
+
+    if (!m_isCalculated)
+    {
+        setObstacle(x, y, isObstacle);
+        return 0;
+    }
+
+    // The goal is the source of every cost, changing it means calculating everything again
+    if (index == m_goalIndex || m_integrator == Integrator::Eikonal)
+    {
+        setObstacle(x, y, isObstacle);
+        calculate();
+
+        for (int i = 0; i < getCellCount(); i++)
+        {
+            m_updatedCells.push_back(i);
+        }
+
+        return getCellCount();
+    }
+
+    m_repairedCells.clear();
+
+    if (isObstacle)
+    {
+        repairAddedObstacle(index);
+    }
+    else
+    {
+        repairRemovedObstacle(index);
+    }
+
+    refreshRepairedCells();
+
+    // The obstacle may hide or reveal the cells behind it, the flags of the other cells are still the ones swept
+    if (m_isLineOfSightEnabled)
+    {
+        if (m_sightGoalIndex == m_goalIndex)
+        {
+            updateLineOfSight(index);
+        }
+        else
+        {
+            computeLineOfSight();
+        }
+    }
+
+    return static_cast<int>(m_updatedCells.size());
+}
+
+const std::vector<int>& FlowField::getUpdatedCells() const
+{
+    return m_updatedCells;
+}
+
+void FlowField::setDirtyTracking(const bool isEnabled)
+{
+    m_isDirtyTracking = isEnabled;
+
+    m_dirtyCells.clear();
+    if (isEnabled)
+    {
+        // Copied rather than resized, so the padded border is Impassable like in the current fields
+        m_isDirty.assign(getCellCount(), 0);
+        m_previousCostDistances = m_costDistances;
+        m_previousIntegrations = m_integrations;
+        m_previousDirectionCodes = m_directionCodes;
+    }
+    else
+    {
+        m_isDirty = {};
+        m_previousCostDistances = {};
+        m_previousIntegrations = {};
+        m_previousDirectionCodes = {};
+    }
+}
+
+bool FlowField::isDirtyTracking() const
+{
+    return m_isDirtyTracking;
+}
+
+const std::vector<int>& FlowField::getDirtyCells() const
+{
+    return m_dirtyCells;
+}
+
+bool FlowField::isDirty(const int index) const
+{
+    return m_isDirtyTracking && m_isDirty[index];
+}
+
+void FlowField::clearDirtyCells()
+{
+    for (const int cell : m_dirtyCells)
+    {
+        m_isDirty[cell] = 0;
+    }
+    m_dirtyCells.clear();
+}
+
+int FlowField::getCostDistance(const int index) const
+{
+    return m_costDistances[toPaddedIndex(index)];
+}
+
+int FlowField::getIntegration(const int index) const
+{
+    return m_integrations[toPaddedIndex(index)];
+}
+
+FlowField::Direction FlowField::getDirection(const int index) const
+{
+    return decodeDirection(m_directionCodes[index]);
+}
+
+std::uint8_t FlowField::getDirectionCode(const int index) const
+{
+    return m_directionCodes[index];
+}
+
+const std::vector<std::uint8_t>& FlowField::getDirectionCodes() const
+{
+    return m_directionCodes;
+}
+
+bool FlowField::hasLineOfSight(const int index) const
+{
+    return m_lineOfSight[index] != 0;
+}
+
+const std::vector<std::uint8_t>& FlowField::getLineOfSight() const
+{
+    return m_lineOfSight;
+}
+
+int FlowField::getNextIndex(const int index) const
+{
+    const std::uint8_t code = m_directionCodes[index];
+    if (code == NoDirectionCode) return -1;
+
+    return index + m_offsets[code];
+}
+
+int FlowField::getNextIndex(const int index, const std::uint8_t code, const int width)
+{
+    if (code == NoDirectionCode) return -1;
+
+    return index + NeighbourX[code] + width * NeighbourY[code];
+}
+
+FlowField::Direction FlowField::sampleDirection(const float gridX, const float gridY) const
+{
+    return sampleDirections(m_width, m_height, gridX, gridY, [this](const int index)
+    {
+        return decodeDirection(m_directionCodes[index]);
+    });
+}
+
+FlowField::Direction FlowField::getSteeringDirection(const float gridX, const float gridY) const
+{
+    // The cell the position is in, its center being at integer grid coordinates
+    const int x = static_cast<int>(std::round(gridX));
+    const int y = static_cast<int>(std::round(gridY));
+    if (isInside(x, y) && m_lineOfSight[toIndex(x, y)])
+    {
+        return {static_cast<float>(m_goalIndex % m_width) - gridX, static_cast<float>(m_goalIndex / m_width) - gridY};
+    }
+
+    return sampleDirection(gridX, gridY);
+}
+
+std::uint8_t FlowField::encodeDirection(const Direction direction)
+{
+    if (direction.x == 0 && direction.y == 0) return NoDirectionCode;
+
+    // Position of the neighbour in the 3x3 block, the cell itself (4) being skipped by the neighbour order
+    const int stepX = (direction.x > 0) - (direction.x < 0);
+    const int stepY = (direction.y > 0) - (direction.y < 0);
+    const int block = stepX + 1 + 3 * (stepY + 1);
+
+    return static_cast<std::uint8_t>(block < 4 ? block : block - 1);
+}
+
+void FlowField::resetFields()
+{
+    // The border is never written, it stays Impassable. The width is a local, so the stores cannot alias it.
+    const int width = m_width;
+    for (int y = 0; y < m_height; y++)
+    {
+        const int index = toIndex(0, y);
+        const int padded = toPaddedIndex(index);
+        const std::uint8_t* obstacles = &m_obstacles[index];
+        int* costDistances = &m_costDistances[padded];
+        int* integrations = &m_integrations[padded];
+        std::uint8_t* directionCodes = &m_directionCodes[index];
+
+        for (int x = 0; x < width; x++)
+        {
+            const int value = obstacles[x] ? Impassable : Unvisited;
+            costDistances[x] = value;
+            integrations[x] = value;
+            directionCodes[x] = NoDirectionCode;
+        }
+    }
+}
+
+void FlowField::createCostField()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::createCostField");
+
+    if (isParallelSearch())
+    {
+        createCostFieldParallel();
+        return;
+    }
+
+    const int goal = toPaddedIndex(m_goalIndex);
+    m_costDistances[goal] = 0;
+
+    // The open list is used as a FIFO queue, "head" being the next cell to visit
+    m_openList.clear();
+    m_openList.push_back(goal);
+
+    for (size_t head = 0; head < m_openList.size(); head++)
+    {
+        if (head % CancelCheckInterval == 0 && isCancelled()) return;
+
+        const int current = m_openList[head];
+        const int nextCost = m_costDistances[current] + 1;
+
+        // The border is Impassable, so it is never visited
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int neighbour = current + m_paddedOffsets[direction];
+            if (m_costDistances[neighbour] == Unvisited)
+            {
+                m_costDistances[neighbour] = nextCost;
+                m_openList.push_back(neighbour);
+            }
+        }
+    }
+}
+
+void FlowField::createCostFieldParallel()
+{
+    const int taskCount = m_threadPool->getThreadCount() * TasksPerThread;
+    const size_t paddedCount = m_costDistances.size();
+    const size_t wordCount = (paddedCount + 63) / 64;
+    m_visitedWords.resize(wordCount);
+    m_levelBuffers.resize(taskCount);
+
+    // The cells which are not Unvisited (obstacles and the border) are never entered, like already visited cells
+    const auto markTask = [this, taskCount, paddedCount, wordCount](const int task)
+    {
+        const size_t lastWord = wordCount * (task + 1) / taskCount;
+        for (size_t word = wordCount * task / taskCount; word < lastWord; word++)
+        {
+            const size_t first = word * 64;
+            const size_t last = std::min(first + 64, paddedCount);
+            std::uint64_t bits = 0;
+            for (size_t i = first; i < last; i++)
+            {
+                if (m_costDistances[i] != Unvisited) bits |= std::uint64_t{1} << (i - first);
+            }
+            m_visitedWords[word].bits.store(bits, std::memory_order_relaxed);
+        }
+    };
+
+    // Passed by reference, the captures do not fit in a std::function without an allocation
+    m_threadPool->run(taskCount, std::cref(markTask));
+
+    const int goal = toPaddedIndex(m_goalIndex);
+    m_costDistances[goal] = 0;
+    m_visitedWords[goal / 64].bits.fetch_or(std::uint64_t{1} << (goal % 64), std::memory_order_relaxed);
+
+    // The open list holds the cells of the current level
+    m_openList.clear();
+    m_openList.push_back(goal);
+
+    size_t levelSize = 0;
+    int nextCost = 0;
+    const auto levelTask = [this, taskCount, &levelSize, &nextCost](const int task)
+    {
+        std::vector<int>& nextLevel = m_levelBuffers[task];
+        nextLevel.clear();
+        expandLevel(levelSize * task / taskCount, levelSize * (task + 1) / taskCount, nextCost, nextLevel);
+    };
+
+    for (nextCost = 1; !m_openList.empty(); nextCost++)
+    {
+        if (isCancelled()) return;
+
+        levelSize = m_openList.size();
+        int usedBufferCount = 1;
+        if (levelSize < MinParallelLevelSize)
+        {
+            m_levelBuffers[0].clear();
+            expandLevel(0, levelSize, nextCost, m_levelBuffers[0]);
+        }
+        else
+        {
+            usedBufferCount = taskCount;
+            m_threadPool->run(taskCount, std::cref(levelTask));
+        }
+
+        m_openList.clear();
+        for (int i = 0; i < usedBufferCount; i++)
+        {
+            m_openList.insert(m_openList.end(), m_levelBuffers[i].begin(), m_levelBuffers[i].end());
+        }
+    }
+}
+
+void FlowField::expandLevel(const size_t first, const size_t last, const int nextCost, std::vector<int>& nextLevel)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        const int current = m_openList[i];
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int neighbour = current + m_paddedOffsets[direction];
+            std::atomic<std::uint64_t>& word = m_visitedWords[neighbour / 64].bits;
+            const std::uint64_t bit = std::uint64_t{1} << (neighbour % 64);
+
+            // Only the thread which sets the bit writes the cost, every thread reaching the cell would write the same
+            if (word.load(std::memory_order_relaxed) & bit) continue;
+            if (word.fetch_or(bit, std::memory_order_relaxed) & bit) continue;
+
+            m_costDistances[neighbour] = nextCost;
+            nextLevel.push_back(neighbour);
+        }
+    }
+}
+
+void FlowField::createIntegrationField()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::createIntegrationField");
+
+    // Every cell reached by the cost field is reached by the integration field, so a linear pass over the
+    // arrays gives the same result as a second breadth-first search
+    const auto integrateRows = [this](const int firstY, const int lastY)
+    {
+        for (int y = firstY; y < lastY; y++)
+        {
+            int padded = toPaddedIndex(toIndex(0, y));
+            for (int x = 0; x < m_width; x++, padded++)
+            {
+                m_integrations[padded] = computeIntegration(m_costDistances[padded], x, y);
+            }
+        }
+    };
+
+    if (!isParallelSearch())
+    {
+        integrateRows(0, m_height);
+        return;
+    }
+
+    // Each cell only depends on its own cost
+    const int taskCount = m_threadPool->getThreadCount() * TasksPerThread;
+    const auto integrateTask = [this, taskCount, &integrateRows](const int task)
+    {
+        integrateRows(m_height * task / taskCount, m_height * (task + 1) / taskCount);
+    };
+    m_threadPool->run(taskCount, std::cref(integrateTask));
+}
+
+void FlowField::createWeightedIntegrationField()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::createWeightedIntegrationField");
+
+    const int goal = toPaddedIndex(m_goalIndex);
+    m_integrations[goal] = 0;
+
+    m_bucketQueue.clear();
+    m_bucketQueue.push(0, goal);
+
+    int distance;
+    int current;
+    for (int popCount = 0; m_bucketQueue.pop(distance, current); popCount++)
+    {
+        if (popCount % CancelCheckInterval == 0 && isCancelled()) return;
+
+        // Stale entry, the cell has been reached with a lower distance since it was pushed
+        if (distance != m_integrations[current]) continue;
+
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            // Obstacles and the border cost 0, they cannot be entered
+            const int neighbour = current + m_paddedOffsets[direction];
+            const int terrainCost = m_paddedCosts[neighbour];
+            if (terrainCost == 0) continue;
+
+            const int stepCost = IsDiagonal[direction] ? DiagonalStepCost : StraightStepCost;
+            const int neighbourDistance = distance + terrainCost * stepCost;
+            const int integration = m_integrations[neighbour];
+            if (integration == Unvisited || neighbourDistance < integration)
+            {
+                m_integrations[neighbour] = neighbourDistance;
+                m_bucketQueue.push(neighbourDistance, neighbour);
+            }
+        }
+    }
+
+    deriveCostsFromIntegrations();
+}
+
+void FlowField::createEikonalIntegrationField()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::createEikonalIntegrationField");
+
+    m_eikonalSolver.solve(m_width, m_height, m_obstacles, m_terrainCosts, m_goalIndex, m_eikonalTimes);
+
+    const int cellCount = getCellCount();
+    for (int i = 0; i < cellCount; i++)
+    {
+        if (m_obstacles[i] && i != m_goalIndex) continue;
+
+        const float time = m_eikonalTimes[i];
+        m_integrations[toPaddedIndex(i)] = std::isinf(time) ? Unvisited
+                                                            : static_cast<int>(std::lround(time * StraightStepCost));
+    }
+
+    deriveCostsFromIntegrations();
+}
+
+EikonalSolver& FlowField::getEikonalSolver()
+{
+    return m_eikonalSolver;
+}
+
+void FlowField::deriveCostsFromIntegrations()
+{
+    // The border stays Impassable
+    const size_t paddedCount = m_integrations.size();
+    for (size_t i = 0; i < paddedCount; i++)
+    {
+        m_costDistances[i] = costFromIntegration(m_integrations[i]);
+    }
+}
+
+void FlowField::computeVectorField()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::computeVectorField");
+
+    for (int y = 0; y < m_height; y++)
+    {
+        if (isCancelled()) return;
+
+        const int index = toIndex(0, y);
+        VectorFieldKernel::computeRow(m_instructionSet, m_costDistances.data(), m_integrations.data(),
+                                      m_paddedOffsets, toPaddedIndex(index), m_width, &m_directionCodes[index]);
+    }
+}
+
+void FlowField::computeLineOfSight()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::computeLineOfSight");
+
+    // No field from an obstacle
+    if (m_costDistances[toPaddedIndex(m_goalIndex)] != 0)
+    {
+        std::fill(m_lineOfSight.begin(), m_lineOfSight.end(), 0);
+        m_sightGoalIndex = -1;
+        return;
+    }
+
+    // The bytes written would alias the members, the loops only go through local pointers
+    const std::uint8_t* obstacles = m_obstacles.data();
+    const std::uint8_t* terrainCosts = m_terrainCosts.data();
+    const std::uint8_t goalTerrainCost = m_terrainCosts[m_goalIndex];
+    // The straight line is only the shortest path through a uniform terrain, the BreadthFirst integrator ignores it
+    const bool isTerrainBlocking = m_integrator != Integrator::BreadthFirst;
+    m_sightFlags.resize(m_lineOfSight.size());
+    std::uint8_t* flags = m_sightFlags.data();
+    for (int y = 0; y < m_height; y++)
+    {
+        const int* costs = m_costDistances.data() + toPaddedIndex(toIndex(0, y));
+        const int row = toIndex(0, y);
+        for (int x = 0; x < m_width; x++)
+        {
+            const int index = row + x;
+            const bool isBlocker = obstacles[index] || (isTerrainBlocking && terrainCosts[index] != goalTerrainCost);
+            flags[index] = isBlocker ? SightBlocker : costs[x] == Unvisited ? SightUnreachable : 0;
+        }
+    }
+
+    // The east and west quadrants are swept in the transposed grid, where their rows are consecutive cells too
+    m_transposedSight.resize(m_lineOfSight.size());
+    std::uint8_t* transposed = m_transposedSight.data();
+    transposeGrid(flags, m_width, m_height, transposed);
+
+    const int goalX = m_goalIndex % m_width;
+    const int goalY = m_goalIndex / m_width;
+    const SightWedge quadrant = {-1, 1, 1};
+    sweepLineOfSight(flags, m_width, m_height, goalX, goalY, 1, quadrant);
+    sweepLineOfSight(flags, m_width, m_height, goalX, goalY, -1, quadrant);
+    sweepLineOfSight(transposed, m_height, m_width, goalY, goalX, 1, quadrant);
+    sweepLineOfSight(transposed, m_height, m_width, goalY, goalX, -1, quadrant);
+
+    // A cell is only in one quadrant, except on the diagonals where it must be seen in both
+    std::uint8_t* sight = m_lineOfSight.data();
+    transposeGrid(transposed, m_height, m_width, sight);
+    const int cellCount = m_width * m_height;
+    for (int i = 0; i < cellCount; i++)
+    {
+        sight[i] = ((flags[i] | sight[i]) & SightSeen) != 0 ? 1 : 0;
+    }
+
+    for (int diagonal = 0; diagonal < 4; diagonal++)
+    {
+        const int stepX = diagonal % 2 == 0 ? 1 : -1;
+        const int stepY = diagonal < 2 ? 1 : -1;
+        for (int x = goalX + stepX, y = goalY + stepY; isInside(x, y); x += stepX, y += stepY)
+        {
+            refreshLineOfSight(x, y);
+        }
+    }
+
+    m_lineOfSight[m_goalIndex] = 1;
+    m_sightGoalIndex = m_goalIndex;
+}
+
+void FlowField::updateLineOfSight(const int index)
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("FlowField::updateLineOfSight");
+
+    const int goalX = m_goalIndex % m_width;
+    const int goalY = m_goalIndex / m_width;
+    const int x = index % m_width;
+    const int y = index / m_width;
+
+    // Flags of the obstacle and of the repaired cells. The ones still walkable and reachable keep whether they were
+    // seen, the sweeps below mark them again if they are in a wedge.
+    const std::uint8_t goalTerrainCost = m_terrainCosts[m_goalIndex];
+    const bool isTerrainBlocking = m_integrator != Integrator::BreadthFirst;
+    const auto updateFlags = [&](const int cell)
+    {
+        const bool isBlocker = m_obstacles[cell] || (isTerrainBlocking && m_terrainCosts[cell] != goalTerrainCost);
+        const std::uint8_t flags = isBlocker ? SightBlocker
+                                   : m_costDistances[toPaddedIndex(cell)] == Unvisited ? SightUnreachable
+                                   : 0;
+
+        const int cellX = cell % m_width;
+        const int cellY = cell / m_width;
+        std::uint8_t& cellFlags = m_sightFlags[cell];
+        std::uint8_t& transposedFlags = m_transposedSight[cellY + static_cast<std::ptrdiff_t>(m_height) * cellX];
+        cellFlags = flags != 0 ? flags : cellFlags & SightSeen;
+        transposedFlags = flags != 0 ? flags : transposedFlags & SightSeen;
+
+        refreshLineOfSight(cellX, cellY);
+    };
+    updateFlags(index);
+    for (const int cell : m_updatedCells)
+    {
+        updateFlags(cell);
+    }
+
+    // The north and south quadrants in the grid, the east and west ones in the transposed grid
+    for (int quadrant = 0; quadrant < 4; quadrant++)
+    {
+        const bool isVertical = quadrant < 2;
+        const int depthStep = quadrant % 2 == 0 ? 1 : -1;
+        const int depth = (isVertical ? y - goalY : x - goalX) * depthStep;
+        const int column = isVertical ? x - goalX : y - goalY;
+        if (depth < 1 || std::abs(column) > depth) continue;
+
+        const SightWedge wedge = {
+            (2.0 * column - 1) / (column > 0 ? 2 * depth + 1 : 2 * depth - 1),
+            (2.0 * column + 1) / (column < 0 ? 2 * depth + 1 : 2 * depth - 1),
+            depth
+        };
+        const int maxDepth = isVertical ? (depthStep > 0 ? m_height - 1 - goalY : goalY)
+                                        : (depthStep > 0 ? m_width - 1 - goalX : goalX);
+        const int minColumn = isVertical ? -goalX : -goalY;
+        const int maxColumn = isVertical ? m_width - 1 - goalX : m_height - 1 - goalY;
+        const auto forEachWedgeCell = [&](const auto& visit)
+        {
+            for (int wedgeDepth = wedge.firstDepth; wedgeDepth <= maxDepth; wedgeDepth++)
+            {
+                int firstColumn;
+                int lastColumn;
+                getWedgeColumns(wedge.lowSlope, wedge.highSlope, wedgeDepth, firstColumn, lastColumn);
+                for (int wedgeColumn = std::max(firstColumn, minColumn);
+                     wedgeColumn <= std::min(lastColumn, maxColumn); wedgeColumn++)
+                {
+                    if (isVertical)
+                    {
+                        visit(goalX + wedgeColumn, goalY + depthStep * wedgeDepth);
+                    }
+                    else
+                    {
+                        visit(goalX + depthStep * wedgeDepth, goalY + wedgeColumn);
+                    }
+                }
+            }
+        };
+
+        // The sweep only flags the cells seen
+        std::vector<std::uint8_t>& flags = isVertical ? m_sightFlags : m_transposedSight;
+        forEachWedgeCell([this, &flags, isVertical](const int cellX, const int cellY)
+        {
+            flags[isVertical ? toIndex(cellX, cellY) : cellY + static_cast<std::ptrdiff_t>(m_height) * cellX] &=
+                ~SightSeen;
+        });
+
+        if (isVertical)
+        {
+            sweepLineOfSight(m_sightFlags.data(), m_width, m_height, goalX, goalY, depthStep, wedge);
+        }
+        else
+        {
+            sweepLineOfSight(m_transposedSight.data(), m_height, m_width, goalY, goalX, depthStep, wedge);
+        }
+
+        forEachWedgeCell([this](const int cellX, const int cellY)
+        {
+            refreshLineOfSight(cellX, cellY);
+        });
+    }
+}
+
+void FlowField::refreshLineOfSight(const int x, const int y)
+{
+    const int index = toIndex(x, y);
+    if (index == m_goalIndex)
+    {
+        m_lineOfSight[index] = 1;
+        return;
+    }
+
+    const int seenCount = (m_sightFlags[index] & SightSeen ? 1 : 0) +
+                          (m_transposedSight[y + static_cast<std::ptrdiff_t>(m_height) * x] & SightSeen ? 1 : 0);
+    const bool isDiagonal = std::abs(x - m_goalIndex % m_width) == std::abs(y - m_goalIndex / m_width);
+    m_lineOfSight[index] = seenCount == (isDiagonal ? 2 : 1) ? 1 : 0;
+}
+
+void FlowField::sweepLineOfSight(std::uint8_t* cells, const int width, const int height, const int goalX,
+                                 const int goalY, const int depthStep, const SightWedge& wedge)
+{
+    // Depth: distance from the goal along the axis of the quadrant, column: offset across it
+    const int maxDepth = depthStep > 0 ? height - 1 - goalY : goalY;
+    const int minColumn = -goalX;
+    const int maxColumn = width - 1 - goalX;
+
+    // The cells which can hide a cell of the wedge span its slopes, widened by the widest cell of the wedge: a cell at
+    // most one column away from a slope spans slopes at most 6 / (2 * depth - 1) away from it
+    const double margin = 6.0 / (2 * wedge.firstDepth - 1);
+    const double sweptLowSlope = std::max(-1.0, wedge.lowSlope - margin);
+    const double sweptHighSlope = std::min(1.0, wedge.highSlope + margin);
+
+    m_shadows.clear();
+    for (int depth = 1; depth <= maxDepth; depth++)
+    {
+        // The shadows are sorted and disjoint, one hiding the whole quadrant (slopes -1 to 1) is the first one
+        if (!m_shadows.empty() && !isLowerSlope(-1, 1, m_shadows[0].lowNumerator, m_shadows[0].lowDenominator) &&
+            !isLowerSlope(m_shadows[0].highNumerator, m_shadows[0].highDenominator, 1, 1))
+        {
+            return;
+        }
+
+        // Cells of the row by column
+        std::uint8_t* row = cells + static_cast<std::ptrdiff_t>(goalY + depthStep * depth) * width + goalX;
+
+        int firstColumn;
+        int lastColumn;
+        getWedgeColumns(sweptLowSlope, sweptHighSlope, depth, firstColumn, lastColumn);
+        int firstWedgeColumn;
+        int lastWedgeColumn;
+        getWedgeColumns(wedge.lowSlope, wedge.highSlope, depth, firstWedgeColumn, lastWedgeColumn);
+        if (depth < wedge.firstDepth) lastWedgeColumn = firstWedgeColumn - 1;
+
+        m_rowShadows.clear();
+        size_t shadow = 0;
+        for (int column = std::max(firstColumn, minColumn); column <= std::min(lastColumn, maxColumn); column++)
+        {
+            // Slopes of the corners of the cell, from the center of the goal
+            const int lowNumerator = 2 * column - 1;
+            const int lowDenominator = column > 0 ? 2 * depth + 1 : 2 * depth - 1;
+            const int highNumerator = 2 * column + 1;
+            const int highDenominator = column < 0 ? 2 * depth + 1 : 2 * depth - 1;
+
+            if (row[column] & SightBlocker)
+            {
+                m_rowShadows.push_back({lowNumerator, lowDenominator, highNumerator, highDenominator});
+                continue;
+            }
+
+            if ((row[column] & SightUnreachable) || column < firstWedgeColumn || column > lastWedgeColumn) continue;
+
+            bool isSeen = true;
+            if (shadow < m_shadows.size())
+            {
+                // The part of a cell on a diagonal outside the quadrant is checked by the other quadrant
+                const bool isLowClipped = isLowerSlope(lowNumerator, lowDenominator, -1, 1);
+                const bool isHighClipped = isLowerSlope(1, 1, highNumerator, highDenominator);
+                const int clippedLowNumerator = isLowClipped ? -1 : lowNumerator;
+                const int clippedLowDenominator = isLowClipped ? 1 : lowDenominator;
+                const int clippedHighNumerator = isHighClipped ? 1 : highNumerator;
+                const int clippedHighDenominator = isHighClipped ? 1 : highDenominator;
+
+                // The cells of a row are in increasing order of slopes, the shadows ending before this cell are behind
+                while (shadow < m_shadows.size() &&
+                       !isLowerSlope(clippedLowNumerator, clippedLowDenominator, m_shadows[shadow].highNumerator,
+                                     m_shadows[shadow].highDenominator))
+                {
+                    shadow++;
+                }
+
+                isSeen = shadow == m_shadows.size() ||
+                         !isLowerSlope(m_shadows[shadow].lowNumerator, m_shadows[shadow].lowDenominator,
+                                       clippedHighNumerator, clippedHighDenominator);
+            }
+
+            // On the same row, the lines to the corners of the cell only cross its neighbour closer to the axis
+            if (isSeen && column != 0)
+            {
+                isSeen = (row[column > 0 ? column - 1 : column + 1] & SightBlocker) == 0;
+            }
+
+            if (isSeen) row[column] |= SightSeen;
+        }
+
+        if (m_rowShadows.empty()) continue;
+
+        // Merge the shadows of the row with the previous ones, the overlapping and touching ones becoming one
+        m_mergedShadows.clear();
+        size_t previous = 0;
+        size_t current = 0;
+        while (previous < m_shadows.size() || current < m_rowShadows.size())
+        {
+            const bool isPrevious = current == m_rowShadows.size() ||
+                                    (previous < m_shadows.size() &&
+                                     isLowerSlope(m_shadows[previous].lowNumerator, m_shadows[previous].lowDenominator,
+                                                  m_rowShadows[current].lowNumerator,
+                                                  m_rowShadows[current].lowDenominator));
+            const Shadow& next = isPrevious ? m_shadows[previous++] : m_rowShadows[current++];
+
+            if (m_mergedShadows.empty() ||
+                isLowerSlope(m_mergedShadows.back().highNumerator, m_mergedShadows.back().highDenominator,
+                             next.lowNumerator, next.lowDenominator))
+            {
+                m_mergedShadows.push_back(next);
+            }
+            else if (isLowerSlope(m_mergedShadows.back().highNumerator, m_mergedShadows.back().highDenominator,
+                                  next.highNumerator, next.highDenominator))
+            {
+                m_mergedShadows.back().highNumerator = next.highNumerator;
+                m_mergedShadows.back().highDenominator = next.highDenominator;
+            }
+        }
+        m_shadows.swap(m_mergedShadows);
+    }
+}
+
+void FlowField::computeDirection(const int index, const int padded)
+{
+    m_directionCodes[index] = VectorFieldKernel::computeCell(m_costDistances.data(), m_integrations.data(),
+                                                             m_paddedOffsets, padded);
+}
+
+int FlowField::computeIntegration(const int cost, const int x, const int y) const
+{
+    if (cost == Unvisited || cost == Impassable) return cost;
+
+    const int goalX = m_goalIndex % m_width;
+    const int goalY = m_goalIndex / m_width;
+    const float offsetX = static_cast<float>(x - goalX) * m_cellSize;
+    const float offsetY = static_cast<float>(y - goalY) * m_cellSize;
+    const int distance = static_cast<int>(std::sqrt(offsetX * offsetX + offsetY * offsetY));
+
+    return cost * 100 + distance;
+}
+
+int FlowField::toPaddedIndex(const int index) const
+{
+    // One more cell on the left and on the right of each row, and one more row on top
+    return index + 2 * (index / m_width) + m_paddedWidth + 1;
+}
+
+int FlowField::fromPaddedIndex(const int padded) const
+{
+    return toIndex(padded % m_paddedWidth - 1, padded / m_paddedWidth - 1);
+}
+
+void FlowField::updatePaddedCost(const int index)
+{
+    m_paddedCosts[toPaddedIndex(index)] = m_obstacles[index] ? 0 : m_terrainCosts[index];
+}
+
+std::vector<int>& FlowField::getDistances()
+{
+    return m_integrator == Integrator::BreadthFirst ? m_costDistances : m_integrations;
+}
+
+int FlowField::getStepCost(const int to, const int direction) const
+{
+    if (m_integrator == Integrator::BreadthFirst) return 1;
+
+    return m_paddedCosts[to] * (IsDiagonal[direction] ? DiagonalStepCost : StraightStepCost);
+}
+
+void FlowField::pushRepairHeap(const int distance, const int index)
+{
+    m_repairHeap.emplace_back(distance, index);
+    std::push_heap(m_repairHeap.begin(), m_repairHeap.end(), std::greater<>());
+}
+
+std::pair<int, int> FlowField::popRepairHeap()
+{
+    std::pop_heap(m_repairHeap.begin(), m_repairHeap.end(), std::greater<>());
+    const auto top = m_repairHeap.back();
+    m_repairHeap.pop_back();
+
+    return top;
+}
+
+void FlowField::repairRemovedObstacle(const int index)
+{
+    std::vector<int>& distances = getDistances();
+    const int padded = toPaddedIndex(index);
+
+    m_obstacles[index] = 0;
+    updatePaddedCost(index);
+    m_mapVersion++;
+    m_repairedCells.push_back(padded);
+
+    // The new cell is reached from its closest neighbour (the step cost does not depend on the cell we come from,
+    // only on the cell entered and the direction, which is symmetric)
+    int lowestDistance = Unvisited;
+    for (int direction = 0; direction < NeighbourCount; direction++)
+    {
+        const int distance = distances[padded + m_paddedOffsets[direction]];
+        if (distance == Unvisited || distance == Impassable) continue;
+
+        const int candidate = distance + getStepCost(padded, direction);
+        if (lowestDistance == Unvisited || candidate < lowestDistance) lowestDistance = candidate;
+    }
+
+    distances[padded] = lowestDistance;
+    if (lowestDistance == Unvisited) return;
+
+    // Propagate the lower distances, a cell is only visited again if its distance decreases (or if it was unreachable)
+    m_repairHeap.clear();
+    pushRepairHeap(lowestDistance, padded);
+
+    while (!m_repairHeap.empty())
+    {
+        const auto entry = popRepairHeap();
+        const int current = entry.second;
+        if (entry.first != distances[current]) continue;
+
+        if (current != padded) m_repairedCells.push_back(current);
+
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            // Obstacles and the border cost 0
+            const int neighbour = current + m_paddedOffsets[direction];
+            if (m_paddedCosts[neighbour] == 0) continue;
+
+            const int neighbourDistance = entry.first + getStepCost(neighbour, direction);
+            const int distance = distances[neighbour];
+            if (distance == Unvisited || neighbourDistance < distance)
+            {
+                distances[neighbour] = neighbourDistance;
+                pushRepairHeap(neighbourDistance, neighbour);
+            }
+        }
+    }
+}
+
+void FlowField::repairAddedObstacle(const int index)
+{
+    std::vector<int>& distances = getDistances();
+    const int padded = toPaddedIndex(index);
+    const int oldDistance = distances[padded];
+
+    m_obstacles[index] = 1;
+    updatePaddedCost(index);
+    m_mapVersion++;
+    m_costDistances[padded] = Impassable;
+    m_integrations[padded] = Impassable;
+    m_repairedCells.push_back(padded);
+
+    // Nothing could go through an unreachable cell
+    if (oldDistance == Unvisited) return;
+
+    // 1. Invalidate, by increasing distance from the obstacle, the cells which have no valid parent anymore (a parent
+    // being a neighbour from which the cell is reached with its current distance). The parents of a cell are
+    // checked when it is popped: every cell closer to the goal is final by then. The distances are kept until every
+    // invalid cell is known, because they are used to find the parents.
+    m_openList.clear();
+    m_repairHeap.clear();
+    pushRepairHeap(oldDistance, padded);
+
+    while (!m_repairHeap.empty())
+    {
+        const auto entry = popRepairHeap();
+        const int current = entry.second;
+
+        if (current != padded)
+        {
+            if (m_repairFlags[current] & Checked) continue;
+
+            m_repairFlags[current] |= Checked;
+            m_openList.push_back(current);
+
+            bool hasValidParent = false;
+            for (int direction = 0; direction < NeighbourCount && !hasValidParent; direction++)
+            {
+                const int parent = current + m_paddedOffsets[direction];
+                const int parentDistance = distances[parent];
+                if (parentDistance == Unvisited || parentDistance == Impassable) continue;
+                if (m_repairFlags[parent] & Invalid) continue;
+
+                hasValidParent = parentDistance + getStepCost(current, direction) == entry.first;
+            }
+
+            if (hasValidParent) continue;
+
+            m_repairFlags[current] |= Invalid;
+            m_repairedCells.push_back(current);
+        }
+
+        // The children of an invalid cell may be invalid too
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int child = current + m_paddedOffsets[direction];
+            if (m_paddedCosts[child] == 0 || m_repairFlags[child] & Checked) continue;
+
+            const int childDistance = entry.first + getStepCost(child, direction);
+            if (distances[child] == childDistance) pushRepairHeap(childDistance, child);
+        }
+    }
+
+    for (const int cell : m_openList)
+    {
+        m_repairFlags[cell] &= ~Checked;
+    }
+
+    // 2. Seed each invalid cell with the distance given by its valid neighbours, if it has any
+    for (size_t i = 1; i < m_repairedCells.size(); i++)
+    {
+        distances[m_repairedCells[i]] = Unvisited;
+    }
+
+    m_repairHeap.clear();
+    for (size_t i = 1; i < m_repairedCells.size(); i++)
+    {
+        const int cell = m_repairedCells[i];
+
+        int lowestDistance = Unvisited;
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int neighbour = cell + m_paddedOffsets[direction];
+            const int distance = distances[neighbour];
+            if (distance == Unvisited || distance == Impassable || m_repairFlags[neighbour] & Invalid) continue;
+
+            const int candidate = distance + getStepCost(cell, direction);
+            if (lowestDistance == Unvisited || candidate < lowestDistance) lowestDistance = candidate;
+        }
+
+        if (lowestDistance != Unvisited)
+        {
+            distances[cell] = lowestDistance;
+            pushRepairHeap(lowestDistance, cell);
+        }
+    }
+
+    // 3. Propagate inside the invalid cells by increasing distance, like Dijkstra with several sources
+    while (!m_repairHeap.empty())
+    {
+        const auto entry = popRepairHeap();
+        const int current = entry.second;
+
+        // The cell has already been reached with a lower distance
+        if (entry.first != distances[current]) continue;
+
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            // The border is never invalid
+            const int neighbour = current + m_paddedOffsets[direction];
+            if (!(m_repairFlags[neighbour] & Invalid)) continue;
+
+            const int neighbourDistance = entry.first + getStepCost(neighbour, direction);
+            const int distance = distances[neighbour];
+            if (distance == Unvisited || neighbourDistance < distance)
+            {
+                distances[neighbour] = neighbourDistance;
+                pushRepairHeap(neighbourDistance, neighbour);
+            }
+        }
+    }
+}
+
+void FlowField::refreshRepairedCells()
+{
+    for (const int cell : m_repairedCells)
+    {
+        if (m_integrator == Integrator::BreadthFirst)
+        {
+            m_integrations[cell] = computeIntegration(m_costDistances[cell], cell % m_paddedWidth - 1,
+                                                      cell / m_paddedWidth - 1);
+        }
+        else
+        {
+            m_costDistances[cell] = costFromIntegration(m_integrations[cell]);
+        }
+    }
+
+    // The direction of a cell depends on the integration of its neighbours
+    for (const int cell : m_repairedCells)
+    {
+        markUpdated(cell);
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int neighbour = cell + m_paddedOffsets[direction];
+            if (!m_isBorder[neighbour]) markUpdated(neighbour);
+        }
+    }
+
+    for (const int cell : m_updatedCells)
+    {
+        const int padded = toPaddedIndex(cell);
+        const std::uint8_t previousCode = m_directionCodes[cell];
+        computeDirection(cell, padded);
+        m_repairFlags[padded] = 0;
+
+        // The neighbours of the repaired cells are only dirty if they point somewhere else
+        if (m_isDirtyTracking && m_directionCodes[cell] != previousCode) markDirty(cell);
+    }
+
+    for (const int cell : m_repairedCells)
+    {
+        m_repairFlags[cell] = 0;
+        if (m_isDirtyTracking) markDirty(fromPaddedIndex(cell));
+    }
+}
+
+void FlowField::markUpdated(const int padded)
+{
+    if (m_repairFlags[padded] & Updated) return;
+
+    m_repairFlags[padded] |= Updated;
+    m_updatedCells.push_back(fromPaddedIndex(padded));
+}
+
+void FlowField::markDirty(const int index)
+{
+    if (m_isDirty[index]) return;
+
+    m_isDirty[index] = 1;
+    m_dirtyCells.push_back(index);
+}
+
+void FlowField::markChangedCellsDirty(const std::vector<int>& costDistances, const std::vector<int>& integrations,
+                                      const std::vector<std::uint8_t>& directionCodes)
+{
+    for (int y = 0; y < m_height; y++)
+    {
+        int index = toIndex(0, y);
+        int padded = toPaddedIndex(index);
+        for (int x = 0; x < m_width; x++, index++, padded++)
+        {
+            if (m_costDistances[padded] != costDistances[padded] ||
+                m_integrations[padded] != integrations[padded] ||
+                m_directionCodes[index] != directionCodes[index])
+            {
+                markDirty(index);
+            }
+        }
+    }
+}
+
+bool FlowField::isCancelled() const
+{
+    return m_cancelFlag != nullptr && m_cancelFlag->load(std::memory_order_relaxed);
+}
@@ -0,0 +1,722 @@
+#ifndef LAB6FLOWFIELD_FLOWFIELD_HPP
+#define LAB6FLOWFIELD_FLOWFIELD_HPP
+
+#include <atomic>
+#include <vector>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "BucketQueue.hpp"
+#include "EikonalSolver.hpp"
+#include "VectorFieldKernel.hpp"
+
+class ObstacleMap;
+class ThreadPool;
+
+/**
+ * \brief Headless flow field solver
+ * \details Holds the cost field, the integration field and the vector field of a grid in flat contiguous arrays
+ * (one entry per cell, row-major: index = x + width * y), independently of any SFML graphics class.
+ * Grid and Node are only a view on top of this data, so the solver can run on very large grids without a window.
+ * The integration field can be computed by different integrators (see Integrator), chosen at runtime.
+ *
+ * Internally, the cost and integration fields are padded with a border of impassable cells, one cell wide, so the
+ * solvers reach the 8 neighbours of a cell with constant offsets and no bounds check. The indices taken and returned
+ * by the public functions are never padded.
+ */
+class FlowField
+{
+public:
+    /**
+     * \brief Cost/integration value of a cell that has not been reached (yet) from the goal
+     */
+    static constexpr int Unvisited = -1;
+
+    /**
+     * \brief Cost/integration value of an impassable cell
+     */
+    static constexpr int Impassable = INT_MAX;
+
+    /**
+     * \brief Normalised direction of the flow, (0, 0) when there is no direction (goal, obstacle, unreachable cell)
+     */
+    struct Direction
+    {
+        float x;
+        float y;
+    };
+
+    /**
+     * \brief Direction code of a cell without direction, the other codes being the index of the neighbour the flow
+     * points to, in the order of the 3x3 block around the cell (top-left to bottom-right, without the cell itself)
+     */
+    static constexpr std::uint8_t NoDirectionCode = 8;
+
+    /**
+     * \brief Number of neighbours of a cell, diagonals included
+     */
+    static constexpr int NeighbourCount = 8;
+
+    /**
+     * \brief Normalised direction of each direction code, (0, 0) for NoDirectionCode
+     */
+    static constexpr Direction DirectionTable[NeighbourCount + 1] = {
+        {-0.70710678f, -0.70710678f}, {0, -1}, {0.70710678f, -0.70710678f},
+        {-1, 0}, {1, 0},
+        {-0.70710678f, 0.70710678f}, {0, 1}, {0.70710678f, 0.70710678f},
+        {0, 0}
+    };
+
+    /**
+     * \brief Algorithm used to compute the integration field
+     */
+    enum class Integrator
+    {
+        // Breadth-first search on the number of steps, integration = cost * 100 + distance to the goal.
+        // Terrain costs are ignored.
+        BreadthFirst,
+        // Dijkstra on the terrain costs with a bucket queue (Dial's algorithm), integration = sum of the terrain
+        // cost of each cell entered, times 10 for a straight step and 14 for a diagonal one
+        Weighted,
+        // Fast sweeping solver of the eikonal equation on the terrain costs (see EikonalSolver), integration =
+        // arrival time times 10. Smoother, more isotropic distances, but no diagonal step between two obstacles.
+        Eikonal
+    };
+
+    /**
+     * \brief Cost of a straight step through a cell of terrain cost 1 for the Weighted integrator
+     */
+    static constexpr int StraightStepCost = 10;
+
+    /**
+     * \brief Cost of a diagonal step through a cell of terrain cost 1 for the Weighted integrator
+     */
+    static constexpr int DiagonalStepCost = 14;
+
+    /**
+     * \brief Number of cells from which the breadth-first search runs in parallel, when a thread pool is set
+     */
+    static constexpr int ParallelSearchMinCellCount = 1 << 20;
+
+    /**
+     * \param width number of cells on the x axis
+     * \param height number of cells on the y axis
+     * \param cellSize size of one cell in world units, only used to scale the distance to the goal
+     * in the integration field
+     */
+    FlowField(int width, int height, float cellSize = 1.f);
+
+    int getWidth() const;
+    int getHeight() const;
+    int getCellCount() const;
+    float getCellSize() const;
+
+    bool isInside(int x, int y) const;
+    int toIndex(int x, int y) const;
+
+    /**
+     * \brief Call visit(neighbour, direction) for each neighbour of a cell inside the grid
+     * \details Does not allocate: the neighbours are found with constant offsets, and the padded border tells which
+     * ones are outside the grid.
+     * \param visit function taking the index of the neighbour and its direction code (see NoDirectionCode)
+     */
+    template <typename Visit>
+    void forEachNeighbour(int index, const Visit& visit) const;
+
+    void setGoal(int x, int y);
+    int getGoalIndex() const;
+
+    /**
+     * \brief Version of the map, increased every time an obstacle or a terrain cost changes
+     * \details Two fields calculated for the same goal and integrator at the same version are identical.
+     */
+    std::uint64_t getMapVersion() const;
+
+    /**
+     * \brief Mark or unmark a cell as impassable
+     * \details Cells outside the grid are ignored. The fields are not updated until calculate() is called.
+     */
+    void setObstacle(int x, int y, bool isObstacle);
+    bool isObstacle(int index) const;
+    void clearObstacles();
+
+    /**
+     * \brief Replace every obstacle with the ones of an obstacle map of the same size, in one pass
+     * \details Only the cells which change are written, and the map version is increased once if any did. The fields
+     * are not updated until calculate() is called.
+     */
+    void setObstacles(const ObstacleMap& obstacles);
+
+    /**
+     * \brief Same as setObstacles(), from the rows of a bitmap laid out like ObstacleMap::getRow()
+     * \param rows (width + 63) / 64 words per row, for every row
+     */
+    void setObstacles(const std::uint64_t* rows);
+
+    /**
+     * \brief Set the cost of entering a cell (1 = normal, up to 255 for mud, danger zones...) for the Weighted integrator
+     * \details A cost of 0 is treated as 1. The fields are not updated until calculate() is called.
+     */
+    void setTerrainCost(int x, int y, std::uint8_t cost);
+    std::uint8_t getTerrainCost(int index) const;
+    void clearTerrainCosts();
+
+    /**
+     * \brief Replace every terrain cost with one byte per cell in index order, in one pass
+     * \details Same as setTerrainCost() for each cell, the map version being increased once if any cost changed.
+     */
+    void setTerrainCosts(const std::uint8_t* costs);
+
+    void setIntegrator(Integrator integrator);
+    Integrator getIntegrator() const;
+
+    /**
+     * \brief Instruction set of the vector field pass, the best one supported by the CPU by default
+     * \details The direction codes are the same with every instruction set. One the CPU does not support is replaced
+     * by VectorFieldKernel::getBestInstructionSet().
+     */
+    void setInstructionSet(VectorFieldKernel::InstructionSet set);
+    VectorFieldKernel::InstructionSet getInstructionSet() const;
+
+    /**
+     * \brief Mark the cells which see the goal after each calculation and repair, see computeLineOfSight()
+     * \details Disabled by default, hasLineOfSight() is then false for every cell.
+     */
+    void setLineOfSightEnabled(bool isEnabled);
+    bool isLineOfSightEnabled() const;
+
+    /**
+     * \brief Thread pool the BreadthFirst integrator runs on, for the grids of at least ParallelSearchMinCellCount cells
+     * \details The cost field is then searched level by level: the cells of a level are spread over the threads,
+     * which mark the cells they reach in a shared bitmap and collect the next level in their own buffer. Each cell gets
+     * the same cost as with the serial search, so the fields are identical. The levels with few cells, like in the
+     * corridors of a maze, are still searched on the calling thread. nullptr (the default) always searches serially.
+     * The pool is also given to the eikonal solver, for its parallel sweeps (see EikonalSolver::setParallel()).
+     * The pool must not run another loop during calculate(), ThreadPool::run() is not reentrant.
+     */
+    void setThreadPool(ThreadPool* pool);
+
+    /**
+     * \brief Whether the BreadthFirst integrator runs on the thread pool (see setThreadPool())
+     */
+    bool isParallelSearch() const;
+
+    /**
+     * \brief Calculate the flow field pathfinding
+     * 1. Calculate cost field (BreadthFirst integrator only)
+     * 2. Compute integration field
+     * 3. Compute vector field
+     * 4. Mark the cells in line of sight of the goal, if enabled
+     */
+    void calculate();
+
+    bool isCalculated() const;
+
+    /**
+     * \brief Flag read while calculate() runs, so another thread can stop a calculation which is not needed anymore
+     * \details Once the flag is set, calculate() returns as soon as possible, leaving the fields half calculated, and
+     * isCalculated() is false until the next complete calculation. With dirty tracking, the fields of the last complete
+     * calculation are kept instead. nullptr (the default) never stops.
+     */
+    void setCancelFlag(const std::atomic<bool>* isCancelled);
+
+    /**
+     * \brief Copy the obstacles, the terrain costs and the map version of a flow field of the same size
+     * \details The fields are not updated until calculate() is called.
+     */
+    void copyMap(const FlowField& other);
+
+    /**
+     * \brief Exchange the fields (line of sight included), the goal and the integrator with a flow field of the same
+     * size, without copying them
+     * \details The maps are not exchanged, both flow fields must have the same obstacles and terrain costs for the
+     * fields to stay valid (see getMapVersion()). With dirty tracking, the cells whose values differ are marked dirty.
+     */
+    void swapFields(FlowField& other);
+
+    /**
+     * \brief Add or remove an obstacle and repair the fields around it, instead of calculating the whole grid again
+     * \details Dynamic shortest path repair: when an obstacle is added, only the cells whose every shortest path went
+     * through it are invalidated and propagated again from the valid cells around them. When an obstacle is removed,
+     * the lower costs are propagated from it and the propagation stops as soon as the cost of a cell does not change.
+     * Works with the BreadthFirst and Weighted integrators, the result is identical to calculate(). The Eikonal
+     * integrator has no notion of parent, so the whole grid is calculated again. If the fields have never been
+     * calculated, only the obstacle is set.
+     *
+     * With the line of sight pass, only the cells behind the obstacle seen from the goal are marked again (see
+     * updateLineOfSight()): a wedge whose width shrinks with the distance to the goal, up to the whole grid for an
+     * obstacle next to the goal. The first repair after the pass was enabled, or after fields calculated without it,
+     * marks the whole grid.
+     * \return number of cells updated (see getUpdatedCells())
+     */
+    int updateObstacle(int x, int y, bool isObstacle);
+
+    /**
+     * \brief Cells whose cost, integration or direction may have changed during the last updateObstacle()
+     */
+    const std::vector<int>& getUpdatedCells() const;
+
+    /**
+     * \brief Keep track of the cells whose cost, integration or direction changed, so a view of the fields only
+     * refreshes these cells
+     * \details The cells changed by calculate() and updateObstacle() are added to the dirty cells until
+     * clearDirtyCells() is called. calculate() finds them by comparing with the previous fields, which doubles the
+     * memory used by the fields while tracking is enabled. Enabling tracking clears the dirty cells.
+     */
+    void setDirtyTracking(bool isEnabled);
+    bool isDirtyTracking() const;
+
+    /**
+     * \brief Cells changed since the last clearDirtyCells(), each cell only once, in the order they changed
+     */
+    const std::vector<int>& getDirtyCells() const;
+    bool isDirty(int index) const;
+    void clearDirtyCells();
+
+    /*
+     * Individual steps of calculate(), in order. Public so each phase can be measured on its own.
+     */
+
+    /**
+     * \brief Reset every field to its default value and apply the obstacles
+     */
+    void resetFields();
+
+    /**
+     * \brief Breadth-first search from the goal, store the number of steps to reach the goal in each cell
+     * \details In parallel when isParallelSearch() is true.
+     */
+    void createCostField();
+
+    /**
+     * \brief Compute the integration field by using the previously calculated cost field
+     * \details integration = cost * 100 + distance to the goal, so the distance only break ties between cells
+     * with the same cost
+     */
+    void createIntegrationField();
+
+    /**
+     * \brief Weighted integrator: Dial's algorithm from the goal on the terrain costs
+     * \details Replace createCostField() and createIntegrationField(). The cost field stores the integration divided
+     * by StraightStepCost, the distance to the goal in straight steps through normal terrain.
+     */
+    void createWeightedIntegrationField();
+
+    /**
+     * \brief Eikonal integrator: fast sweeping from the goal on the terrain costs
+     * \details Replace createCostField() and createIntegrationField(). The cost field stores the integration divided
+     * by StraightStepCost, like the Weighted integrator.
+     */
+    void createEikonalIntegrationField();
+
+    EikonalSolver& getEikonalSolver();
+
+    /**
+     * \brief Point each cell to the neighbour with the lowest integration value
+     * \details A row at a time, with the kernel of the instruction set (see setInstructionSet()).
+     */
+    void computeVectorField();
+
+    /**
+     * \brief Mark the cells from which an agent can walk straight to the center of the goal
+     * \details A cell is in line of sight when the region between the center of the goal and the whole cell only
+     * crosses walkable cells with the terrain cost of the goal (any cost for the BreadthFirst integrator, which ignores
+     * them), so the straight line is a shortest path from any point of the cell. The test is exact, slopes being
+     * compared as fractions of integers.
+     *
+     * The grid is swept by the wavefront from the goal, in the 4 quadrants around it, one row of cells after another
+     * moving away from the goal. Each blocking cell reached (see above) casts a shadow, the range of slopes its corners
+     * span seen from the goal, and a cell of the next rows is only in line of sight if its own corners span no shadowed
+     * slope. On the same row, only the neighbour closer to the axis can hide a corner of a cell. The cells on the
+     * diagonals belong to two quadrants and must be seen in both. Every sweep reads rows of consecutive cells, the east
+     * and west quadrants going through a transposed copy of the grid.
+     */
+    void computeLineOfSight();
+
+    /**
+     * \brief Find the cell the flow of a cell points to
+     * \return index of the next cell, -1 if the cell has no direction (goal, obstacle, unreachable)
+     */
+    int getNextIndex(int index) const;
+
+    /**
+     * \brief Index of the neighbour a direction code points to, in a grid of the given width
+     * \return index of the neighbour, -1 for NoDirectionCode
+     */
+    static int getNextIndex(int index, std::uint8_t code, int width);
+
+    /**
+     * \brief Bilinear interpolation of the vector field
+     * \details https://en.wikipedia.org/wiki/Bilinear_interpolation
+     * \param gridX position in grid coordinates, the center of the cell (0, 0) being at (0, 0)
+     * \param gridY position in grid coordinates
+     * \return interpolated direction (not normalised), (0, 0) if the position is outside the grid
+     */
+    Direction sampleDirection(float gridX, float gridY) const;
+
+    /**
+     * \brief Direction an agent steers toward: straight to the center of the goal from a cell in line of sight (see
+     * computeLineOfSight()), the bilinear interpolation of the vector field (see sampleDirection()) anywhere else
+     * \param gridX position in grid coordinates, like sampleDirection()
+     * \return direction, not normalised
+     */
+    Direction getSteeringDirection(float gridX, float gridY) const;
+
+    int getCostDistance(int index) const;
+    int getIntegration(int index) const;
+
+    /**
+     * \brief Whether an agent anywhere in a cell can walk straight to the center of the goal (see computeLineOfSight())
+     */
+    bool hasLineOfSight(int index) const;
+
+    /**
+     * \brief One byte per cell, 1 for the cells in line of sight of the goal
+     */
+    const std::vector<std::uint8_t>& getLineOfSight() const;
+
+    /**
+     * \brief Direction of a cell, decoded from its direction code, for the views which need a vector
+     */
+    Direction getDirection(int index) const;
+
+    /**
+     * \brief Direction code of a cell (see NoDirectionCode), the vector field being stored as one byte per cell
+     */
+    std::uint8_t getDirectionCode(int index) const;
+    const std::vector<std::uint8_t>& getDirectionCodes() const;
+
+    /**
+     * \brief Direction code (see NoDirectionCode) of a direction of the vector field
+     */
+    static std::uint8_t encodeDirection(Direction direction);
+
+    /**
+     * \brief Normalised direction of a direction code, (0, 0) for NoDirectionCode
+     */
+    static Direction decodeDirection(std::uint8_t code)
+    {
+        return DirectionTable[code];
+    }
+
+    /**
+     * \brief Bilinear interpolation of any vector field of the given size, see sampleDirection()
+     * \param directionAt function returning the Direction of a cell from its index
+     */
+    template <typename DirectionAt>
+    static Direction sampleDirections(int width, int height, float gridX, float gridY, const DirectionAt& directionAt);
+
+private:
+    /**
+     * \brief Remove an obstacle, then propagate the lower costs from it
+     */
+    void repairRemovedObstacle(int index);
+
+    /**
+     * \brief Add an obstacle, invalidate the cells which depended on it and propagate them again
+     */
+    void repairAddedObstacle(int index);
+
+    /**
+     * \brief Recompute the value derived from the repaired distance of each repaired cell (the integration for the
+     * BreadthFirst integrator, the cost for the Weighted one), then the direction of these cells and their neighbours,
+     * and fill the list of updated cells
+     */
+    void refreshRepairedCells();
+
+    /**
+     * \brief Level-synchronous breadth-first search on the thread pool, same result as the serial one
+     */
+    void createCostFieldParallel();
+
+    /**
+     * \brief Visit the neighbours of the cells [first, last) of the current level, claim the unvisited ones in the
+     * visited bitmap and add them to a buffer of the next level
+     */
+    void expandLevel(size_t first, size_t last, int nextCost, std::vector<int>& nextLevel);
+
+    /**
+     * \brief Fill the cost field from the integration field, for the integrators working on the terrain costs
+     */
+    void deriveCostsFromIntegrations();
+
+    /**
+     * \brief Index of a cell in the padded fields
+     */
+    int toPaddedIndex(int index) const;
+    int fromPaddedIndex(int padded) const;
+
+    /**
+     * \brief Refresh the padded cost of a cell after its obstacle or terrain cost changed
+     */
+    void updatePaddedCost(int index);
+
+    /**
+     * \brief Field holding the shortest distances computed by the integrator: the cost field for BreadthFirst, the
+     * integration field for Weighted. This is the field the repair works on.
+     */
+    std::vector<int>& getDistances();
+
+    /**
+     * \brief Distance added by a step into a cell
+     * \param to padded index of the cell entered
+     * \param direction index of the direction of the step (see NeighbourX/NeighbourY)
+     */
+    int getStepCost(int to, int direction) const;
+
+    void pushRepairHeap(int distance, int index);
+    std::pair<int, int> popRepairHeap();
+
+    /**
+     * \brief Point a cell to its neighbour with the lowest integration value
+     */
+    void computeDirection(int index, int padded);
+
+    /**
+     * \brief Integration value of a cell from its cost (BreadthFirst), Unvisited/Impassable if the cell is not reachable
+     */
+    int computeIntegration(int cost, int x, int y) const;
+
+    /**
+     * \brief Add a cell to the list of updated cells, only once
+     * \param padded padded index of the cell
+     */
+    void markUpdated(int padded);
+
+    /**
+     * \brief Add a cell to the dirty cells, only once
+     */
+    void markDirty(int index);
+
+    /**
+     * \brief Mark dirty the cells whose values differ from other fields of the same size (padded like the current ones)
+     */
+    void markChangedCellsDirty(const std::vector<int>& costDistances, const std::vector<int>& integrations,
+                               const std::vector<std::uint8_t>& directionCodes);
+
+    /**
+     * \brief Swap back the fields swapped at the start of calculate() when dirty tracking is enabled
+     * \details Done when a calculation is cancelled, so the next one compares with the last complete fields instead of
+     * the half calculated ones.
+     */
+    void restorePreviousFields();
+
+    /**
+     * \brief Whether the cancel flag (see setCancelFlag()) is set
+     */
+    bool isCancelled() const;
+
+    /**
+     * \brief Slopes seen from the goal hidden by walls, an open interval, see computeLineOfSight()
+     * \details Slopes are fractions with a positive denominator, the offset across the quadrant over the distance from
+     * the goal along its axis.
+     */
+    struct Shadow
+    {
+        int lowNumerator;
+        int lowDenominator;
+        int highNumerator;
+        int highDenominator;
+    };
+
+    /**
+     * \brief Cells of a quadrant a sweep updates: the ones from a depth on whose corners span slopes in a range
+     */
+    struct SightWedge
+    {
+        double lowSlope;
+        double highSlope;
+        int firstDepth;
+    };
+
+    /**
+     * \brief Sweep the quadrant below or above the goal in a grid of sight flags, see computeLineOfSight()
+     * \details The rows of the quadrant are consecutive cells of the grid, the east and west quadrants are swept in
+     * the transposed grid. Flags the cells of the wedge seen in the quadrant, and clears the flag of the others. Only
+     * the columns which can hide a cell of the wedge are swept.
+     * \param cells sight flags of the cells, row-major
+     * \param depthStep 1 for the rows below the goal, -1 for the rows above it
+     */
+    void sweepLineOfSight(std::uint8_t* cells, int width, int height, int goalX, int goalY, int depthStep,
+                          const SightWedge& wedge);
+
+    /**
+     * \brief Mark again the cells whose line of sight an obstacle added or removed may have changed
+     * \details The cell itself, and the wedge behind it in each quadrant it is in: the cells whose corners span the
+     * slopes of its corners. The cells whose cost was repaired only change if they are in the wedge, a cell reached
+     * or cut off from the goal elsewhere seeing it neither before nor after.
+     */
+    void updateLineOfSight(int index);
+
+    /**
+     * \brief Line of sight of a cell from the flags of the quadrants it is in, see computeLineOfSight()
+     */
+    void refreshLineOfSight(int x, int y);
+
+    int m_width;
+    int m_height;
+    float m_cellSize;
+
+    // Width of the padded fields, and the offsets of the 8 neighbours in the padded and unpadded fields
+    int m_paddedWidth;
+    int m_paddedOffsets[NeighbourCount];
+    int m_offsets[NeighbourCount];
+
+    int m_goalIndex;
+
+    std::uint64_t m_mapVersion;
+
+    std::vector<std::uint8_t> m_obstacles;
+    std::vector<std::uint8_t> m_terrainCosts;
+
+    // Padded terrain costs, 0 for the obstacles and the border: the cells which cannot be entered
+    std::vector<std::uint8_t> m_paddedCosts;
+    // Padded, 1 for the cells of the border, outside the grid
+    std::vector<std::uint8_t> m_isBorder;
+
+    Integrator m_integrator;
+    VectorFieldKernel::InstructionSet m_instructionSet;
+
+    // Padded, the border is always Impassable
+    std::vector<int> m_costDistances;
+    std::vector<int> m_integrations;
+
+    // Vector field, one direction code per cell (see NoDirectionCode)
+    std::vector<std::uint8_t> m_directionCodes;
+
+    bool m_isCalculated;
+
+    const std::atomic<bool>* m_cancelFlag;
+
+    // Reused between calculations so the breadth-first search does not allocate
+    std::vector<int> m_openList;
+
+    /*
+     * PARALLEL SEARCH PROPERTIES
+     */
+
+    /**
+     * \brief 64 visited flags of the parallel search, copied as cleared since they only live during a search
+     */
+    struct VisitedWord
+    {
+        std::atomic<std::uint64_t> bits{0};
+
+        VisitedWord() = default;
+        VisitedWord(const VisitedWord&) {}
+        VisitedWord& operator=(const VisitedWord&) { return *this; }
+    };
+
+    ThreadPool* m_threadPool;
+
+    // One bit per padded cell, set once the cell is reached (or cannot be entered)
+    std::vector<VisitedWord> m_visitedWords;
+
+    // Cells of the next level found by each task, gathered in the open list once the level is done
+    std::vector<std::vector<int>> m_levelBuffers;
+
+    // Reused between calculations by the Weighted integrator
+    BucketQueue m_bucketQueue;
+
+    // Reused between calculations by the Eikonal integrator
+    EikonalSolver m_eikonalSolver;
+    std::vector<float> m_eikonalTimes;
+
+    /*
+     * REPAIR PROPERTIES
+     */
+
+    // Scratch flags of the repair (RepairFlag), padded, always cleared once the repair is done
+    std::vector<std::uint8_t> m_repairFlags;
+
+    // Cells whose distance changed during the repair, by padded index
+    std::vector<int> m_repairedCells;
+
+    // Min-heap of (distance, cell), the repair visits cells by increasing distance. The repaired region can cover
+    // any range of distances, so a bucket queue with a bounded key window does not fit here.
+    std::vector<std::pair<int, int>> m_repairHeap;
+
+    std::vector<int> m_updatedCells;
+
+    /*
+     * DIRTY TRACKING PROPERTIES
+     */
+
+    bool m_isDirtyTracking;
+    std::vector<std::uint8_t> m_isDirty;
+    std::vector<int> m_dirtyCells;
+
+    // Fields before the last calculate(), swapped with the current ones so nothing is copied (padded like them)
+    std::vector<int> m_previousCostDistances;
+    std::vector<int> m_previousIntegrations;
+    std::vector<std::uint8_t> m_previousDirectionCodes;
+
+    /*
+     * LINE OF SIGHT PROPERTIES
+     */
+
+    bool m_isLineOfSightEnabled;
+
+    // One byte per cell, 1 if the cell sees the goal, all 0 while disabled
+    std::vector<std::uint8_t> m_lineOfSight;
+
+    // Shadows of the rows swept so far, sorted and disjoint, and the ones of the current row, reused between sweeps
+    std::vector<Shadow> m_shadows;
+    std::vector<Shadow> m_rowShadows;
+    std::vector<Shadow> m_mergedShadows;
+
+    // Sight flags of the cells, in the grid for the north and south quadrants and in the transposed grid for the east
+    // and west ones, kept for the repairs, allocated by the first pass
+    std::vector<std::uint8_t> m_sightFlags;
+    std::vector<std::uint8_t> m_transposedSight;
+
+    // Goal the sight flags were swept from, -1 when they are not up to date with the fields
+    int m_sightGoalIndex;
+};
+
+template <typename Visit>
+void FlowField::forEachNeighbour(const int index, const Visit& visit) const
+{
+    const int padded = toPaddedIndex(index);
+    for (int direction = 0; direction < NeighbourCount; direction++)
+    {
+        if (m_isBorder[padded + m_paddedOffsets[direction]]) continue;
+
+        visit(index + m_offsets[direction], static_cast<std::uint8_t>(direction));
+    }
+}
+
+template <typename DirectionAt>
+FlowField::Direction FlowField::sampleDirections(const int width, const int height, const float gridX,
+                                                 const float gridY, const DirectionAt& directionAt)
+{
+    const int x = static_cast<int>(std::round(gridX));
+    const int y = static_cast<int>(std::round(gridY));
+
+    const auto isInside = [width, height](const int cellX, const int cellY)
+    {
+        return cellX >= 0 && cellX < width && cellY >= 0 && cellY < height;
+    };
+
+    // No direction because the position is not on a cell of the grid
+    if (!isInside(x, y)) return {0, 0};
+
+    // Cells outside of the grid push back toward it
+    const Direction f00 = directionAt(x + width * y);
+    const Direction f01 = isInside(x, y + 1) ? directionAt(x + width * (y + 1)) : Direction{0, -1};
+    const Direction f10 = isInside(x + 1, y) ? directionAt(x + 1 + width * y) : Direction{-1, 0};
+    const Direction f11 = isInside(x + 1, y + 1) ? directionAt(x + 1 + width * (y + 1)) : Direction{1, 1};
+
+    const float xWeight = gridX - static_cast<float>(x);
+    const float yWeight = gridY - static_cast<float>(y);
+
+    const Direction top = {f00.x * (1 - xWeight) + f10.x * xWeight, f00.y * (1 - xWeight) + f10.y * xWeight};
+    const Direction bottom = {f01.x * (1 - xWeight) + f11.x * xWeight, f01.y * (1 - xWeight) + f11.y * xWeight};
+
+    return {top.x * (1 - yWeight) + bottom.x * yWeight, top.y * (1 - yWeight) + bottom.y * yWeight};
+}
+
+
+#endif //LAB6FLOWFIELD_FLOWFIELD_HPP
@@ -0,0 +1,103 @@
+#include "FlowFieldCache.hpp"
+
+#include "FlowField.hpp"
+
+namespace
+{
+    std::uint64_t makeKey(const int goalIndex, const FlowField::Integrator integrator)
+    {
+        return static_cast<std::uint64_t>(goalIndex) << 8 | static_cast<std::uint64_t>(integrator);
+    }
+}
+
+FlowFieldCache::FlowFieldCache(FlowField& field, const std::size_t memoryBudget) :
+    m_field(field),
+    m_memoryBudget(memoryBudget),
+    m_memoryUsage(0),
+    m_mapVersion(field.getMapVersion()),
+    m_hitCount(0),
+    m_missCount(0)
+{
+}
+
+std::shared_ptr<const CompactFlowField> FlowFieldCache::get(const int goalX, const int goalY)
+{
+    if (!m_field.isInside(goalX, goalY)) return nullptr;
+
+    // Fields calculated on an older map are never valid again
+    if (m_field.getMapVersion() != m_mapVersion)
+    {
+        clear();
+        m_mapVersion = m_field.getMapVersion();
+    }
+
+    const std::uint64_t key = makeKey(m_field.toIndex(goalX, goalY), m_field.getIntegrator());
+    const auto found = m_lookup.find(key);
+    if (found != m_lookup.end())
+    {
+        m_hitCount++;
+        m_fields.splice(m_fields.begin(), m_fields, found->second);
+        return m_fields.front();
+    }
+
+    m_missCount++;
+    m_field.setGoal(goalX, goalY);
+    m_field.calculate();
+
+    m_fields.push_front(std::make_shared<const CompactFlowField>(m_field));
+    m_lookup[key] = m_fields.begin();
+    m_memoryUsage += m_fields.front()->getMemorySize();
+
+    evict();
+
+    return m_fields.front();
+}
+
+void FlowFieldCache::clear()
+{
+    m_fields.clear();
+    m_lookup.clear();
+    m_memoryUsage = 0;
+}
+
+void FlowFieldCache::setMemoryBudget(const std::size_t memoryBudget)
+{
+    m_memoryBudget = memoryBudget;
+    evict();
+}
+
+std::size_t FlowFieldCache::getMemoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+std::size_t FlowFieldCache::getMemoryUsage() const
+{
+    return m_memoryUsage;
+}
+
+int FlowFieldCache::getFieldCount() const
+{
+    return static_cast<int>(m_fields.size());
+}
+
+int FlowFieldCache::getHitCount() const
+{
+    return m_hitCount;
+}
+
+int FlowFieldCache::getMissCount() const
+{
+    return m_missCount;
+}
+
+void FlowFieldCache::evict()
+{
+    while (m_memoryUsage > m_memoryBudget && m_fields.size() > 1)
+    {
+        const auto& oldest = m_fields.back();
+        m_memoryUsage -= oldest->getMemorySize();
+        m_lookup.erase(makeKey(oldest->getGoalIndex(), oldest->getIntegrator()));
+        m_fields.pop_back();
+    }
+}
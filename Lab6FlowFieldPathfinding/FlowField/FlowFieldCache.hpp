@@ -0,0 +1,80 @@
+#ifndef LAB6FLOWFIELD_FLOWFIELDCACHE_HPP
+#define LAB6FLOWFIELD_FLOWFIELDCACHE_HPP
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "CompactFlowField.hpp"
+
+class FlowField;
+
+/**
+ * \brief Least recently used cache of the vector fields calculated for several goals on the same map
+ * \details Fields are keyed by goal cell and integrator, and only valid for the map version (see
+ * FlowField::getMapVersion()) they were calculated at: as soon as the map changes, every cached field is dropped.
+ * The fields are stored compacted (see CompactFlowField), the least recently used ones are dropped when they take
+ * more memory than the budget. Fields are shared, a group of agents can keep using its field after it is dropped.
+ */
+class FlowFieldCache
+{
+public:
+    /**
+     * \param field flow field used to calculate the missing fields, its map is the one cached
+     * \param memoryBudget number of bytes the cached fields can use, the last field used is always kept
+     */
+    FlowFieldCache(FlowField& field, std::size_t memoryBudget);
+
+    /**
+     * \brief Find the field of a goal, calculating it if it is not cached yet
+     * \details On a miss, the goal of the flow field is changed and its fields are calculated.
+     * \return nullptr if the goal is outside the grid
+     */
+    std::shared_ptr<const CompactFlowField> get(int goalX, int goalY);
+
+    /**
+     * \brief Drop every cached field
+     */
+    void clear();
+
+    void setMemoryBudget(std::size_t memoryBudget);
+    std::size_t getMemoryBudget() const;
+
+    /**
+     * \brief Number of bytes used by the cached fields
+     */
+    std::size_t getMemoryUsage() const;
+
+    int getFieldCount() const;
+
+    int getHitCount() const;
+    int getMissCount() const;
+
+private:
+    /**
+     * \brief Drop the least recently used fields until the cache fits in its budget
+     */
+    void evict();
+
+    FlowField& m_field;
+
+    std::size_t m_memoryBudget;
+    std::size_t m_memoryUsage;
+
+    // Map version of every cached field
+    std::uint64_t m_mapVersion;
+
+    // Most recently used field first
+    std::list<std::shared_ptr<const CompactFlowField>> m_fields;
+
+    // Key made of the goal index and the integrator
+    std::unordered_map<std::uint64_t, std::list<std::shared_ptr<const CompactFlowField>>::iterator> m_lookup;
+
+    int m_hitCount;
+    int m_missCount;
+};
+
+
+#endif //LAB6FLOWFIELD_FLOWFIELDCACHE_HPP
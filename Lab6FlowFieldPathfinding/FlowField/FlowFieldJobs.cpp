@@ -0,0 +1,214 @@
+#include "FlowFieldJobs.hpp"
+
+#include <algorithm>
+
+FlowFieldJobs::FlowFieldJobs(const int workerCount) :
+    m_queues(std::max(1, workerCount)),
+    m_nextQueue(0),
+    m_batchCount(0),
+    m_isStopping(false),
+    m_queuedJobCount(0),
+    m_unfinishedJobCount(0),
+    m_stolenJobCount(0)
+{
+    m_workers.reserve(m_queues.size());
+    for (int i = 0; i < static_cast<int>(m_queues.size()); i++)
+    {
+        m_workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+FlowFieldJobs::~FlowFieldJobs()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+std::vector<std::future<FlowFieldJobs::Result>> FlowFieldJobs::submit(const FlowField& map,
+                                                                      const std::vector<Request>& requests)
+{
+    std::vector<std::promise<Result>> promises(requests.size());
+    std::vector<std::future<Result>> futures;
+    futures.reserve(requests.size());
+    for (auto& promise : promises)
+    {
+        futures.push_back(promise.get_future());
+    }
+
+    push(map, requests, &promises, nullptr);
+
+    return futures;
+}
+
+void FlowFieldJobs::submit(const FlowField& map, const std::vector<Request>& requests, Callback onComplete)
+{
+    push(map, requests, nullptr, std::make_shared<const Callback>(std::move(onComplete)));
+}
+
+void FlowFieldJobs::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_unfinishedJobCount == 0; });
+}
+
+int FlowFieldJobs::getWorkerCount() const
+{
+    return static_cast<int>(m_workers.size());
+}
+
+int FlowFieldJobs::getStolenJobCount() const
+{
+    return m_stolenJobCount.load(std::memory_order_relaxed);
+}
+
+int FlowFieldJobs::getDefaultWorkerCount()
+{
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void FlowFieldJobs::push(const FlowField& map, const std::vector<Request>& requests,
+                         std::vector<std::promise<Result>>* promises, const std::shared_ptr<const Callback>& callback)
+{
+    if (requests.empty()) return;
+
+    std::uint64_t batch;
+    int firstQueue;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_unfinishedJobCount += static_cast<int>(requests.size());
+        batch = ++m_batchCount;
+
+        // Round robin, each worker starts with its share of the batch
+        firstQueue = m_nextQueue;
+        m_nextQueue = static_cast<int>((m_nextQueue + requests.size()) % m_queues.size());
+    }
+
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        Job job{&map, batch, requests[i], static_cast<int>(i), {}, callback};
+        if (promises != nullptr) job.promise = std::move((*promises)[i]);
+
+        Queue& queue = m_queues[(firstQueue + i) % m_queues.size()];
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    // Counted once every job is in a queue, so a worker woken by the count always finds a job
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queuedJobCount.fetch_add(static_cast<int>(requests.size()), std::memory_order_relaxed);
+    }
+    m_wakeCondition.notify_all();
+}
+
+void FlowFieldJobs::work(const int worker)
+{
+    Scratch scratch;
+    Job job;
+
+    while (true)
+    {
+        if (!takeJob(worker, job))
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this]
+            {
+                return m_isStopping || m_queuedJobCount.load(std::memory_order_relaxed) > 0;
+            });
+
+            if (m_isStopping) return;
+            continue;
+        }
+
+        runJob(job, scratch);
+
+        bool isLast;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            isLast = --m_unfinishedJobCount == 0;
+        }
+        if (isLast) m_doneCondition.notify_all();
+    }
+}
+
+bool FlowFieldJobs::takeJob(const int worker, Job& job)
+{
+    const int queueCount = static_cast<int>(m_queues.size());
+    for (int i = 0; i < queueCount; i++)
+    {
+        // Own queue first, from the back, then the other queues from the front
+        const int victim = (worker + i) % queueCount;
+        Queue& queue = m_queues[victim];
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) continue;
+
+        if (i == 0)
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+        else
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            m_stolenJobCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        m_queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+void FlowFieldJobs::runJob(Job& job, Scratch& scratch) const
+{
+    const FlowField& map = *job.map;
+
+    Result result;
+    if (job.request.goalIndex >= 0 && job.request.goalIndex < map.getCellCount())
+    {
+        if (scratch.field == nullptr || scratch.field->getWidth() != map.getWidth() ||
+            scratch.field->getHeight() != map.getHeight() || scratch.field->getCellSize() != map.getCellSize())
+        {
+            scratch.field = std::make_unique<FlowField>(map.getWidth(), map.getHeight(), map.getCellSize());
+            // The workers already run in parallel
+            scratch.field->getEikonalSolver().setParallel(false);
+            scratch.batch = 0;
+        }
+
+        FlowField& field = *scratch.field;
+        if (scratch.batch != job.batch)
+        {
+            field.copyMap(map);
+            scratch.batch = job.batch;
+        }
+
+        field.setGoal(job.request.goalIndex % map.getWidth(), job.request.goalIndex / map.getWidth());
+        field.setIntegrator(job.request.integrator);
+        field.calculate();
+
+        result = std::make_shared<const CompactFlowField>(field);
+    }
+
+    if (job.callback != nullptr)
+    {
+        (*job.callback)(job.requestIndex, result);
+    }
+    else
+    {
+        job.promise.set_value(std::move(result));
+    }
+}
@@ -0,0 +1,155 @@
+#ifndef LAB6FLOWFIELD_FLOWFIELDJOBS_HPP
+#define LAB6FLOWFIELD_FLOWFIELDJOBS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CompactFlowField.hpp"
+
+/**
+ * \brief Flow fields of many goals on the same map, calculated in parallel on a work-stealing thread pool
+ * \details Each worker has its own queue of jobs, and takes the jobs of the other workers once its own queue is
+ * empty, so the workers stay busy even when some goals take much longer than others (the far end of a maze compared
+ * to an open area). A job is one goal: the worker calculates it in its own flow field, with its own integration and
+ * direction buffers, and packs the result in a CompactFlowField, like FlowFieldCache.
+ *
+ * The map is only read: each worker copies it the first time it calculates a goal of a batch, so it must not change
+ * until the jobs of the batch are done.
+ */
+class FlowFieldJobs
+{
+public:
+    /**
+     * \brief Goal of a job
+     */
+    struct Request
+    {
+        int goalIndex;
+        FlowField::Integrator integrator;
+    };
+
+    /**
+     * \brief Field of a goal, nullptr if the goal is outside the grid
+     */
+    using Result = std::shared_ptr<const CompactFlowField>;
+
+    /**
+     * \brief Called on the worker thread once the field of a request is calculated
+     * \param request index of the request in its batch
+     */
+    using Callback = std::function<void(int request, const Result& field)>;
+
+    /**
+     * \param workerCount number of threads calculating the fields, by default one per core
+     */
+    explicit FlowFieldJobs(int workerCount = getDefaultWorkerCount());
+
+    /**
+     * \brief Wait for every job to be done, then stop the workers
+     */
+    ~FlowFieldJobs();
+
+    FlowFieldJobs(const FlowFieldJobs&) = delete;
+    FlowFieldJobs& operator=(const FlowFieldJobs&) = delete;
+
+    /**
+     * \brief Calculate the field of each request on a map, in parallel
+     * \return one future per request, in the same order
+     */
+    std::vector<std::future<Result>> submit(const FlowField& map, const std::vector<Request>& requests);
+
+    /**
+     * \brief Same as submit(), onComplete being called for each request instead of returning futures
+     * \details onComplete is called by several workers at the same time, in any order.
+     */
+    void submit(const FlowField& map, const std::vector<Request>& requests, Callback onComplete);
+
+    /**
+     * \brief Wait for every job submitted to be done
+     */
+    void wait();
+
+    int getWorkerCount() const;
+
+    /**
+     * \brief Number of jobs taken from the queue of another worker
+     */
+    int getStolenJobCount() const;
+
+    static int getDefaultWorkerCount();
+
+private:
+    struct Job
+    {
+        const FlowField* map;
+        std::uint64_t batch;
+        Request request;
+        int requestIndex;
+        std::promise<Result> promise;
+        // Shared by the jobs of a batch, nullptr when the results are returned by the promises
+        std::shared_ptr<const Callback> callback;
+    };
+
+    /**
+     * \brief Queue of jobs of a worker, the worker takes the last job pushed and the others steal the first one
+     */
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    /**
+     * \brief Flow field a worker calculates in, with the batch its map was last copied for
+     */
+    struct Scratch
+    {
+        std::unique_ptr<FlowField> field;
+        std::uint64_t batch = 0;
+    };
+
+    /**
+     * \brief Spread the jobs of a batch over the queues of the workers and wake them
+     */
+    void push(const FlowField& map, const std::vector<Request>& requests, std::vector<std::promise<Result>>* promises,
+              const std::shared_ptr<const Callback>& callback);
+
+    void work(int worker);
+
+    /**
+     * \brief Take a job from the queue of a worker, or steal one from the other queues
+     * \return false if every queue is empty
+     */
+    bool takeJob(int worker, Job& job);
+
+    void runJob(Job& job, Scratch& scratch) const;
+
+    std::vector<Queue> m_queues;
+    std::vector<std::thread> m_workers;
+
+    // Worker whose queue receives the next job, so consecutive batches start on different workers
+    int m_nextQueue;
+    std::uint64_t m_batchCount;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_doneCondition;
+    bool m_isStopping;
+
+    // Jobs waiting in a queue, and jobs not done yet (waiting or running)
+    std::atomic<int> m_queuedJobCount;
+    int m_unfinishedJobCount;
+
+    std::atomic<int> m_stolenJobCount;
+};
+
+
+#endif //LAB6FLOWFIELD_FLOWFIELDJOBS_HPP
@@ -0,0 +1,612 @@
+#include "HierarchicalFlowField.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    // The 8 neighbours of a cell, in the same order as FlowField
+    constexpr int NeighbourCount = 8;
+    constexpr int NeighbourX[NeighbourCount] = {-1, 0, 1, -1, 1, -1, 0, 1};
+    constexpr int NeighbourY[NeighbourCount] = {-1, -1, -1, 0, 0, 1, 1, 1};
+    constexpr bool IsDiagonal[NeighbourCount] = {true, false, true, false, false, true, false, true};
+
+    constexpr int MaxTerrainCost = 255;
+
+    // Longer runs are split into several portals, so the route can pick where to cross a wide opening
+    constexpr int MaxPortalLength = 16;
+
+    // Parent of the nodes reached straight from the goal, in its region
+    constexpr int GoalParent = -2;
+    constexpr int NoParent = -1;
+}
+
+HierarchicalFlowField::HierarchicalFlowField(const FlowField& map, const int sectorSize) :
+    m_map(map),
+    m_width(map.getWidth()),
+    m_height(map.getHeight()),
+    m_sectorSize(sectorSize),
+    m_sectorsPerRow((map.getWidth() + sectorSize - 1) / sectorSize),
+    m_sectorsPerColumn((map.getHeight() + sectorSize - 1) / sectorSize),
+    m_builtVersion(0),
+    m_isBuilt(false),
+    m_cellRegions(map.getCellCount(), -1),
+    m_routeFieldCount(0),
+    m_builtFieldCount(0),
+    m_paddedSize(sectorSize + 2),
+    m_loadedSector(-1),
+    m_sectorCosts((sectorSize + 2) * (sectorSize + 2), 0),
+    m_sectorDistances((sectorSize + 2) * (sectorSize + 2), FlowField::Unvisited),
+    m_bucketQueue(MaxTerrainCost * FlowField::DiagonalStepCost)
+{
+}
+
+void HierarchicalFlowField::build()
+{
+    const int sectorCount = getSectorCount();
+
+    m_regionSectors.clear();
+    m_portals.clear();
+    m_nodeRegions.clear();
+    m_nodeCells.clear();
+    m_loadedSector = -1;
+    clearSectorFields();
+
+    for (int sector = 0; sector < sectorCount; sector++)
+    {
+        labelRegions(sector);
+    }
+
+    const int regionCount = getRegionCount();
+    m_regionNodes.assign(regionCount, {});
+    m_routeFields.assign(regionCount, nullptr);
+    m_isStartRegion.assign(regionCount, 0);
+
+    for (int sector = 0; sector < sectorCount; sector++)
+    {
+        const int originX = getSectorOriginX(sector);
+        const int originY = getSectorOriginY(sector);
+        const int sectorWidth = getSectorWidth(sector);
+        const int sectorHeight = getSectorHeight(sector);
+
+        // Border with the sector on the right
+        const int rightX = originX + sectorWidth;
+        if (rightX < m_width)
+        {
+            int runStart = -1;
+            for (int y = originY; y <= originY + sectorHeight; y++)
+            {
+                const bool isPassable = y < originY + sectorHeight &&
+                    !m_map.isObstacle(m_map.toIndex(rightX - 1, y)) && !m_map.isObstacle(m_map.toIndex(rightX, y));
+
+                if (isPassable && runStart == -1) runStart = y;
+                if (!isPassable && runStart != -1)
+                {
+                    addPortal(m_map.toIndex(rightX - 1, runStart), m_map.toIndex(rightX, runStart), y - runStart,
+                              m_width);
+                    runStart = -1;
+                }
+            }
+        }
+
+        // Border with the sector below
+        const int bottomY = originY + sectorHeight;
+        if (bottomY < m_height)
+        {
+            int runStart = -1;
+            for (int x = originX; x <= originX + sectorWidth; x++)
+            {
+                const bool isPassable = x < originX + sectorWidth &&
+                    !m_map.isObstacle(m_map.toIndex(x, bottomY - 1)) && !m_map.isObstacle(m_map.toIndex(x, bottomY));
+
+                if (isPassable && runStart == -1) runStart = x;
+                if (!isPassable && runStart != -1)
+                {
+                    addPortal(m_map.toIndex(runStart, bottomY - 1), m_map.toIndex(runStart, bottomY), x - runStart, 1);
+                    runStart = -1;
+                }
+            }
+
+            // Diagonal steps down from the bottom row, to the sector below or to a corner
+            for (int x = originX; x < originX + sectorWidth; x++)
+            {
+                const int cell = m_map.toIndex(x, bottomY - 1);
+                if (x > 0) addDiagonalPortal(cell, m_map.toIndex(x - 1, bottomY));
+                if (x < m_width - 1) addDiagonalPortal(cell, m_map.toIndex(x + 1, bottomY));
+            }
+        }
+
+        // Diagonal steps down from the side columns to the sectors on the left and on the right, the bottom row is
+        // done above
+        for (int y = originY; y < originY + sectorHeight - 1; y++)
+        {
+            if (originX > 0) addDiagonalPortal(m_map.toIndex(originX, y), m_map.toIndex(originX - 1, y + 1));
+            if (rightX < m_width) addDiagonalPortal(m_map.toIndex(rightX - 1, y), m_map.toIndex(rightX, y + 1));
+        }
+    }
+
+    // Crossing a portal is a step into the cell on the other side
+    const int nodeCount = static_cast<int>(m_nodeCells.size());
+    m_edges.assign(nodeCount, {});
+    for (int node = 0; node < nodeCount; node++)
+    {
+        const int otherSide = node ^ 1;
+        const int stepCost = m_portals[node / 2].isDiagonal ? FlowField::DiagonalStepCost : FlowField::StraightStepCost;
+        m_edges[node].push_back({otherSide, m_map.getTerrainCost(m_nodeCells[otherSide]) * stepCost});
+    }
+
+    // Shortest paths between the portals of a same region
+    for (int region = 0; region < regionCount; region++)
+    {
+        for (const int node : m_regionNodes[region])
+        {
+            m_sources.assign(1, m_nodeCells[node]);
+            searchSector(m_regionSectors[region], m_sources);
+
+            for (const int other : m_regionNodes[region])
+            {
+                if (other == node) continue;
+
+                m_edges[node].push_back({other, m_sectorDistances[toPaddedIndex(m_nodeCells[other])]});
+            }
+        }
+    }
+
+    m_builtVersion = m_map.getMapVersion();
+    m_isBuilt = true;
+}
+
+bool HierarchicalFlowField::calculate(const int goalX, const int goalY, const std::vector<int>& startCells)
+{
+    if (!m_isBuilt || m_builtVersion != m_map.getMapVersion()) build();
+
+    std::fill(m_routeFields.begin(), m_routeFields.end(), nullptr);
+    m_routeFieldCount = 0;
+    m_builtFieldCount = 0;
+
+    if (!m_map.isInside(goalX, goalY)) return false;
+
+    const int goalIndex = m_map.toIndex(goalX, goalY);
+    if (m_map.isObstacle(goalIndex)) return false;
+
+    // The field of the goal region also gives the distance from the goal to its portals
+    const int goalRegion = m_cellRegions[goalIndex];
+    m_routeFields[goalRegion] = findSectorField(m_regionSectors[goalRegion], -1, goalIndex);
+    m_routeFieldCount++;
+
+    const int nodeCount = static_cast<int>(m_nodeCells.size());
+    m_nodeDistances.assign(nodeCount, INT_MAX);
+    m_nodeParents.assign(nodeCount, NoParent);
+    m_nodeHeap.clear();
+
+    m_sources.assign(1, goalIndex);
+    searchSector(m_regionSectors[goalRegion], m_sources);
+    for (const int node : m_regionNodes[goalRegion])
+    {
+        const int distance = m_sectorDistances[toPaddedIndex(m_nodeCells[node])];
+
+        m_nodeDistances[node] = distance;
+        m_nodeParents[node] = GoalParent;
+        m_nodeHeap.emplace_back(distance, node);
+        std::push_heap(m_nodeHeap.begin(), m_nodeHeap.end(), std::greater<>());
+    }
+
+    // The search over the portals can stop once every portal of the start regions has its final distance
+    int remainingNodeCount = 0;
+    for (const int start : startCells)
+    {
+        const int region = m_cellRegions[start];
+        if (region == -1 || m_isStartRegion[region] || m_routeFields[region]) continue;
+
+        m_isStartRegion[region] = 1;
+        remainingNodeCount += static_cast<int>(m_regionNodes[region].size());
+    }
+
+    while (!m_nodeHeap.empty() && remainingNodeCount > 0)
+    {
+        std::pop_heap(m_nodeHeap.begin(), m_nodeHeap.end(), std::greater<>());
+        const auto [distance, node] = m_nodeHeap.back();
+        m_nodeHeap.pop_back();
+
+        if (distance > m_nodeDistances[node]) continue;
+        if (m_isStartRegion[m_nodeRegions[node]]) remainingNodeCount--;
+
+        for (const Edge& edge : m_edges[node])
+        {
+            const int edgeDistance = distance + edge.cost;
+            if (edgeDistance >= m_nodeDistances[edge.node]) continue;
+
+            m_nodeDistances[edge.node] = edgeDistance;
+            m_nodeParents[edge.node] = node;
+            m_nodeHeap.emplace_back(edgeDistance, edge.node);
+            std::push_heap(m_nodeHeap.begin(), m_nodeHeap.end(), std::greater<>());
+        }
+    }
+
+    // Each region leaves through its portal the closest to the goal, whatever the start. The distance of that portal
+    // decreases from one region to the next one, so the routes of all the starts share their fields without a loop.
+    for (const int start : startCells)
+    {
+        int region = m_cellRegions[start];
+        while (region != -1 && !m_routeFields[region])
+        {
+            int exit = -1;
+            for (const int node : m_regionNodes[region])
+            {
+                if (m_nodeParents[node] != (node ^ 1)) continue;
+                if (exit == -1 || m_nodeDistances[node] < m_nodeDistances[exit]) exit = node;
+            }
+
+            // The goal cannot be reached from this region
+            if (exit == -1) break;
+
+            m_routeFields[region] = findSectorField(m_regionSectors[region], exit, goalIndex);
+            m_routeFieldCount++;
+
+            region = m_nodeRegions[exit ^ 1];
+        }
+    }
+
+    for (const int start : startCells)
+    {
+        if (m_cellRegions[start] != -1) m_isStartRegion[m_cellRegions[start]] = 0;
+    }
+
+    return true;
+}
+
+int HierarchicalFlowField::getNextIndex(const int index) const
+{
+    return FlowField::getNextIndex(index, getDirectionCode(index), m_width);
+}
+
+FlowField::Direction HierarchicalFlowField::getDirection(const int index) const
+{
+    return FlowField::decodeDirection(getDirectionCode(index));
+}
+
+std::uint8_t HierarchicalFlowField::getDirectionCode(const int index) const
+{
+    const int region = m_cellRegions[index];
+    if (region == -1 || !m_routeFields[region]) return FlowField::NoDirectionCode;
+
+    return m_routeFields[region]->codes[toLocalIndex(index)];
+}
+
+FlowField::Direction HierarchicalFlowField::sampleDirection(const float gridX, const float gridY) const
+{
+    return FlowField::sampleDirections(m_width, m_height, gridX, gridY, [this](const int index)
+    {
+        return getDirection(index);
+    });
+}
+
+int HierarchicalFlowField::getSectorSize() const
+{
+    return m_sectorSize;
+}
+
+int HierarchicalFlowField::getSectorCount() const
+{
+    return m_sectorsPerRow * m_sectorsPerColumn;
+}
+
+int HierarchicalFlowField::getRegionCount() const
+{
+    return static_cast<int>(m_regionSectors.size());
+}
+
+int HierarchicalFlowField::getPortalCount() const
+{
+    return static_cast<int>(m_portals.size());
+}
+
+int HierarchicalFlowField::getRouteFieldCount() const
+{
+    return m_routeFieldCount;
+}
+
+int HierarchicalFlowField::getBuiltFieldCount() const
+{
+    return m_builtFieldCount;
+}
+
+int HierarchicalFlowField::getCachedFieldCount() const
+{
+    return static_cast<int>(m_sectorFields.size());
+}
+
+void HierarchicalFlowField::clearSectorFields()
+{
+    std::fill(m_routeFields.begin(), m_routeFields.end(), nullptr);
+    m_routeFieldCount = 0;
+    m_sectorFields.clear();
+}
+
+void HierarchicalFlowField::labelRegions(const int sector)
+{
+    const int originX = getSectorOriginX(sector);
+    const int originY = getSectorOriginY(sector);
+    const int sectorWidth = getSectorWidth(sector);
+    const int sectorHeight = getSectorHeight(sector);
+
+    for (int y = originY; y < originY + sectorHeight; y++)
+    {
+        for (int x = originX; x < originX + sectorWidth; x++)
+        {
+            m_cellRegions[m_map.toIndex(x, y)] = -1;
+        }
+    }
+
+    for (int y = originY; y < originY + sectorHeight; y++)
+    {
+        for (int x = originX; x < originX + sectorWidth; x++)
+        {
+            const int seed = m_map.toIndex(x, y);
+            if (m_map.isObstacle(seed) || m_cellRegions[seed] != -1) continue;
+
+            const int region = getRegionCount();
+            m_regionSectors.push_back(sector);
+            m_cellRegions[seed] = region;
+
+            // Same moves as searchSector(), so a search reaches exactly the region it starts in
+            m_sources.assign(1, seed);
+            while (!m_sources.empty())
+            {
+                const int current = m_sources.back();
+                m_sources.pop_back();
+
+                for (int direction = 0; direction < NeighbourCount; direction++)
+                {
+                    const int neighbourX = current % m_width + NeighbourX[direction];
+                    const int neighbourY = current / m_width + NeighbourY[direction];
+                    if (neighbourX < originX || neighbourX >= originX + sectorWidth ||
+                        neighbourY < originY || neighbourY >= originY + sectorHeight)
+                        continue;
+
+                    const int neighbour = m_map.toIndex(neighbourX, neighbourY);
+                    if (m_map.isObstacle(neighbour) || m_cellRegions[neighbour] != -1) continue;
+
+                    m_cellRegions[neighbour] = region;
+                    m_sources.push_back(neighbour);
+                }
+            }
+        }
+    }
+}
+
+void HierarchicalFlowField::addPortal(const int firstCellA, const int firstCellB, const int length, const int step)
+{
+    if (length > MaxPortalLength)
+    {
+        addPortal(firstCellA, firstCellB, MaxPortalLength, step);
+        addPortal(firstCellA + MaxPortalLength * step, firstCellB + MaxPortalLength * step,
+                  length - MaxPortalLength, step);
+        return;
+    }
+
+    const int middle = length / 2 * step;
+    m_portals.push_back({{firstCellA, firstCellB}, length, step, false});
+    addPortalNodes(firstCellA + middle, firstCellB + middle);
+}
+
+void HierarchicalFlowField::addDiagonalPortal(const int cellA, const int cellB)
+{
+    if (m_map.isObstacle(cellA) || m_map.isObstacle(cellB)) return;
+
+    // The cells along the step: beside cellA in its row, and above cellB in its column
+    const int besideA = cellA - cellA % m_width + cellB % m_width;
+    const int aboveB = cellB - cellB % m_width + cellA % m_width;
+    if (!m_map.isObstacle(besideA) || !m_map.isObstacle(aboveB)) return;
+
+    m_portals.push_back({{cellA, cellB}, 1, 0, true});
+    addPortalNodes(cellA, cellB);
+}
+
+void HierarchicalFlowField::addPortalNodes(const int cellA, const int cellB)
+{
+    for (const int cell : {cellA, cellB})
+    {
+        const int region = m_cellRegions[cell];
+        m_regionNodes[region].push_back(static_cast<int>(m_nodeCells.size()));
+        m_nodeRegions.push_back(region);
+        m_nodeCells.push_back(cell);
+    }
+}
+
+void HierarchicalFlowField::loadSector(const int sector)
+{
+    if (sector == m_loadedSector) return;
+
+    const int originX = getSectorOriginX(sector);
+    const int originY = getSectorOriginY(sector);
+    const int sectorWidth = getSectorWidth(sector);
+    const int sectorHeight = getSectorHeight(sector);
+
+    // The border, and the cells past the edge of the map for the last sectors, stay impassable
+    std::fill(m_sectorCosts.begin(), m_sectorCosts.end(), 0);
+    for (int y = 0; y < sectorHeight; y++)
+    {
+        for (int x = 0; x < sectorWidth; x++)
+        {
+            const int index = m_map.toIndex(originX + x, originY + y);
+            m_sectorCosts[x + 1 + m_paddedSize * (y + 1)] = m_map.isObstacle(index) ? 0 : m_map.getTerrainCost(index);
+        }
+    }
+
+    m_loadedSector = sector;
+}
+
+void HierarchicalFlowField::searchSector(const int sector, const std::vector<int>& sources)
+{
+    loadSector(sector);
+
+    std::fill(m_sectorDistances.begin(), m_sectorDistances.end(), FlowField::Unvisited);
+    m_bucketQueue.clear();
+
+    for (const int source : sources)
+    {
+        const int padded = toPaddedIndex(source);
+        if (m_sectorCosts[padded] == 0) continue;
+
+        m_sectorDistances[padded] = 0;
+        m_bucketQueue.push(0, padded);
+    }
+
+    int neighbourOffsets[NeighbourCount];
+    for (int direction = 0; direction < NeighbourCount; direction++)
+    {
+        neighbourOffsets[direction] = NeighbourX[direction] + m_paddedSize * NeighbourY[direction];
+    }
+
+    int distance;
+    int current;
+    while (m_bucketQueue.pop(distance, current))
+    {
+        // Stale entry, the cell has been reached by a shorter path since it was pushed
+        if (distance > m_sectorDistances[current]) continue;
+
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int neighbour = current + neighbourOffsets[direction];
+            const int terrainCost = m_sectorCosts[neighbour];
+            if (terrainCost == 0) continue;
+
+            const int stepCost = IsDiagonal[direction] ? FlowField::DiagonalStepCost : FlowField::StraightStepCost;
+            const int neighbourDistance = distance + terrainCost * stepCost;
+
+            int& storedDistance = m_sectorDistances[neighbour];
+            if (storedDistance != FlowField::Unvisited && storedDistance <= neighbourDistance) continue;
+
+            storedDistance = neighbourDistance;
+            m_bucketQueue.push(neighbourDistance, neighbour);
+        }
+    }
+}
+
+const HierarchicalFlowField::SectorField* HierarchicalFlowField::findSectorField(const int sector, const int node,
+                                                                                   const int goalIndex)
+{
+    const int key = node >= 0 ? node : static_cast<int>(m_nodeCells.size()) + goalIndex;
+    std::unique_ptr<SectorField>& field = m_sectorFields[key];
+    if (field) return field.get();
+
+    field = std::make_unique<SectorField>();
+    m_builtFieldCount++;
+
+    if (node < 0)
+    {
+        m_sources.assign(1, goalIndex);
+        searchSector(sector, m_sources);
+        fillSectorField(sector, *field, FlowField::NoDirectionCode);
+        return field.get();
+    }
+
+    // Every cell of the portal run leads through the border to the cell on the other side, straight or diagonally
+    const Portal& portal = m_portals[node / 2];
+    const int side = node % 2;
+    const int from = portal.firstCells[side];
+    const int to = portal.firstCells[1 - side];
+    const int crossingX = to % m_width - from % m_width;
+    const int crossingY = to / m_width - from / m_width;
+
+    m_sources.clear();
+    for (int i = 0; i < portal.length; i++)
+    {
+        m_sources.push_back(portal.firstCells[side] + i * portal.step);
+    }
+
+    searchSector(sector, m_sources);
+    fillSectorField(sector, *field, FlowField::encodeDirection({
+                        static_cast<float>(crossingX), static_cast<float>(crossingY)
+                    }));
+
+    return field.get();
+}
+
+void HierarchicalFlowField::fillSectorField(const int sector, SectorField& field, const std::uint8_t sourceCode) const
+{
+    const int sectorWidth = getSectorWidth(sector);
+    const int sectorHeight = getSectorHeight(sector);
+
+    int neighbourOffsets[NeighbourCount];
+    for (int direction = 0; direction < NeighbourCount; direction++)
+    {
+        neighbourOffsets[direction] = NeighbourX[direction] + m_paddedSize * NeighbourY[direction];
+    }
+
+    field.codes.assign(m_sectorSize * m_sectorSize, FlowField::NoDirectionCode);
+
+    for (int y = 0; y < sectorHeight; y++)
+    {
+        for (int x = 0; x < sectorWidth; x++)
+        {
+            const int padded = x + 1 + m_paddedSize * (y + 1);
+            const int distance = m_sectorDistances[padded];
+            if (distance == FlowField::Unvisited) continue;
+
+            // Only the sources have a distance of 0, every step costs something
+            std::uint8_t& code = field.codes[x + m_sectorSize * y];
+            if (distance == 0)
+            {
+                code = sourceCode;
+                continue;
+            }
+
+            // The border around the sector is never reached, so the flow never leaves the sector
+            int lowestDistance = INT_MAX;
+            for (int direction = 0; direction < NeighbourCount; direction++)
+            {
+                const int neighbourDistance = m_sectorDistances[padded + neighbourOffsets[direction]];
+                if (neighbourDistance == FlowField::Unvisited || neighbourDistance >= lowestDistance) continue;
+
+                code = static_cast<std::uint8_t>(direction);
+                lowestDistance = neighbourDistance;
+            }
+        }
+    }
+}
+
+int HierarchicalFlowField::getSectorOf(const int index) const
+{
+    const int x = index % m_width;
+    const int y = index / m_width;
+
+    return x / m_sectorSize + m_sectorsPerRow * (y / m_sectorSize);
+}
+
+int HierarchicalFlowField::toLocalIndex(const int index) const
+{
+    const int x = index % m_width;
+    const int y = index / m_width;
+
+    return x % m_sectorSize + m_sectorSize * (y % m_sectorSize);
+}
+
+int HierarchicalFlowField::toPaddedIndex(const int index) const
+{
+    const int x = index % m_width;
+    const int y = index / m_width;
+
+    return x % m_sectorSize + 1 + m_paddedSize * (y % m_sectorSize + 1);
+}
+
+int HierarchicalFlowField::getSectorOriginX(const int sector) const
+{
+    return sector % m_sectorsPerRow * m_sectorSize;
+}
+
+int HierarchicalFlowField::getSectorOriginY(const int sector) const
+{
+    return sector / m_sectorsPerRow * m_sectorSize;
+}
+
+int HierarchicalFlowField::getSectorWidth(const int sector) const
+{
+    return std::min(m_sectorSize, m_width - getSectorOriginX(sector));
+}
+
+int HierarchicalFlowField::getSectorHeight(const int sector) const
+{
+    return std::min(m_sectorSize, m_height - getSectorOriginY(sector));
+}
@@ -0,0 +1,241 @@
+#ifndef LAB6FLOWFIELD_HIERARCHICALFLOWFIELD_HPP
+#define LAB6FLOWFIELD_HIERARCHICALFLOWFIELD_HPP
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+#include "BucketQueue.hpp"
+#include "FlowField.hpp"
+
+/**
+ * \brief Flow field split into square sectors, only calculated in the sectors on the route from some starts to a goal
+ * \details The map is cut into sectors of sectorSize x sectorSize cells, and each sector into regions: the groups of
+ * cells connected without leaving the sector. Along each border between two sectors, every run of cells passable on
+ * both sides is a portal. A diagonal step from one sector to another (across a border or a corner) between two
+ * obstacles is a portal of its own, the flow field taking it too. Portals are linked into a graph: a portal leads to
+ * the other side of the border, and to the other portals of the same region with the cost of the shortest path inside
+ * the sector.
+ *
+ * calculate() first searches this graph from the goal, then only gives a field to the regions crossed by the routes of
+ * the starts. The field of a region leads to the portal the route leaves through (or to the goal in its region), it
+ * only depends on that portal, so it is kept and reused by every later route going through the same portal.
+ * The work done for a new goal grows with the length of the corridor, not with the size of the map.
+ *
+ * Costs are the ones of the Weighted integrator of FlowField. Paths are a bit longer than with a full field: each
+ * region on the route leads to its portal the closest to the goal, whatever the start, and to the closest cell of that
+ * portal. A diagonal step with a passable cell on either side is not a portal, the route goes around that cell in 2
+ * straight steps instead.
+ * The graph is built again when the map version of the flow field changes.
+ */
+class HierarchicalFlowField
+{
+public:
+    static constexpr int DefaultSectorSize = 32;
+
+    /**
+     * \param map flow field holding the obstacles and terrain costs, its own fields are not used
+     */
+    explicit HierarchicalFlowField(const FlowField& map, int sectorSize = DefaultSectorSize);
+
+    /**
+     * \brief Find the regions and portals of every sector and the costs between them, drop every sector field
+     * \details Done by calculate() when the map has changed, public so it can be measured on its own.
+     */
+    void build();
+
+    /**
+     * \brief Route from each start cell to the goal, and give a field to the regions on these routes
+     * \return false if the goal is outside the grid or an obstacle
+     */
+    bool calculate(int goalX, int goalY, const std::vector<int>& startCells);
+
+    /**
+     * \brief Same as FlowField::getNextIndex(), -1 for the cells of regions off the route
+     */
+    int getNextIndex(int index) const;
+
+    std::uint8_t getDirectionCode(int index) const;
+    FlowField::Direction getDirection(int index) const;
+
+    /**
+     * \brief Same as FlowField::sampleDirection()
+     */
+    FlowField::Direction sampleDirection(float gridX, float gridY) const;
+
+    int getSectorSize() const;
+    int getSectorCount() const;
+    int getRegionCount() const;
+    int getPortalCount() const;
+
+    /**
+     * \brief Number of regions with a field on the route of the last calculate()
+     */
+    int getRouteFieldCount() const;
+
+    /**
+     * \brief Number of sector fields calculated by the last calculate(), the others were reused
+     */
+    int getBuiltFieldCount() const;
+
+    /**
+     * \brief Number of sector fields kept for later routes
+     */
+    int getCachedFieldCount() const;
+
+    void clearSectorFields();
+
+private:
+    /**
+     * \brief Run of cells passable on both sides of the border between two sectors, longer runs being split
+     * \details Side 0 is the sector on the left or on the top, side 1 the one on the right or at the bottom. The node
+     * of side s in the portal graph is 2 * portal + s, placed on the cell in the middle of the run to estimate costs.
+     * A diagonal portal is a run of one cell, side 0 being the upper one.
+     */
+    struct Portal
+    {
+        // First cell of the run on each side
+        int firstCells[2];
+        int length;
+        // Index offset between two cells of the run, 1 for a horizontal border and the width for a vertical one
+        int step;
+        bool isDiagonal;
+    };
+
+    struct Edge
+    {
+        int node;
+        int cost;
+    };
+
+    /**
+     * \brief Direction codes (see FlowField::NoDirectionCode) of the cells of one sector, sectorSize cells per row
+     * \details Only the cells of the region the field was calculated for have a direction.
+     */
+    struct SectorField
+    {
+        std::vector<std::uint8_t> codes;
+    };
+
+    /**
+     * \brief Flood fill the regions of a sector
+     */
+    void labelRegions(int sector);
+
+    /**
+     * \brief Add the portals of a run of cells along a border, starting at firstCellA on side 0 and firstCellB on side 1
+     */
+    void addPortal(int firstCellA, int firstCellB, int length, int step);
+
+    /**
+     * \brief Add the portal of a diagonal step from cellA, in the row above, to cellB if both cells along the step are
+     * obstacles, which leaves no straight portal between the two regions there
+     */
+    void addDiagonalPortal(int cellA, int cellB);
+
+    /**
+     * \brief Add the nodes of the last portal, on cellA on side 0 and cellB on side 1
+     */
+    void addPortalNodes(int cellA, int cellB);
+
+    /**
+     * \brief Copy the terrain costs of a sector into m_sectorCosts, if it is not the last sector loaded
+     */
+    void loadSector(int sector);
+
+    /**
+     * \brief Weighted search from some cells, without leaving their sector
+     * \details The distances are stored in m_sectorDistances, by padded index (see toPaddedIndex()).
+     */
+    void searchSector(int sector, const std::vector<int>& sources);
+
+    /**
+     * \brief Field of a region leading to a node of the portal graph (or to the goal if node is -1), calculated if it
+     * is not cached yet
+     */
+    const SectorField* findSectorField(int sector, int node, int goalIndex);
+
+    /**
+     * \brief Compute a sector field from the distances of the last searchSector()
+     * \param sourceCode direction of the cells the search started from
+     */
+    void fillSectorField(int sector, SectorField& field, std::uint8_t sourceCode) const;
+
+    int getSectorOf(int index) const;
+    /**
+     * \brief Index of a cell in its sector field
+     */
+    int toLocalIndex(int index) const;
+
+    /**
+     * \brief Index of a cell in its sector surrounded by a border of one cell (see m_sectorCosts)
+     */
+    int toPaddedIndex(int index) const;
+    int getSectorOriginX(int sector) const;
+    int getSectorOriginY(int sector) const;
+    int getSectorWidth(int sector) const;
+    int getSectorHeight(int sector) const;
+
+    const FlowField& m_map;
+
+    int m_width;
+    int m_height;
+    int m_sectorSize;
+    int m_sectorsPerRow;
+    int m_sectorsPerColumn;
+
+    // Map version the graph was built for
+    std::uint64_t m_builtVersion;
+    bool m_isBuilt;
+
+    /*
+     * PORTAL GRAPH
+     */
+
+    // Region of each cell, -1 for the obstacles
+    std::vector<int> m_cellRegions;
+    std::vector<int> m_regionSectors;
+
+    std::vector<Portal> m_portals;
+    std::vector<int> m_nodeRegions;
+    std::vector<int> m_nodeCells;
+    std::vector<std::vector<Edge>> m_edges;
+    std::vector<std::vector<int>> m_regionNodes;
+
+    /*
+     * ROUTE
+     */
+
+    // Field of each region on the route, nullptr for the others
+    std::vector<const SectorField*> m_routeFields;
+    int m_routeFieldCount;
+    int m_builtFieldCount;
+
+    // Key: node of the portal the field leads to, or node count + goal index for the fields leading to a goal
+    std::unordered_map<int, std::unique_ptr<SectorField>> m_sectorFields;
+
+    /*
+     * SEARCH PROPERTIES, reused between calculations
+     */
+
+    // Size of a row of the sector with its border
+    int m_paddedSize;
+    int m_loadedSector;
+
+    // Terrain cost of each cell of the loaded sector and of the border around it, 0 if impassable. The border is
+    // always impassable so the searches never need to check whether they leave the sector.
+    std::vector<std::uint8_t> m_sectorCosts;
+    std::vector<int> m_sectorDistances;
+    BucketQueue m_bucketQueue;
+
+    std::vector<int> m_nodeDistances;
+    std::vector<int> m_nodeParents;
+    std::vector<std::uint8_t> m_isStartRegion;
+    std::vector<std::pair<int, int>> m_nodeHeap;
+    std::vector<int> m_sources;
+};
+
+
+#endif //LAB6FLOWFIELD_HIERARCHICALFLOWFIELD_HPP
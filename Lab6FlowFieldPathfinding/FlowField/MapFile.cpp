@@ -0,0 +1,439 @@
+#include "MapFile.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char Magic[8] = {'F', 'L', 'O', 'W', 'M', 'A', 'P', '\0'};
+
+    // Every layer starts on a cache line
+    constexpr std::uint64_t LayerAlignment = 64;
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t fieldCount;
+        std::int32_t width;
+        std::int32_t height;
+        float cellSize;
+        std::uint32_t rowWordCount;
+        std::uint64_t obstaclesOffset;
+        std::uint64_t terrainOffset;
+        std::uint64_t fieldsOffset;
+        std::uint64_t fileSize;
+    };
+    static_assert(sizeof(Header) == 64, "The header is part of the file format");
+
+    struct FieldHeader
+    {
+        std::int32_t goalIndex;
+        std::uint32_t integrator;
+        std::uint64_t integrationsOffset;
+        std::uint64_t directionsOffset;
+        std::uint64_t reserved;
+    };
+    static_assert(sizeof(FieldHeader) == 32, "The field table is part of the file format");
+
+    const Header& headerOf(const std::uint8_t* data)
+    {
+        return *reinterpret_cast<const Header*>(data);
+    }
+
+    std::uint64_t align(const std::uint64_t offset)
+    {
+        return (offset + LayerAlignment - 1) / LayerAlignment * LayerAlignment;
+    }
+
+    /**
+     * \brief Whether a layer of a file is inside it, and aligned for the values it holds
+     */
+    bool isInFile(const std::uint64_t fileSize, const std::uint64_t offset, const std::uint64_t size,
+                  const std::uint64_t valueSize)
+    {
+        return offset % valueSize == 0 && offset <= fileSize && size <= fileSize - offset;
+    }
+
+    /**
+     * \brief Write zeros until a position of the file
+     */
+    void pad(std::ofstream& out, std::uint64_t& position, const std::uint64_t offset)
+    {
+        const char zeros[LayerAlignment] = {};
+        out.write(zeros, static_cast<std::streamsize>(offset - position));
+        position = offset;
+    }
+
+    template <typename T>
+    void write(std::ofstream& out, std::uint64_t& position, const T* values, const std::size_t count)
+    {
+        out.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(sizeof(T) * count));
+        position += sizeof(T) * count;
+    }
+}
+
+MapFile::Field::Field(const int width, const int height, const int goalIndex, const FlowField::Integrator integrator,
+                      const std::int32_t* integrations, const std::uint8_t* directionCodes) :
+    m_width(width),
+    m_height(height),
+    m_goalIndex(goalIndex),
+    m_integrator(integrator),
+    m_integrations(integrations),
+    m_directionCodes(directionCodes)
+{
+}
+
+int MapFile::Field::getGoalIndex() const
+{
+    return m_goalIndex;
+}
+
+FlowField::Integrator MapFile::Field::getIntegrator() const
+{
+    return m_integrator;
+}
+
+int MapFile::Field::getIntegration(const int index) const
+{
+    return m_integrations[index];
+}
+
+std::uint8_t MapFile::Field::getDirectionCode(const int index) const
+{
+    // The codes are not checked by open(), a damaged file must not read outside the direction table
+    return std::min(m_directionCodes[index], FlowField::NoDirectionCode);
+}
+
+FlowField::Direction MapFile::Field::getDirection(const int index) const
+{
+    return FlowField::decodeDirection(getDirectionCode(index));
+}
+
+int MapFile::Field::getNextIndex(const int index) const
+{
+    return FlowField::getNextIndex(index, getDirectionCode(index), m_width);
+}
+
+FlowField::Direction MapFile::Field::sampleDirection(const float gridX, const float gridY) const
+{
+    return FlowField::sampleDirections(m_width, m_height, gridX, gridY, [this](const int index)
+    {
+        return getDirection(index);
+    });
+}
+
+MapFile::MapFile() :
+    m_data(nullptr),
+    m_size(0),
+    m_fileHandle(nullptr),
+    m_mappingHandle(nullptr)
+{
+}
+
+MapFile::~MapFile()
+{
+    close();
+}
+
+bool MapFile::save(const std::string& path, FlowField& field, const std::vector<int>& goals)
+{
+    std::vector<int> savedGoals;
+    for (const int goal : goals)
+    {
+        if (goal < 0 || goal >= field.getCellCount() || field.isObstacle(goal)) continue;
+        if (std::find(savedGoals.begin(), savedGoals.end(), goal) == savedGoals.end()) savedGoals.push_back(goal);
+    }
+
+    const int width = field.getWidth();
+    const int height = field.getHeight();
+    const std::uint64_t cellCount = field.getCellCount();
+    const int rowWordCount = (width + 63) / 64;
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.fieldCount = static_cast<std::uint32_t>(savedGoals.size());
+    header.width = width;
+    header.height = height;
+    header.cellSize = field.getCellSize();
+    header.rowWordCount = static_cast<std::uint32_t>(rowWordCount);
+    header.obstaclesOffset = align(sizeof(Header));
+    header.terrainOffset = align(header.obstaclesOffset + sizeof(std::uint64_t) * rowWordCount * height);
+    header.fieldsOffset = align(header.terrainOffset + cellCount);
+
+    std::vector<FieldHeader> fields;
+    std::uint64_t end = align(header.fieldsOffset + sizeof(FieldHeader) * savedGoals.size());
+    for (const int goal : savedGoals)
+    {
+        FieldHeader fieldHeader{};
+        fieldHeader.goalIndex = goal;
+        fieldHeader.integrator = static_cast<std::uint32_t>(field.getIntegrator());
+        fieldHeader.integrationsOffset = end;
+        fieldHeader.directionsOffset = align(end + sizeof(std::int32_t) * cellCount);
+        end = align(fieldHeader.directionsOffset + cellCount);
+        fields.push_back(fieldHeader);
+    }
+    header.fileSize = end;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    std::uint64_t position = 0;
+    write(out, position, &header, 1);
+
+    pad(out, position, header.obstaclesOffset);
+    std::vector<std::uint64_t> row(rowWordCount);
+    for (int y = 0; y < height; y++)
+    {
+        std::fill(row.begin(), row.end(), 0);
+        for (int x = 0; x < width; x++)
+        {
+            if (field.isObstacle(field.toIndex(x, y))) row[x / 64] |= std::uint64_t(1) << (x % 64);
+        }
+        write(out, position, row.data(), row.size());
+    }
+
+    pad(out, position, header.terrainOffset);
+    std::vector<std::uint8_t> terrainCosts(cellCount);
+    for (int i = 0; i < field.getCellCount(); i++)
+    {
+        terrainCosts[i] = field.getTerrainCost(i);
+    }
+    write(out, position, terrainCosts.data(), terrainCosts.size());
+
+    pad(out, position, header.fieldsOffset);
+    write(out, position, fields.data(), fields.size());
+
+    std::vector<std::int32_t> integrations(cellCount);
+    for (const FieldHeader& fieldHeader : fields)
+    {
+        field.setGoal(fieldHeader.goalIndex % width, fieldHeader.goalIndex / width);
+        field.calculate();
+
+        for (int i = 0; i < field.getCellCount(); i++)
+        {
+            integrations[i] = field.getIntegration(i);
+        }
+
+        pad(out, position, fieldHeader.integrationsOffset);
+        write(out, position, integrations.data(), integrations.size());
+
+        pad(out, position, fieldHeader.directionsOffset);
+        write(out, position, field.getDirectionCodes().data(), field.getDirectionCodes().size());
+    }
+
+    pad(out, position, header.fileSize);
+
+    return static_cast<bool>(out.flush());
+}
+
+bool MapFile::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    m_fileHandle = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || static_cast<std::uint64_t>(size.QuadPart) < sizeof(Header))
+    {
+        close();
+        return false;
+    }
+
+    m_mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mappingHandle == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    m_data = static_cast<const std::uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file == -1) return false;
+
+    struct stat status{};
+    if (fstat(file, &status) != 0 || static_cast<std::uint64_t>(status.st_size) < sizeof(Header))
+    {
+        ::close(file);
+        return false;
+    }
+
+    // The mapping keeps the file alive once its descriptor is closed
+    void* data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED) return false;
+
+    m_data = static_cast<const std::uint8_t*>(data);
+    m_size = static_cast<std::size_t>(status.st_size);
+#endif
+
+    if (m_data == nullptr || !isValid())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MapFile::close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mappingHandle != nullptr) CloseHandle(m_mappingHandle);
+    if (m_fileHandle != nullptr) CloseHandle(m_fileHandle);
+#else
+    if (m_data != nullptr) munmap(const_cast<std::uint8_t*>(m_data), m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_fileHandle = nullptr;
+    m_mappingHandle = nullptr;
+}
+
+bool MapFile::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+int MapFile::getWidth() const
+{
+    return headerOf(m_data).width;
+}
+
+int MapFile::getHeight() const
+{
+    return headerOf(m_data).height;
+}
+
+int MapFile::getCellCount() const
+{
+    return getWidth() * getHeight();
+}
+
+float MapFile::getCellSize() const
+{
+    return headerOf(m_data).cellSize;
+}
+
+bool MapFile::isObstacle(const int index) const
+{
+    const int x = index % getWidth();
+    const int y = index / getWidth();
+    const std::uint64_t* row = getObstacleRows() + headerOf(m_data).rowWordCount * y;
+
+    return (row[x / 64] >> (x % 64) & 1) != 0;
+}
+
+std::uint8_t MapFile::getTerrainCost(const int index) const
+{
+    return getTerrainCosts()[index];
+}
+
+const std::uint64_t* MapFile::getObstacleRows() const
+{
+    return reinterpret_cast<const std::uint64_t*>(m_data + headerOf(m_data).obstaclesOffset);
+}
+
+const std::uint8_t* MapFile::getTerrainCosts() const
+{
+    return m_data + headerOf(m_data).terrainOffset;
+}
+
+void MapFile::loadMap(FlowField& field) const
+{
+    field.setObstacles(getObstacleRows());
+    field.setTerrainCosts(getTerrainCosts());
+}
+
+int MapFile::getFieldCount() const
+{
+    return static_cast<int>(headerOf(m_data).fieldCount);
+}
+
+MapFile::Field MapFile::getField(const int field) const
+{
+    const auto* fields = reinterpret_cast<const FieldHeader*>(m_data + headerOf(m_data).fieldsOffset);
+    const FieldHeader& fieldHeader = fields[field];
+
+    return {getWidth(), getHeight(), fieldHeader.goalIndex,
+            static_cast<FlowField::Integrator>(fieldHeader.integrator),
+            reinterpret_cast<const std::int32_t*>(m_data + fieldHeader.integrationsOffset),
+            m_data + fieldHeader.directionsOffset};
+}
+
+int MapFile::findField(const int goalIndex, const FlowField::Integrator integrator) const
+{
+    for (int i = 0; i < getFieldCount(); i++)
+    {
+        const Field field = getField(i);
+        if (field.getGoalIndex() == goalIndex && field.getIntegrator() == integrator) return i;
+    }
+
+    return -1;
+}
+
+std::size_t MapFile::getSize() const
+{
+    return m_size;
+}
+
+bool MapFile::isValid() const
+{
+    const Header& header = headerOf(m_data);
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FormatVersion) return false;
+    if (header.fileSize != m_size || header.width <= 0 || header.height <= 0) return false;
+    if (header.rowWordCount != static_cast<std::uint32_t>((header.width + 63) / 64)) return false;
+
+    const std::uint64_t cellCount = static_cast<std::uint64_t>(header.width) * header.height;
+    if (cellCount > static_cast<std::uint64_t>(INT_MAX)) return false;
+
+    if (!isInFile(m_size, header.obstaclesOffset, sizeof(std::uint64_t) * header.rowWordCount * header.height,
+                  sizeof(std::uint64_t)) ||
+        !isInFile(m_size, header.terrainOffset, cellCount, 1) ||
+        !isInFile(m_size, header.fieldsOffset, sizeof(FieldHeader) * static_cast<std::uint64_t>(header.fieldCount),
+                  sizeof(std::uint64_t)))
+    {
+        return false;
+    }
+
+    const auto* fields = reinterpret_cast<const FieldHeader*>(m_data + header.fieldsOffset);
+    for (std::uint32_t i = 0; i < header.fieldCount; i++)
+    {
+        const FieldHeader& field = fields[i];
+        if (field.goalIndex < 0 || static_cast<std::uint64_t>(field.goalIndex) >= cellCount) return false;
+        if (field.integrator > static_cast<std::uint32_t>(FlowField::Integrator::Eikonal)) return false;
+        if (!isInFile(m_size, field.integrationsOffset, sizeof(std::int32_t) * cellCount, sizeof(std::int32_t)) ||
+            !isInFile(m_size, field.directionsOffset, cellCount, 1))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,143 @@
+#ifndef LAB6FLOWFIELD_MAPFILE_HPP
+#define LAB6FLOWFIELD_MAPFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FlowField.hpp"
+
+/**
+ * \brief Binary file of a map, with the fields precomputed for some of its goals, read in place from memory
+ * \details The file holds the size of the grid, its obstacles (in the layout of ObstacleMap) and terrain costs (one
+ * byte per cell), then for each precomputed goal its integration field (same values as FlowField::getIntegration())
+ * and its vector field (one direction code per cell). Every layer is stored as it is used in memory and starts on a
+ * 64-byte boundary, so open() maps the file instead of reading it: only the header and the table of fields are
+ * checked, nothing is parsed or copied, and the pages come straight from the page cache the first time they are read.
+ *
+ * The header starts with a format version, a file of another version is refused. The values are stored in the byte
+ * order of the machine which saved the file, little endian on every platform the game targets.
+ */
+class MapFile
+{
+public:
+    static constexpr std::uint32_t FormatVersion = 1;
+
+    /**
+     * \brief Precomputed field of a goal, read from the mapped file, only valid while the file is open
+     */
+    class Field
+    {
+    public:
+        int getGoalIndex() const;
+        FlowField::Integrator getIntegrator() const;
+
+        int getIntegration(int index) const;
+        std::uint8_t getDirectionCode(int index) const;
+        FlowField::Direction getDirection(int index) const;
+
+        /**
+         * \brief Same as FlowField::getNextIndex()
+         */
+        int getNextIndex(int index) const;
+
+        /**
+         * \brief Same as FlowField::sampleDirection()
+         */
+        FlowField::Direction sampleDirection(float gridX, float gridY) const;
+
+    private:
+        friend class MapFile;
+
+        Field(int width, int height, int goalIndex, FlowField::Integrator integrator, const std::int32_t* integrations,
+              const std::uint8_t* directionCodes);
+
+        int m_width;
+        int m_height;
+        int m_goalIndex;
+        FlowField::Integrator m_integrator;
+
+        const std::int32_t* m_integrations;
+        const std::uint8_t* m_directionCodes;
+    };
+
+    MapFile();
+
+    /**
+     * \brief Unmap the file if it is open
+     */
+    ~MapFile();
+
+    MapFile(const MapFile&) = delete;
+    MapFile& operator=(const MapFile&) = delete;
+
+    /**
+     * \brief Write the map of a flow field, with the fields of some goals calculated with its integrator
+     * \details The goal and the fields of the flow field are changed, each goal being calculated in turn. The goals
+     * outside the grid, on an obstacle or already saved are skipped.
+     * \return false if the file could not be written
+     */
+    static bool save(const std::string& path, FlowField& field, const std::vector<int>& goals);
+
+    /**
+     * \brief Map a file in memory, closing the file already open
+     * \return false if the file cannot be read, is not a map file, is of another version or is truncated
+     */
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    int getWidth() const;
+    int getHeight() const;
+    int getCellCount() const;
+    float getCellSize() const;
+
+    bool isObstacle(int index) const;
+    std::uint8_t getTerrainCost(int index) const;
+
+    /**
+     * \brief Obstacles in the layout of ObstacleMap::getRow(), every row one after the other
+     */
+    const std::uint64_t* getObstacleRows() const;
+
+    /**
+     * \brief Terrain costs, one byte per cell in index order
+     */
+    const std::uint8_t* getTerrainCosts() const;
+
+    /**
+     * \brief Copy the obstacles and terrain costs in a flow field of the same size, to edit them or calculate new goals
+     */
+    void loadMap(FlowField& field) const;
+
+    int getFieldCount() const;
+    Field getField(int field) const;
+
+    /**
+     * \brief Find the precomputed field of a goal
+     * \return index of the field, -1 if the goal was not precomputed with this integrator
+     */
+    int findField(int goalIndex, FlowField::Integrator integrator) const;
+
+    /**
+     * \brief Number of bytes of the file
+     */
+    std::size_t getSize() const;
+
+private:
+    /**
+     * \brief Check the header and every offset of the mapped file
+     */
+    bool isValid() const;
+
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+
+    // Handles of the file and of its mapping, only used on Windows
+    void* m_fileHandle;
+    void* m_mappingHandle;
+};
+
+
+#endif //LAB6FLOWFIELD_MAPFILE_HPP
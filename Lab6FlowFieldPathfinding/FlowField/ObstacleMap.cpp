@@ -0,0 +1,239 @@
+#include "ObstacleMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int WordBits = 64;
+
+    /**
+     * \brief Number of bits set in a word, summed by pairs, nibbles then bytes
+     */
+    int countBits(std::uint64_t word)
+    {
+        word = word - (word >> 1 & 0x5555555555555555);
+        word = (word & 0x3333333333333333) + (word >> 2 & 0x3333333333333333);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0F;
+        return static_cast<int>(word * 0x0101010101010101 >> 56);
+    }
+
+    /**
+     * \brief Bits [first, last) of a word, with 0 <= first < last <= 64
+     */
+    std::uint64_t bitRange(const int first, const int last)
+    {
+        const std::uint64_t upper = last == WordBits ? ~std::uint64_t(0) : (std::uint64_t(1) << last) - 1;
+        return upper & ~((std::uint64_t(1) << first) - 1);
+    }
+}
+
+ObstacleMap::ObstacleMap(const int width, const int height) :
+    m_width(width),
+    m_height(height),
+    m_rowWordCount((width + WordBits - 1) / WordBits),
+    m_words(m_rowWordCount * height, 0),
+    m_obstacleCount(0),
+    m_version(0)
+{
+}
+
+int ObstacleMap::getWidth() const
+{
+    return m_width;
+}
+
+int ObstacleMap::getHeight() const
+{
+    return m_height;
+}
+
+int ObstacleMap::getCellCount() const
+{
+    return m_width * m_height;
+}
+
+bool ObstacleMap::isInside(const int x, const int y) const
+{
+    return x >= 0 && x < m_width && y >= 0 && y < m_height;
+}
+
+bool ObstacleMap::isObstacle(const int x, const int y) const
+{
+    if (!isInside(x, y)) return false;
+
+    return (m_words[x / WordBits + m_rowWordCount * y] >> (x % WordBits) & 1) != 0;
+}
+
+bool ObstacleMap::isObstacle(const int index) const
+{
+    return isObstacle(index % m_width, index / m_width);
+}
+
+void ObstacleMap::setObstacle(const int x, const int y, const bool isObstacle)
+{
+    if (!isInside(x, y)) return;
+
+    if (fillSpan(y, x, x + 1, isObstacle)) m_version++;
+}
+
+void ObstacleMap::fillRect(const int left, const int top, const int width, const int height, const bool isObstacle)
+{
+    const int first = std::max(left, 0);
+    const int last = std::min(left + width, m_width);
+    if (first >= last) return;
+
+    bool isChanged = false;
+    for (int y = std::max(top, 0); y < std::min(top + height, m_height); y++)
+    {
+        isChanged |= fillSpan(y, first, last, isObstacle);
+    }
+
+    if (isChanged) m_version++;
+}
+
+void ObstacleMap::fillPolygon(const std::vector<Point>& vertices, const bool isObstacle)
+{
+    if (vertices.size() < 3) return;
+
+    float minY = vertices[0].y;
+    float maxY = vertices[0].y;
+    for (const Point& vertex : vertices)
+    {
+        minY = std::min(minY, vertex.y);
+        maxY = std::max(maxY, vertex.y);
+    }
+
+    const int firstRow = std::max(static_cast<int>(std::ceil(minY)), 0);
+    const int lastRow = std::min(static_cast<int>(std::floor(maxY)), m_height - 1);
+
+    bool isChanged = false;
+    std::vector<double>& crossings = m_crossings;
+    for (int y = firstRow; y <= lastRow; y++)
+    {
+        // x of every edge crossing the line through the centers of the row, an edge ending on the line counts once
+        crossings.clear();
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const Point& a = vertices[i];
+            const Point& b = vertices[(i + 1) % vertices.size()];
+            if ((a.y <= static_cast<float>(y)) == (b.y <= static_cast<float>(y))) continue;
+
+            crossings.push_back(a.x + (y - a.y) * static_cast<double>(b.x - a.x) / (b.y - a.y));
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        // Inside between each pair of crossings, the cells whose center x is in [start, end)
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2)
+        {
+            const int first = std::max(static_cast<int>(std::ceil(crossings[i])), 0);
+            const int last = std::min(static_cast<int>(std::ceil(crossings[i + 1])), m_width);
+            if (first < last)
+            {
+                isChanged |= fillSpan(y, first, last, isObstacle);
+            }
+        }
+    }
+
+    if (isChanged) m_version++;
+}
+
+void ObstacleMap::loadMask(const std::vector<std::uint8_t>& mask)
+{
+    bool isChanged = false;
+    int obstacleCount = 0;
+
+    for (int y = 0; y < m_height; y++)
+    {
+        const std::uint8_t* cells = mask.data() + m_width * y;
+        for (int w = 0; w < m_rowWordCount; w++)
+        {
+            const int first = w * WordBits;
+            const int last = std::min(first + WordBits, m_width);
+
+            std::uint64_t word = 0;
+            for (int x = first; x < last; x++)
+            {
+                word |= std::uint64_t(cells[x] != 0) << (x - first);
+            }
+
+            std::uint64_t& current = m_words[w + m_rowWordCount * y];
+            isChanged |= current != word;
+            current = word;
+            obstacleCount += countBits(word);
+        }
+    }
+
+    m_obstacleCount = obstacleCount;
+    if (isChanged) m_version++;
+}
+
+void ObstacleMap::loadRows(const std::uint64_t* rows)
+{
+    // The bits past the width are dropped, so they stay 0
+    const int lastBits = m_width - WordBits * (m_rowWordCount - 1);
+    const std::uint64_t lastMask = bitRange(0, lastBits);
+
+    bool isChanged = false;
+    int obstacleCount = 0;
+    for (int i = 0; i < static_cast<int>(m_words.size()); i++)
+    {
+        const std::uint64_t word = i % m_rowWordCount == m_rowWordCount - 1 ? rows[i] & lastMask : rows[i];
+        isChanged |= m_words[i] != word;
+        m_words[i] = word;
+        obstacleCount += countBits(word);
+    }
+
+    m_obstacleCount = obstacleCount;
+    if (isChanged) m_version++;
+}
+
+void ObstacleMap::clear()
+{
+    if (m_obstacleCount == 0) return;
+
+    std::fill(m_words.begin(), m_words.end(), 0);
+    m_obstacleCount = 0;
+    m_version++;
+}
+
+int ObstacleMap::getObstacleCount() const
+{
+    return m_obstacleCount;
+}
+
+std::uint64_t ObstacleMap::getVersion() const
+{
+    return m_version;
+}
+
+const std::uint64_t* ObstacleMap::getRow(const int y) const
+{
+    return m_words.data() + m_rowWordCount * y;
+}
+
+int ObstacleMap::getRowWordCount() const
+{
+    return m_rowWordCount;
+}
+
+bool ObstacleMap::fillSpan(const int y, const int first, const int last, const bool isObstacle)
+{
+    std::uint64_t* row = m_words.data() + m_rowWordCount * y;
+
+    bool isChanged = false;
+    for (int w = first / WordBits; w <= (last - 1) / WordBits; w++)
+    {
+        const int wordStart = w * WordBits;
+        const std::uint64_t mask = bitRange(std::max(first - wordStart, 0), std::min(last - wordStart, WordBits));
+
+        const std::uint64_t previous = row[w];
+        row[w] = isObstacle ? previous | mask : previous & ~mask;
+        if (row[w] == previous) continue;
+
+        m_obstacleCount += countBits(row[w]) - countBits(previous);
+        isChanged = true;
+    }
+
+    return isChanged;
+}
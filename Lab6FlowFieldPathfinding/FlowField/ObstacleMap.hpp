@@ -0,0 +1,110 @@
+#ifndef LAB6FLOWFIELD_OBSTACLEMAP_HPP
+#define LAB6FLOWFIELD_OBSTACLEMAP_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Obstacles of a grid, packed in a bitmap of one bit per cell
+ * \details Testing, setting or clearing a cell is a single bit operation. Each row starts on a new 64-bit word, so the
+ * bulk edits (rectangles, polygons, masks) write the cells of a row a whole word at a time instead of cell by cell.
+ * Applied to a flow field in one pass with FlowField::setObstacles().
+ */
+class ObstacleMap
+{
+public:
+    /**
+     * \brief Vertex of a polygon, in grid coordinates: the center of the cell (x, y) is at (x, y)
+     */
+    struct Point
+    {
+        float x;
+        float y;
+    };
+
+    /**
+     * \param width number of cells on the x axis
+     * \param height number of cells on the y axis
+     */
+    ObstacleMap(int width, int height);
+
+    int getWidth() const;
+    int getHeight() const;
+    int getCellCount() const;
+
+    bool isInside(int x, int y) const;
+
+    /**
+     * \return false for the cells outside the grid
+     */
+    bool isObstacle(int x, int y) const;
+    bool isObstacle(int index) const;
+
+    /**
+     * \brief Mark or unmark a cell as impassable, the cells outside the grid are ignored
+     */
+    void setObstacle(int x, int y, bool isObstacle);
+
+    /**
+     * \brief Mark or unmark every cell of a rectangle, clipped to the grid
+     */
+    void fillRect(int left, int top, int width, int height, bool isObstacle);
+
+    /**
+     * \brief Mark or unmark every cell whose center is inside a polygon
+     * \details Rasterised row by row: each row fills the spans between the edges crossing it (even-odd rule, so the
+     * polygon may be concave or self-intersecting). The vertices are in order, the last one is joined to the first.
+     */
+    void fillPolygon(const std::vector<Point>& vertices, bool isObstacle);
+
+    /**
+     * \brief Replace every cell with a mask of one byte per cell in index order, non zero being an obstacle
+     * \details The mask must have getCellCount() bytes.
+     */
+    void loadMask(const std::vector<std::uint8_t>& mask);
+
+    /**
+     * \brief Replace every cell with the rows of a bitmap in the layout of getRow(), getRowWordCount() words per row
+     */
+    void loadRows(const std::uint64_t* rows);
+
+    void clear();
+
+    /**
+     * \brief Number of cells marked as obstacle
+     */
+    int getObstacleCount() const;
+
+    /**
+     * \brief Version of the map, increased by every edit which changes at least one cell
+     * \details A bulk edit increases it once, whatever the number of cells it changes.
+     */
+    std::uint64_t getVersion() const;
+
+    /**
+     * \brief Words of a row, bit i of word w being the cell x = 64 * w + i, the bits past the width are always 0
+     */
+    const std::uint64_t* getRow(int y) const;
+    int getRowWordCount() const;
+
+private:
+    /**
+     * \brief Mark or unmark the cells [first, last) of a row, already clipped to the grid
+     * \return true if at least one cell changed
+     */
+    bool fillSpan(int y, int first, int last, bool isObstacle);
+
+    int m_width;
+    int m_height;
+    int m_rowWordCount;
+
+    std::vector<std::uint64_t> m_words;
+    int m_obstacleCount;
+    std::uint64_t m_version;
+
+    // x of the edges crossing the row being filled by fillPolygon(), kept to reuse its memory
+    std::vector<double> m_crossings;
+};
+
+
+#endif //LAB6FLOWFIELD_OBSTACLEMAP_HPP
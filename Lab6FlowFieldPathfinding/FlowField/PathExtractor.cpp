@@ -0,0 +1,188 @@
+#include "PathExtractor.hpp"
+
+#include <cstdlib>
+
+#include "FlowField.hpp"
+
+PathExtractor::PathExtractor(const FlowField& field) :
+    m_field(field),
+    m_cellNodes(field.getCellCount(), NoNode)
+{
+}
+
+void PathExtractor::extract(const std::vector<int>& starts)
+{
+    // Only the cells walked by the previous batch have a node
+    for (const int cell : m_nodeCells)
+    {
+        m_cellNodes[cell] = NoNode;
+    }
+
+    m_nodeCells.clear();
+    m_nextNodes.clear();
+    m_nodeLengths.clear();
+    m_nextTurns.clear();
+    m_pathNodes.clear();
+    m_waypoints.clear();
+    m_waypointStarts.clear();
+
+    for (const int start : starts)
+    {
+        const int firstNode = static_cast<int>(m_nodeCells.size());
+
+        // Walk until the end of the flow or a cell already walked
+        int joinedNode = NoNode;
+        int cell = start;
+        while (true)
+        {
+            const int walkedNode = m_cellNodes[cell];
+            if (walkedNode != NoNode)
+            {
+                // Walked by a previous path, the rest is shared. Walked by this path, the flow loops and the path
+                // ends here.
+                if (walkedNode < firstNode) joinedNode = walkedNode;
+                break;
+            }
+
+            m_cellNodes[cell] = static_cast<int>(m_nodeCells.size());
+            m_nodeCells.push_back(cell);
+
+            cell = m_field.getNextIndex(cell);
+            if (cell == -1) break;
+        }
+
+        const int endNode = static_cast<int>(m_nodeCells.size());
+        m_nextNodes.resize(endNode);
+        m_nodeLengths.resize(endNode);
+        m_nextTurns.resize(endNode);
+
+        // From the end of the walk, so the node after each one is already complete
+        for (int node = endNode - 1; node >= firstNode; node--)
+        {
+            const int nextNode = node == endNode - 1 ? joinedNode : node + 1;
+            m_nextNodes[node] = nextNode;
+
+            if (nextNode == NoNode)
+            {
+                m_nodeLengths[node] = 1;
+                m_nextTurns[node] = NoNode;
+                continue;
+            }
+
+            m_nodeLengths[node] = 1 + m_nodeLengths[nextNode];
+
+            const bool isTurn = m_field.getDirectionCode(m_nodeCells[node]) !=
+                m_field.getDirectionCode(m_nodeCells[nextNode]);
+            const bool isEnd = m_nextNodes[nextNode] == NoNode;
+            m_nextTurns[node] = isTurn || isEnd ? nextNode : m_nextTurns[nextNode];
+        }
+
+        m_pathNodes.push_back(firstNode < endNode ? firstNode : joinedNode);
+    }
+}
+
+void PathExtractor::smoothPaths()
+{
+    m_waypoints.clear();
+    m_waypointStarts.clear();
+
+    for (const int firstNode : m_pathNodes)
+    {
+        m_waypointStarts.push_back(static_cast<int>(m_waypoints.size()));
+        m_waypoints.push_back(m_nodeCells[firstNode]);
+
+        // The path goes straight between two turns, so the last turn seen from the anchor always sees the next one
+        int anchorNode = firstNode;
+        int lastNode = firstNode;
+        for (int turnNode = m_nextTurns[firstNode]; turnNode != NoNode; turnNode = m_nextTurns[turnNode])
+        {
+            if (lastNode != anchorNode && !hasLineOfSight(m_nodeCells[anchorNode], m_nodeCells[turnNode]))
+            {
+                m_waypoints.push_back(m_nodeCells[lastNode]);
+                anchorNode = lastNode;
+            }
+
+            lastNode = turnNode;
+        }
+
+        if (lastNode != anchorNode) m_waypoints.push_back(m_nodeCells[lastNode]);
+    }
+
+    m_waypointStarts.push_back(static_cast<int>(m_waypoints.size()));
+}
+
+int PathExtractor::getPathCount() const
+{
+    return static_cast<int>(m_pathNodes.size());
+}
+
+int PathExtractor::getPathLength(const int path) const
+{
+    return m_nodeLengths[m_pathNodes[path]];
+}
+
+void PathExtractor::getPath(const int path, std::vector<int>& cells) const
+{
+    cells.clear();
+    cells.reserve(getPathLength(path));
+    forEachCell(path, [&cells](const int cell)
+    {
+        cells.push_back(cell);
+    });
+}
+
+const int* PathExtractor::getWaypoints(const int path) const
+{
+    return m_waypoints.data() + m_waypointStarts[path];
+}
+
+int PathExtractor::getWaypointCount(const int path) const
+{
+    return m_waypointStarts[path + 1] - m_waypointStarts[path];
+}
+
+int PathExtractor::getWalkedCellCount() const
+{
+    return static_cast<int>(m_nodeCells.size());
+}
+
+bool PathExtractor::hasLineOfSight(const int from, const int to) const
+{
+    const int width = m_field.getWidth();
+    int x = from % width;
+    int y = from / width;
+    const int stepX = to % width > x ? 1 : -1;
+    const int stepY = to / width > y ? 1 : -1;
+    int distanceX = std::abs(to % width - x);
+    int distanceY = std::abs(to / width - y);
+
+    // Every cell crossed by the segment, in order: the sign of error tells if the segment leaves the current cell
+    // through a vertical side (> 0), a horizontal side (< 0) or exactly through a corner (0)
+    int error = distanceX - distanceY;
+    distanceX *= 2;
+    distanceY *= 2;
+    for (int remaining = 1 + (distanceX + distanceY) / 2; remaining > 0; remaining--)
+    {
+        if (m_field.isObstacle(x + width * y)) return false;
+
+        if (error > 0)
+        {
+            x += stepX;
+            error -= distanceY;
+        }
+        else if (error < 0)
+        {
+            y += stepY;
+            error += distanceX;
+        }
+        else
+        {
+            x += stepX;
+            y += stepY;
+            error += distanceX - distanceY;
+            remaining--;
+        }
+    }
+
+    return true;
+}
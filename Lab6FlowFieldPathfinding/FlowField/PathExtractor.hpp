@@ -0,0 +1,113 @@
+#ifndef LAB6FLOWFIELD_PATHEXTRACTOR_HPP
+#define LAB6FLOWFIELD_PATHEXTRACTOR_HPP
+
+#include <vector>
+
+class FlowField;
+
+/**
+ * \brief Paths of many start cells along the flow of a calculated flow field, extracted in one pass
+ * \details Each walked cell is stored once for the whole batch, with the cell walked after it: when a path reaches a
+ * cell already walked by another path, it joins it and shares the rest of its cells instead of walking them again. A
+ * path is therefore a chain of cells, from its start to its end (the goal, or a cell without direction).
+ *
+ * smoothPaths() then pulls each path tight: only the waypoints where the straight line from the previous waypoint
+ * would cross an obstacle are kept, so units which want explicit waypoints do not follow the 8 directions of the flow.
+ */
+class PathExtractor
+{
+public:
+    explicit PathExtractor(const FlowField& field);
+
+    /**
+     * \brief Walk the flow from each start cell
+     * \details The previous paths are discarded, the memory is kept.
+     * \param starts index of the start cell of each path
+     */
+    void extract(const std::vector<int>& starts);
+
+    /**
+     * \brief Compute the waypoints of every path extracted by the last extract()
+     * \details The waypoints are the start, the cells where the path changes direction and the straight line from the
+     * previous waypoint to the next change of direction would cross an obstacle, and the end. The line of sight is the
+     * one of hasLineOfSight(), which only checks the obstacles: a smoothed path can cross a terrain the flow avoided.
+     */
+    void smoothPaths();
+
+    int getPathCount() const;
+
+    /**
+     * \brief Number of cells of a path, its start and its end included
+     */
+    int getPathLength(int path) const;
+
+    /**
+     * \brief Replace the content of cells with the cells of a path, from its start to its end
+     */
+    void getPath(int path, std::vector<int>& cells) const;
+
+    /**
+     * \brief Call visit(cell) for each cell of a path, from its start to its end
+     */
+    template <typename Visitor>
+    void forEachCell(int path, const Visitor& visit) const;
+
+    /**
+     * \brief Waypoints of a path, from its start to its end, only valid after smoothPaths()
+     */
+    const int* getWaypoints(int path) const;
+    int getWaypointCount(int path) const;
+
+    /**
+     * \brief Number of cells walked by the last extract(), each cell shared by several paths being counted once
+     */
+    int getWalkedCellCount() const;
+
+    /**
+     * \brief Whether the segment between the centres of two cells only goes through cells without obstacle
+     * \details A segment going exactly through the corner between two cells does not touch them, like the diagonal
+     * steps of the flow between two obstacles.
+     */
+    bool hasLineOfSight(int from, int to) const;
+
+private:
+    static constexpr int NoNode = -1;
+
+    const FlowField& m_field;
+
+    /*
+     * Walked cells, by order of walk. Each one is a node of a chain, the node after it being the one of the next cell
+     * on the path (or NoNode at the end of the path).
+     */
+
+    std::vector<int> m_nodeCells;
+    std::vector<int> m_nextNodes;
+
+    // Number of cells from the node to the end of its path, itself included
+    std::vector<int> m_nodeLengths;
+
+    // Next node of the chain where the direction changes (or the end of the path), only candidates for the waypoints
+    std::vector<int> m_nextTurns;
+
+    // Node of each cell of the field, NoNode if the cell has not been walked. Only the walked cells are reset.
+    std::vector<int> m_cellNodes;
+
+    // First node of each path
+    std::vector<int> m_pathNodes;
+
+    // Waypoints of all the paths, the ones of a path starting at m_waypointStarts[path], with one more entry at the end
+    std::vector<int> m_waypoints;
+    std::vector<int> m_waypointStarts;
+};
+
+template <typename Visitor>
+void PathExtractor::forEachCell(const int path, const Visitor& visit) const
+{
+    for (int node = m_pathNodes[path]; node != NoNode; node = m_nextNodes[node])
+    {
+        visit(m_nodeCells[node]);
+    }
+}
+
+
+#endif //LAB6FLOWFIELD_PATHEXTRACTOR_HPP
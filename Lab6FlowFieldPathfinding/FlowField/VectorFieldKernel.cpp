@@ -0,0 +1,257 @@
+#include "VectorFieldKernel.hpp"
+
+#include <cstring>
+
+#include "FlowField.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LAB6FLOWFIELD_VECTORFIELD_SSE2
+#endif
+
+// The AVX2 kernel only gets the AVX2 code generation itself, the CPU is checked before it is called
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define LAB6FLOWFIELD_VECTORFIELD_AVX2
+#define LAB6FLOWFIELD_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#define LAB6FLOWFIELD_VECTORFIELD_AVX2
+#define LAB6FLOWFIELD_TARGET_AVX2
+#endif
+#endif
+
+namespace
+{
+    constexpr int NeighbourCount = FlowField::NeighbourCount;
+    constexpr int Unvisited = FlowField::Unvisited;
+    constexpr int Impassable = FlowField::Impassable;
+    constexpr int NoDirectionCode = FlowField::NoDirectionCode;
+
+    bool isAvx2Supported()
+    {
+#if defined(LAB6FLOWFIELD_VECTORFIELD_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+        int registers[4];
+        __cpuid(registers, 0);
+        if (registers[0] < 7) return false;
+
+        // The OS must save the AVX registers (OSXSAVE, then XMM and YMM states enabled in XCR0)
+        __cpuid(registers, 1);
+        if ((registers[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) return false;
+
+        __cpuidex(registers, 7, 0);
+        return (registers[1] & (1 << 5)) != 0;
+#elif defined(LAB6FLOWFIELD_VECTORFIELD_AVX2)
+        // Also checks that the OS saves the AVX registers
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+    }
+
+#ifdef LAB6FLOWFIELD_VECTORFIELD_SSE2
+    constexpr int Sse2LaneCount = 4;
+
+    /**
+     * \brief Direction codes of 4 consecutive cells
+     */
+    void computeSse2(const int* costs, const int* integrations, const int* offsets, const int padded,
+                     std::uint8_t* codes)
+    {
+        const __m128i impassables = _mm_set1_epi32(Impassable);
+        const __m128i unvisiteds = _mm_set1_epi32(Unvisited);
+        const __m128i noDirections = _mm_set1_epi32(NoDirectionCode);
+
+        __m128i lowestDirections = noDirections;
+        __m128i lowestIntegrations = impassables;
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int neighbour = padded + offsets[direction];
+            const __m128i neighbourCosts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(costs + neighbour));
+            const __m128i neighbourIntegrations =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(integrations + neighbour));
+
+            // Same test as the scalar kernel: not Impassable nor Unvisited, and lower or the first valid neighbour
+            const __m128i isLower = _mm_or_si128(_mm_cmplt_epi32(neighbourIntegrations, lowestIntegrations),
+                                                 _mm_cmpeq_epi32(lowestDirections, noDirections));
+            const __m128i isSkipped = _mm_or_si128(_mm_cmpeq_epi32(neighbourCosts, impassables),
+                                                   _mm_cmpeq_epi32(neighbourCosts, unvisiteds));
+            const __m128i isUpdated = _mm_andnot_si128(isSkipped, isLower);
+
+            lowestIntegrations = _mm_or_si128(_mm_and_si128(isUpdated, neighbourIntegrations),
+                                              _mm_andnot_si128(isUpdated, lowestIntegrations));
+            lowestDirections = _mm_or_si128(_mm_and_si128(isUpdated, _mm_set1_epi32(direction)),
+                                            _mm_andnot_si128(isUpdated, lowestDirections));
+        }
+
+        // The goal has no direction, obstacles and unreachable cells cannot flow anywhere
+        const __m128i cellCosts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(costs + padded));
+        const __m128i hasNoDirection = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(cellCosts, _mm_setzero_si128()),
+                         _mm_cmpeq_epi32(cellCosts, unvisiteds)),
+            _mm_cmpeq_epi32(cellCosts, impassables));
+        lowestDirections = _mm_or_si128(_mm_and_si128(hasNoDirection, noDirections),
+                                        _mm_andnot_si128(hasNoDirection, lowestDirections));
+
+        // The codes fit in a byte, 0 to 8
+        const __m128i words = _mm_packs_epi32(lowestDirections, lowestDirections);
+        const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(codes, &bytes, Sse2LaneCount);
+    }
+#endif
+
+#ifdef LAB6FLOWFIELD_VECTORFIELD_AVX2
+    constexpr int Avx2LaneCount = 8;
+
+    /**
+     * \brief Direction codes of 8 consecutive cells
+     */
+    LAB6FLOWFIELD_TARGET_AVX2
+    void computeAvx2(const int* costs, const int* integrations, const int* offsets, const int padded,
+                     std::uint8_t* codes)
+    {
+        const __m256i impassables = _mm256_set1_epi32(Impassable);
+        const __m256i unvisiteds = _mm256_set1_epi32(Unvisited);
+        const __m256i noDirections = _mm256_set1_epi32(NoDirectionCode);
+
+        __m256i lowestDirections = noDirections;
+        __m256i lowestIntegrations = impassables;
+        for (int direction = 0; direction < NeighbourCount; direction++)
+        {
+            const int neighbour = padded + offsets[direction];
+            const __m256i neighbourCosts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(costs + neighbour));
+            const __m256i neighbourIntegrations =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(integrations + neighbour));
+
+            const __m256i isLower = _mm256_or_si256(_mm256_cmpgt_epi32(lowestIntegrations, neighbourIntegrations),
+                                                    _mm256_cmpeq_epi32(lowestDirections, noDirections));
+            const __m256i isSkipped = _mm256_or_si256(_mm256_cmpeq_epi32(neighbourCosts, impassables),
+                                                      _mm256_cmpeq_epi32(neighbourCosts, unvisiteds));
+            const __m256i isUpdated = _mm256_andnot_si256(isSkipped, isLower);
+
+            lowestIntegrations = _mm256_blendv_epi8(lowestIntegrations, neighbourIntegrations, isUpdated);
+            lowestDirections = _mm256_blendv_epi8(lowestDirections, _mm256_set1_epi32(direction), isUpdated);
+        }
+
+        const __m256i cellCosts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(costs + padded));
+        const __m256i hasNoDirection = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi32(cellCosts, _mm256_setzero_si256()),
+                            _mm256_cmpeq_epi32(cellCosts, unvisiteds)),
+            _mm256_cmpeq_epi32(cellCosts, impassables));
+        lowestDirections = _mm256_blendv_epi8(lowestDirections, noDirections, hasNoDirection);
+
+        const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(lowestDirections),
+                                              _mm256_extracti128_si256(lowestDirections, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(codes), _mm_packus_epi16(words, words));
+    }
+#endif
+}
+
+VectorFieldKernel::InstructionSet VectorFieldKernel::getBestInstructionSet()
+{
+    static const InstructionSet best = []
+    {
+        if (isSupported(InstructionSet::Avx2)) return InstructionSet::Avx2;
+        if (isSupported(InstructionSet::Sse2)) return InstructionSet::Sse2;
+        return InstructionSet::Scalar;
+    }();
+
+    return best;
+}
+
+bool VectorFieldKernel::isSupported(const InstructionSet set)
+{
+    switch (set)
+    {
+    case InstructionSet::Scalar:
+        return true;
+    case InstructionSet::Sse2:
+#ifdef LAB6FLOWFIELD_VECTORFIELD_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case InstructionSet::Avx2:
+    {
+        static const bool isAvx2 = isAvx2Supported();
+        return isAvx2;
+    }
+    }
+
+    return false;
+}
+
+const char* VectorFieldKernel::getName(const InstructionSet set)
+{
+    switch (set)
+    {
+    case InstructionSet::Scalar:
+        return "scalar";
+    case InstructionSet::Sse2:
+        return "sse2";
+    case InstructionSet::Avx2:
+        return "avx2";
+    }
+
+    return "";
+}
+
+std::uint8_t VectorFieldKernel::computeCell(const int* costs, const int* integrations, const int* offsets,
+                                            const int padded)
+{
+    // The goal has no direction, obstacles and unreachable cells cannot flow anywhere
+    const int cost = costs[padded];
+    if (cost == 0 || cost == Unvisited || cost == Impassable) return NoDirectionCode;
+
+    int lowestDirection = NoDirectionCode;
+    int lowestIntegration = INT_MAX;
+    for (int direction = 0; direction < NeighbourCount; direction++)
+    {
+        // The border is Impassable like the obstacles. An Unvisited neighbour was not reached from the goal, its
+        // integration is no distance: the Eikonal integrator only reaches a cell from its 4 side neighbours.
+        const int neighbour = padded + offsets[direction];
+        if (costs[neighbour] == Impassable || costs[neighbour] == Unvisited) continue;
+
+        if (lowestDirection == NoDirectionCode || integrations[neighbour] < lowestIntegration)
+        {
+            lowestDirection = direction;
+            lowestIntegration = integrations[neighbour];
+        }
+    }
+
+    return static_cast<std::uint8_t>(lowestDirection);
+}
+
+void VectorFieldKernel::computeRow(const InstructionSet set, const int* costs, const int* integrations,
+                                   const int* offsets, const int padded, const int count, std::uint8_t* codes)
+{
+    // The neighbours of the cells of a row are on the rows above and below, in the padded fields: the loads of a
+    // group of cells never leave the fields. The cells after the last full group go through the scalar kernel.
+    int i = 0;
+#ifdef LAB6FLOWFIELD_VECTORFIELD_AVX2
+    if (set == InstructionSet::Avx2)
+    {
+        for (; i + Avx2LaneCount <= count; i += Avx2LaneCount)
+        {
+            computeAvx2(costs, integrations, offsets, padded + i, codes + i);
+        }
+    }
+#endif
+#ifdef LAB6FLOWFIELD_VECTORFIELD_SSE2
+    if (set != InstructionSet::Scalar)
+    {
+        for (; i + Sse2LaneCount <= count; i += Sse2LaneCount)
+        {
+            computeSse2(costs, integrations, offsets, padded + i, codes + i);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        codes[i] = computeCell(costs, integrations, offsets, padded + i);
+    }
+}
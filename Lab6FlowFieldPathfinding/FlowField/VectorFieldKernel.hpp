@@ -0,0 +1,63 @@
+#ifndef LAB6FLOWFIELD_VECTORFIELDKERNEL_HPP
+#define LAB6FLOWFIELD_VECTORFIELDKERNEL_HPP
+
+#include <cstdint>
+
+/**
+ * \brief Direction codes of the vector field from the padded cost and integration fields of FlowField
+ * \details Each cell points to its neighbour with the lowest integration value, skipping the Impassable and Unvisited
+ * neighbours, the first direction in the order of the neighbours winning the ties. The cells with no direction (goal,
+ * obstacles, unreachable) get FlowField::NoDirectionCode.
+ *
+ * The SIMD kernels do the 8-way minimum of several cells of a row at once: each direction is one unaligned load of
+ * the neighbours of consecutive cells, compared with the lowest value so far, and the direction of the lanes where it
+ * is lower replaces theirs. This is the same sequence of strict comparisons as the scalar kernel, so the codes are
+ * identical whatever the instruction set. The AVX2 kernel is compiled even when the rest of the program is not, and
+ * only used if the CPU supports it.
+ */
+class VectorFieldKernel
+{
+public:
+    enum class InstructionSet
+    {
+        // One cell at a time, the reference the other kernels are checked against
+        Scalar,
+        // 4 cells at a time
+        Sse2,
+        // 8 cells at a time
+        Avx2
+    };
+
+    VectorFieldKernel() = delete;
+
+    /**
+     * \brief Fastest instruction set supported by the CPU, detected once
+     */
+    static InstructionSet getBestInstructionSet();
+
+    static bool isSupported(InstructionSet set);
+
+    static const char* getName(InstructionSet set);
+
+    /**
+     * \brief Direction code of one cell
+     * \param costs padded cost field, Impassable on the border
+     * \param integrations padded integration field
+     * \param offsets offset of each of the 8 neighbours in the padded fields
+     * \param padded padded index of the cell
+     */
+    static std::uint8_t computeCell(const int* costs, const int* integrations, const int* offsets, int padded);
+
+    /**
+     * \brief Direction codes of consecutive cells of a row
+     * \param set instruction set to use, must be supported (see isSupported())
+     * \param padded padded index of the first cell
+     * \param count number of cells, all on the same row
+     * \param codes output direction code of each cell
+     */
+    static void computeRow(InstructionSet set, const int* costs, const int* integrations, const int* offsets,
+                           int padded, int count, std::uint8_t* codes);
+};
+
+
+#endif //LAB6FLOWFIELD_VECTORFIELDKERNEL_HPP
@@ -1,25 +1,54 @@
 #include "Game.hpp"
 
+#include <algorithm>
 #include <iostream>
 
+#include "FlowField/MapFile.hpp"
+#include "Profiling/Profiler.hpp"
+
 Game::Game() :
     m_window{sf::VideoMode{ScreenSize, ScreenSize, 32U}, "SFML Game"},
-    m_exitGame{false} //when true game will exit
+    m_exitGame{false}, //when true game will exit
+    m_isProfilerShown{false},
+    m_crowd{60.f, 150.f},
+    m_crowdVertices{sf::Quads}
 {
     loadFonts();
+    Profiler::setThreadName("main");
 
-    constexpr int gridSize = 50;
+    MapFile mapFile;
+    if (mapFile.open(MapFilePath))
+    {
+        // Whole pixels per node like the default grid, the maps bigger than the screen do not fit in the window
+        const unsigned gridSize = static_cast<unsigned>(std::max(mapFile.getWidth(), mapFile.getHeight()));
+        m_grid = new Grid(m_fontManager, mapFile.getWidth(), mapFile.getHeight(), std::max(1U, ScreenSize / gridSize),
+                          {});
+        m_grid->loadMap(mapFile);
+    }
+    else
+    {
+        constexpr int gridSize = 50;
 
-    m_grid = new Grid(m_fontManager, gridSize, gridSize, ScreenSize / gridSize, {{5, 10}, {10, 5}});
+        m_grid = new Grid(m_fontManager, gridSize, gridSize, ScreenSize / gridSize, {{5, 10}, {10, 5}});
+    }
     /*m_grid->calculateFlowField(sf::Vector2i(10, 10));*/
 
     m_agent = new Agent(*m_grid, m_grid->findNode({2, 2})->getPosition(), 60.f, 150.f);
+
+    m_crowd.setBounds(0, 0, ScreenSize, ScreenSize);
+
+    // Agents of the crowd keep half a cell between each other, and the agent stays away from them
+    m_crowd.setSeparation(m_grid->getNodeSize() / 2, 1.f);
+    m_agent->setNeighbours(&m_crowd.getNeighbours(), m_crowd.getSeparationRadius());
+
+    m_profilerOverlay = new ProfilerOverlay(m_fontManager.get(Assets::Font::ArialBlack));
 }
 
 Game::~Game()
 {
     delete m_grid;
     delete m_agent;
+    delete m_profilerOverlay;
 };
 
 
@@ -38,6 +67,8 @@ void Game::run()
     const sf::Time timePerFrame = sf::seconds(1.0f / fps); // 60 fps
     while (m_window.isOpen())
     {
+        Profiler::beginFrame();
+
         processEvents(); // as many as possible
         timeSinceLastUpdate += clock.restart();
         while (timeSinceLastUpdate > timePerFrame)
@@ -57,6 +88,8 @@ void Game::run()
 /// </summary>
 void Game::processEvents()
 {
+    LAB6FLOWFIELD_PROFILE_SCOPE("Game::processEvents");
+
     sf::Event newEvent{};
     while (m_window.pollEvent(newEvent))
     {
@@ -88,6 +121,66 @@ void Game::processKeys(sf::Event event)
         m_grid->toggleDebugData();
     }
 
+    // Cycle between the breadth-first, the weighted and the eikonal integrator
+    if (sf::Keyboard::W == event.key.code)
+    {
+        switch (m_grid->getIntegrator())
+        {
+        case FlowField::Integrator::BreadthFirst:
+            m_grid->setIntegrator(FlowField::Integrator::Weighted);
+            break;
+        case FlowField::Integrator::Weighted:
+            m_grid->setIntegrator(FlowField::Integrator::Eikonal);
+            break;
+        case FlowField::Integrator::Eikonal:
+            m_grid->setIntegrator(FlowField::Integrator::BreadthFirst);
+            break;
+        }
+        m_grid->calculateFlowField();
+        m_grid->calculatePathFromStart();
+    }
+
+    // Let the agents which see the goal walk straight to it, or follow the vector field everywhere
+    if (sf::Keyboard::L == event.key.code)
+    {
+        m_grid->setLineOfSightEnabled(!m_grid->isLineOfSightEnabled());
+        m_grid->calculateFlowField();
+    }
+
+    if (sf::Keyboard::C == event.key.code)
+    {
+        spawnCrowd(CrowdSpawnCount);
+    }
+
+    // Show/hide the time of each phase of the frame
+    if (sf::Keyboard::P == event.key.code)
+    {
+        m_isProfilerShown = !m_isProfilerShown;
+        Profiler::setEnabled(m_isProfilerShown || Profiler::isCapturing());
+    }
+
+    // Start/stop a capture of every phase, written as a Chrome trace
+    if (sf::Keyboard::T == event.key.code)
+    {
+        if (!Profiler::isCapturing())
+        {
+            Profiler::startCapture();
+            std::cout << "Capturing a trace, press T again to stop" << std::endl;
+        }
+        else
+        {
+            if (Profiler::stopCapture(TraceFilePath))
+            {
+                std::cout << "Trace written to " << TraceFilePath << std::endl;
+            }
+            else
+            {
+                std::cout << "Could not write the trace to " << TraceFilePath << std::endl;
+            }
+            Profiler::setEnabled(m_isProfilerShown);
+        }
+    }
+
     if (sf::Keyboard::Escape == event.key.code)
     {
         m_exitGame = true;
@@ -128,13 +221,7 @@ void Game::processMouse(const sf::Event& event) const
         // Convert window pixel coordinates to the grid coordinates
         const sf::Vector2i mouseGridPosition = mousePosition / static_cast<int>(m_grid->getNodeSize());
 
-        auto obstacles = m_grid->getObstacles();
-        const auto find = std::find_if(obstacles.begin(), obstacles.end(), [=](sf::Vector2i obstaclePos)
-        {
-            return obstaclePos.x == mouseGridPosition.x && obstaclePos.y == mouseGridPosition.y;
-        });
-
-        if (find == obstacles.end())
+        if (!m_grid->isObstacle(mouseGridPosition))
         {
             m_grid->addObstacle(mouseGridPosition.x, mouseGridPosition.y);
         }
@@ -143,7 +230,7 @@ void Game::processMouse(const sf::Event& event) const
             m_grid->removeObstacle(mouseGridPosition.x, mouseGridPosition.y);
         }
 
-        m_grid->calculateFlowField();
+        // The flow field is repaired around the obstacle, only the path has to be walked again
         m_grid->calculatePathFromStart();
     }
 }
@@ -154,6 +241,8 @@ void Game::processMouse(const sf::Event& event) const
 /// <param name="deltaTime">time interval per frame</param>
 void Game::update(const sf::Time deltaTime)
 {
+    LAB6FLOWFIELD_PROFILE_SCOPE("Game::update");
+
     // Ugly code that does collision check against window border (prevent some bugs where the Agent just go through the border of the window and never come back)
     if (m_agent->getPosition().x - m_agent->getRadius() - m_agent->getOutlineThickness() < 0 || m_agent->getPosition().x
         + m_agent->getRadius() + m_agent->getOutlineThickness() > ScreenSize || m_agent->getPosition().y - m_agent->
@@ -183,8 +272,14 @@ void Game::update(const sf::Time deltaTime)
         m_agent->setPosition(newAgentPosition);
     }
 
+    // The flow field calculated in the background replaces the current one before the agents steer on it
+    m_grid->update();
+
     m_agent->update(deltaTime);
 
+    m_crowd.update(m_grid->getFlowField(), deltaTime.asSeconds(), &m_threadPool);
+    updateCrowdVertices();
+
     if (m_exitGame)
     {
         m_window.close();
@@ -196,10 +291,22 @@ void Game::update(const sf::Time deltaTime)
 /// </summary>
 void Game::render()
 {
+    LAB6FLOWFIELD_PROFILE_SCOPE("Game::render");
+
     m_window.clear(sf::Color::Black);
 
+    const sf::View& view = m_window.getView();
+    m_grid->updateDebugOverlay({view.getCenter() - view.getSize() / 2.f, view.getSize()});
+
     m_window.draw(*m_grid);
     m_window.draw(*m_agent);
+    m_window.draw(m_crowdVertices);
+
+    if (m_isProfilerShown)
+    {
+        m_profilerOverlay->update();
+        m_window.draw(*m_profilerOverlay);
+    }
 
     m_window.display();
 }
@@ -208,3 +315,46 @@ void Game::loadFonts()
 {
     m_fontManager.load(Assets::Font::ArialBlack, "ASSETS/FONTS/ariblk.ttf");
 }
+
+void Game::spawnCrowd(const int count)
+{
+    const FlowField& field = m_grid->getFlowField();
+
+    std::vector<int> passableCells;
+    for (int i = 0; i < field.getCellCount(); i++)
+    {
+        if (!field.isObstacle(i)) passableCells.push_back(i);
+    }
+    if (passableCells.empty()) return;
+
+    // Anywhere in the cell, so the agents do not all start stacked on its centre
+    std::uniform_real_distribution<float> offset(0, m_grid->getNodeSize());
+    for (int i = 0; i < count; i++)
+    {
+        const int cell = passableCells[m_random() % passableCells.size()];
+        m_crowd.add(static_cast<float>(cell % field.getWidth()) * m_grid->getNodeSize() + offset(m_random),
+                    static_cast<float>(cell / field.getWidth()) * m_grid->getNodeSize() + offset(m_random));
+    }
+
+    m_crowdVertices.resize(static_cast<std::size_t>(m_crowd.size()) * 4);
+    for (std::size_t i = 0; i < m_crowdVertices.getVertexCount(); i++)
+    {
+        m_crowdVertices[i].color = sf::Color::Magenta;
+    }
+}
+
+void Game::updateCrowdVertices()
+{
+    constexpr float halfSize = 1.5f;
+
+    for (int i = 0; i < m_crowd.size(); i++)
+    {
+        const float x = m_crowd.getPositionX(i);
+        const float y = m_crowd.getPositionY(i);
+        sf::Vertex* quad = &m_crowdVertices[static_cast<std::size_t>(i) * 4];
+        quad[0].position = {x - halfSize, y - halfSize};
+        quad[1].position = {x + halfSize, y - halfSize};
+        quad[2].position = {x + halfSize, y + halfSize};
+        quad[3].position = {x - halfSize, y + halfSize};
+    }
+}
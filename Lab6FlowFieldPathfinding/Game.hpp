@@ -2,6 +2,7 @@
 #define GAME_HPP
 
 #include <memory>
+#include <random>
 
 #include <SFML/Graphics.hpp>
 
@@ -9,6 +10,9 @@
 #include "ResourceManager/ResourceIdentifiers.hpp"
 #include "Grid.hpp"
 #include "Agent.hpp"
+#include "ProfilerOverlay.hpp"
+#include "Crowd/AgentStore.hpp"
+#include "Crowd/ThreadPool.hpp"
 
 class Game
 {
@@ -33,8 +37,26 @@ private:
 
     void loadFonts();
 
+    /**
+     * \brief Add agents to the crowd on random passable cells
+     */
+    void spawnCrowd(int count);
+
+    /**
+     * \brief Move the quad of each agent of the crowd to its position
+     */
+    void updateCrowdVertices();
+
     unsigned int static constexpr ScreenSize = 800U;
 
+    int static constexpr CrowdSpawnCount = 1000;
+
+    // Map loaded instead of the default grid when the file exists (see MapFile)
+    static constexpr const char* MapFilePath = "ASSETS/MAPS/level.flowmap";
+
+    // Chrome trace written when a capture of the profiler stops
+    static constexpr const char* TraceFilePath = "trace.json";
+
     sf::RenderWindow m_window;
 
     FontManager m_fontManager;
@@ -43,6 +65,16 @@ private:
 
     Grid* m_grid;
     Agent* m_agent;
+
+    // Timings of the phases of the frame, the profiler only runs while they are shown or captured
+    ProfilerOverlay* m_profilerOverlay;
+    bool m_isProfilerShown;
+
+    // Agents updated together on the thread pool, drawn as one quad each
+    AgentStore m_crowd;
+    ThreadPool m_threadPool;
+    sf::VertexArray m_crowdVertices;
+    std::mt19937 m_random;
 };
 
 #endif // !GAME_HPP
@@ -1,23 +1,52 @@
 #include "Grid.hpp"
-#include "utils/VectorUtils.hpp"
 
 #include <iostream>
-#include <queue>
 
-Grid::Grid(const FontManager& fontManager, int width, int height, float nodeSize, std::list<sf::Vector2i> obstacles) :
+#include "FlowField/MapFile.hpp"
+#include "Profiling/Profiler.hpp"
+
+namespace
+{
+    sf::Vertex toVertex(const GridMesh::Vertex& vertex)
+    {
+        return {{vertex.x, vertex.y}, {vertex.color.r, vertex.color.g, vertex.color.b, vertex.color.a}};
+    }
+
+    void copyVertices(const std::vector<GridMesh::Vertex>& from, sf::VertexArray& to, const size_t first,
+                      const size_t count)
+    {
+        for (size_t i = first; i < first + count; i++)
+        {
+            to[i] = toVertex(from[i]);
+        }
+    }
+}
+
+Grid::Grid(const FontManager& fontManager, int width, int height, float nodeSize,
+           const std::vector<sf::Vector2i>& obstacles) :
+    m_flowField(width, height, nodeSize),
+    m_asyncField(width, height, nodeSize),
+    m_pathExtractor(m_flowField),
+    m_mesh(width, height, nodeSize),
+    m_quadVertices(sf::Quads, m_mesh.getQuadVertices().size()),
+    m_lineVertices(sf::Lines, m_mesh.getLineVertices().size()),
+    m_arrowVertices(sf::Lines, m_mesh.getArrowVertices().size()),
+    m_debugOverlay(fontManager.get(Assets::Font::ArialBlack), m_flowField),
+    m_isDebugEnabled(false),
     m_width(width),
     m_height(height),
     m_nodeSize(nodeSize),
-    m_obstacles(obstacles)
+    m_integrator(FlowField::Integrator::BreadthFirst),
+    m_obstacles(width, height)
 {
     m_nodes.reserve(width * height);
 
-    for (int i = 0; i < m_width; i++)
+    // Row by row, so a node has the same index as its cell in the flow field
+    for (int j = 0; j < m_height; j++)
     {
-        for (int j = 0; j < m_height; j++)
+        for (int i = 0; i < m_width; i++)
         {
             m_nodes.emplace_back(std::make_shared<Node>(
-                fontManager,
                 *this,
                 sf::Vector2i(i, j),
                 m_nodeSize
@@ -25,7 +54,20 @@ Grid::Grid(const FontManager& fontManager, int width, int height, float nodeSize
         }
     }
 
-    auto node = findNode({2, 14});
+    for (const auto& obstacle : obstacles)
+    {
+        m_obstacles.setObstacle(obstacle.x, obstacle.y, true);
+    }
+    m_flowField.setObstacles(m_obstacles);
+
+    // Only the nodes changed by a calculation or a repair are refreshed
+    m_flowField.setDirtyTracking(true);
+
+    setLineOfSightEnabled(true);
+
+    copyVertices(m_mesh.getQuadVertices(), m_quadVertices, 0, m_quadVertices.getVertexCount());
+    copyVertices(m_mesh.getLineVertices(), m_lineVertices, 0, m_lineVertices.getVertexCount());
+    copyVertices(m_mesh.getArrowVertices(), m_arrowVertices, 0, m_arrowVertices.getVertexCount());
 }
 
 const std::vector<std::shared_ptr<Node>>& Grid::getNodes() const
@@ -33,6 +75,11 @@ const std::vector<std::shared_ptr<Node>>& Grid::getNodes() const
     return m_nodes;
 }
 
+const FlowField& Grid::getFlowField() const
+{
+    return m_flowField;
+}
+
 int Grid::getWidth() const
 {
     return m_width;
@@ -50,20 +97,10 @@ float Grid::getNodeSize() const
 
 std::shared_ptr<Node> Grid::findNode(const sf::Vector2i& coordinates)
 {
-    if (coordinates.x >= m_width || coordinates.y >= m_height)
-    {
-        return nullptr;
-    }
+    // The node does not exist in the grid so we return null
+    if (!m_flowField.isInside(coordinates.x, coordinates.y)) return nullptr;
 
-    try
-    {
-        return m_nodes.at(coordinates.y + m_width * coordinates.x);
-    }
-    catch (std::out_of_range const&)
-    {
-        // The node does not exist in the grid so we return null
-        return nullptr;
-    }
+    return m_nodes[m_flowField.toIndex(coordinates.x, coordinates.y)];
 }
 
 std::shared_ptr<Node> Grid::findNodeByPosition(const sf::Vector2f& worldPosition)
@@ -102,125 +139,68 @@ sf::Vector2i Grid::getGoalCoordinates() const
     return m_goalCoordinates;
 }
 
-std::list<sf::Vector2i> Grid::getObstacles()
+const ObstacleMap& Grid::getObstacles() const
 {
     return m_obstacles;
 }
 
-void Grid::draw(sf::RenderTarget& target, sf::RenderStates states) const
+bool Grid::isObstacle(const sf::Vector2i& coordinates) const
 {
-    for (auto& node : m_nodes)
-    {
-        target.draw(*node);
-    }
+    return m_obstacles.isObstacle(coordinates.x, coordinates.y);
 }
 
-void Grid::computeVectorField() const
+void Grid::loadMap(const MapFile& file)
 {
-    for (const auto& node : m_nodes)
-    {
-        if (node->getCostDistance() == INT_MAX) continue;
-        const auto neighbours = node->getNeighbours();
+    m_obstacles.loadRows(file.getObstacleRows());
+    file.loadMap(m_flowField);
 
-        std::shared_ptr<Node> lowestDistance = nullptr;
-        for (size_t i = 0; i < neighbours.size(); i++)
-        {
-            if (neighbours[i]->getCostDistance() == INT_MAX) continue;
-            if (lowestDistance == nullptr)
-            {
-                lowestDistance = neighbours[i];
-                continue;
-            }
-
-            if (neighbours[i]->getIntegrationField() < lowestDistance->getIntegrationField())
-            {
-                lowestDistance = neighbours[i];
-            }
-        }
-
-        const auto directionToClosestNeighbour = VectorUtils::normalize(
-            lowestDistance->getPosition() - node->getPosition());
-        if (node->getCostDistance() != 0) node->setFlowFieldDirection(directionToClosestNeighbour);
-    }
+    if (m_flowField.isCalculated() || m_asyncField.isBusy()) calculateFlowField();
 }
 
-void Grid::calculateFlowField()
+void Grid::draw(sf::RenderTarget& target, sf::RenderStates states) const
 {
-    // Refresh the grid with default values
-    for (const auto& node : m_nodes)
-    {
-        node->setCostDistance(-1);
-        node->setIntegrationField(-1);
-        node->setFlowFieldDirection({0, 0});
-    }
+    LAB6FLOWFIELD_PROFILE_SCOPE("Grid::draw");
 
-    // Add obstacles to the grid
-    for (auto obstacle : m_obstacles)
-    {
-        auto node = findNode(obstacle);
-        node->setCostDistance(INT_MAX);
-        node->setIntegrationField(INT_MAX);
-    }
+    target.draw(m_quadVertices, states);
+    target.draw(m_lineVertices, states);
+
+    if (!m_isDebugEnabled) return;
 
-    createCostField();
-    createIntegrationField();
-    computeVectorField();
+    target.draw(m_arrowVertices, states);
+    target.draw(m_debugOverlay, states);
 }
 
-void Grid::createCostField()
+void Grid::calculateFlowField()
 {
-    auto goal = findNode(m_goalCoordinates);
-    goal->setCostDistance(0);
-
-    std::queue<std::shared_ptr<Node>> unmarkedNodes;
-    unmarkedNodes.push(goal);
+    LAB6FLOWFIELD_PROFILE_SCOPE("Grid::calculateFlowField");
 
-    while (!unmarkedNodes.empty())
-    {
-        const auto current = unmarkedNodes.front();
-        unmarkedNodes.pop();
+    if (!m_flowField.isInside(m_goalCoordinates.x, m_goalCoordinates.y)) return;
 
-        auto neighbours = current->getNeighbours(true);
-        for (auto& neighbour : neighbours)
-        {
-            if (neighbour->getCostDistance() == -1)
-            {
-                neighbour->setCostDistance(current->getCostDistance() + 1);
-                unmarkedNodes.push(neighbour);
-            }
-        }
-    }
+    // The current field stays displayed until the new one is complete
+    m_asyncField.request(m_flowField, m_flowField.toIndex(m_goalCoordinates.x, m_goalCoordinates.y), m_integrator);
 }
 
-void Grid::createIntegrationField()
+void Grid::update()
 {
-    const std::shared_ptr<Node> goal = findNode(m_goalCoordinates);
-    goal->setIntegrationField(0);
+    LAB6FLOWFIELD_PROFILE_SCOPE("Grid::update");
 
-    std::queue<std::shared_ptr<Node>> unmarkedNodes;
-    unmarkedNodes.push(goal);
+    // A field published while a newer request is waiting is already outdated (older goal or obstacles)
+    if (!m_asyncField.publish() || m_asyncField.isBusy()) return;
 
-    while (!unmarkedNodes.empty())
-    {
-        const auto current = unmarkedNodes.front();
-        unmarkedNodes.pop();
+    m_flowField.swapFields(m_asyncField.getField());
 
-        auto neighbours = current->getNeighbours();
-        for (auto& neighbour : neighbours)
-        {
-            if (neighbour->getIntegrationField() == -1 && neighbour->getIntegrationField() != INT_MAX)
-            {
-                const int distance =
-                    VectorUtils::getLength(neighbour->getPosition() - goal->getPosition());
-                neighbour->setIntegrationField(neighbour->getCostDistance() * 100 + distance);
-                unmarkedNodes.push(neighbour);
-            }
-        }
-    }
+    updateDirtyNodes();
+    calculatePathFromStart();
 }
 
 void Grid::setStartPosition(sf::Vector2i coordinates)
 {
+    // Only the changed nodes are refreshed by a calculation, the previous path has to be restored here
+    for (const auto& pathCoordinates : m_pathFromStart)
+    {
+        updateNode(findNode(pathCoordinates)->getIndex());
+    }
+
     m_pathFromStart.clear();
     m_pathFromStart.push_back(coordinates);
     calculatePathFromStart();
@@ -228,40 +208,138 @@ void Grid::setStartPosition(sf::Vector2i coordinates)
 
 void Grid::toggleDebugData()
 {
-    for (const auto node : m_nodes)
+    m_isDebugEnabled = !m_isDebugEnabled;
+}
+
+void Grid::updateDebugOverlay(const sf::FloatRect& visibleArea)
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("Grid::updateDebugOverlay");
+
+    if (m_isDebugEnabled) m_debugOverlay.update(visibleArea);
+}
+
+void Grid::setIntegrator(const FlowField::Integrator integrator)
+{
+    m_integrator = integrator;
+}
+
+FlowField::Integrator Grid::getIntegrator() const
+{
+    return m_integrator;
+}
+
+void Grid::setLineOfSightEnabled(const bool isEnabled)
+{
+    m_flowField.setLineOfSightEnabled(isEnabled);
+    m_asyncField.setLineOfSightEnabled(isEnabled);
+}
+
+bool Grid::isLineOfSightEnabled() const
+{
+    return m_flowField.isLineOfSightEnabled();
+}
+
+void Grid::calculatePathFromStart()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("Grid::calculatePathFromStart");
+
+    if (m_pathFromStart.empty()) return;
+
+    // Restore the color of the previous path
+    for (size_t i = 1; i < m_pathFromStart.size(); i++)
     {
-        node->setVisualDebugEnabled(!node->isVisualDebugEnabled());
+        updateNode(m_flowField.toIndex(m_pathFromStart[i].x, m_pathFromStart[i].y));
     }
+
+    const int start = m_flowField.toIndex(m_pathFromStart[0].x, m_pathFromStart[0].y);
+    m_pathFromStart.resize(1);
+
+    m_pathExtractor.extract({start});
+    m_pathExtractor.smoothPaths();
+
+    std::vector<int> cells;
+    m_pathExtractor.getPath(0, cells);
+    for (size_t i = 1; i < cells.size(); i++)
+    {
+        m_pathFromStart.emplace_back(cells[i] % m_width, cells[i] / m_width);
+        if (m_flowField.getCostDistance(cells[i]) != 0) setNodeColor(cells[i], {255, 255, 0, 255});
+    }
+
+    // The goal keeps its color
+    const int* waypoints = m_pathExtractor.getWaypoints(0);
+    for (int i = 1; i < m_pathExtractor.getWaypointCount(0); i++)
+    {
+        if (m_flowField.getCostDistance(waypoints[i]) != 0) setNodeColor(waypoints[i], {255, 128, 0, 255});
+    }
+
+    setNodeColor(start, {0, 255, 0, 255});
 }
 
-void Grid::calculatePathFromStart()
+int Grid::addObstacle(int x, int y)
+{
+    m_obstacles.setObstacle(x, y, true);
+
+    return updateObstacle(x, y, true);
+}
+
+int Grid::removeObstacle(int x, int y)
+{
+    m_obstacles.setObstacle(x, y, false);
+
+    return updateObstacle(x, y, false);
+}
+
+int Grid::updateObstacle(const int x, const int y, const bool isObstacle)
 {
-    const auto startCoordinates = m_pathFromStart[0];
+    LAB6FLOWFIELD_PROFILE_SCOPE("Grid::updateObstacle");
+
+    if (!m_flowField.isInside(x, y)) return 0;
 
-    auto currentNode = findNode(startCoordinates);
-    currentNode->setQuadColor(sf::Color::Green);
-    while (currentNode->getCostDistance() != 0)
+    // The repair of the goal or of the Eikonal integrator calculates the whole grid, and a field calculated in the
+    // background would not have the obstacle: both are left to a new calculation
+    const bool isFullCalculation = m_flowField.toIndex(x, y) == m_flowField.getGoalIndex() ||
+        m_flowField.getIntegrator() == FlowField::Integrator::Eikonal;
+    if (m_asyncField.isBusy() || (isFullCalculation && m_flowField.isCalculated()))
     {
-        const auto nextNode = currentNode->findNextNode();
-        if (nextNode == nullptr) break;
+        m_flowField.setObstacle(x, y, isObstacle);
+        calculateFlowField();
+        return 0;
+    }
 
-        m_pathFromStart.push_back(nextNode->getCoordinates());
-        if (nextNode->getCostDistance() != 0)
-        {
-            nextNode->setQuadColor(sf::Color::Yellow);
-        }
+    const int updatedCellCount = m_flowField.updateObstacle(x, y, isObstacle);
+    updateDirtyNodes();
 
+    return updatedCellCount;
+}
 
-        currentNode = nextNode;
+void Grid::updateDirtyNodes()
+{
+    for (const int index : m_flowField.getDirtyCells())
+    {
+        updateNode(index);
     }
+
+    m_flowField.clearDirtyCells();
+}
+
+void Grid::updateNode(const int index)
+{
+    m_mesh.updateCell(m_flowField, index);
+    copyNodeVertices(index);
+
+    m_debugOverlay.invalidate();
 }
 
-void Grid::addObstacle(int x, int y)
+void Grid::setNodeColor(const int index, const GridMesh::Color color)
 {
-    m_obstacles.emplace_back(x, y);
+    m_mesh.setCellColor(index, color);
+    copyNodeVertices(index);
 }
 
-void Grid::removeObstacle(int x, int y)
+void Grid::copyNodeVertices(const int index)
 {
-    m_obstacles.remove(sf::Vector2i(x, y));
+    copyVertices(m_mesh.getQuadVertices(), m_quadVertices, static_cast<size_t>(index) * GridMesh::QuadVertexCount,
+                 GridMesh::QuadVertexCount);
+    copyVertices(m_mesh.getArrowVertices(), m_arrowVertices, static_cast<size_t>(index) * GridMesh::ArrowVertexCount,
+                 GridMesh::ArrowVertexCount);
 }
@@ -2,21 +2,35 @@
 #define LAB6FLOWFIELD_GRID_HPP
 
 #include <vector>
-#include <list>
 
 #include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
 
 #include "ResourceManager/ResourceManager.hpp"
 #include "ResourceManager/ResourceIdentifiers.hpp"
+#include "DebugOverlay.hpp"
+#include "FlowField/AsyncFlowField.hpp"
+#include "FlowField/FlowField.hpp"
+#include "FlowField/ObstacleMap.hpp"
+#include "FlowField/PathExtractor.hpp"
+#include "Rendering/GridMesh.hpp"
 #include "Node.hpp"
 
+class MapFile;
+
 class Grid : public sf::Drawable
 {
 public:
-    Grid(const FontManager& fontManager, int width, int height, float nodeSize, std::list<sf::Vector2i> obstacles);
+    Grid(const FontManager& fontManager, int width, int height, float nodeSize,
+         const std::vector<sf::Vector2i>& obstacles);
 
     const std::vector<std::shared_ptr<Node>>& getNodes() const;
 
+    /**
+     * \brief Headless flow field holding the cost, integration and direction of every node
+     */
+    const FlowField& getFlowField() const;
+
     int getWidth() const;
     int getHeight() const;
 
@@ -28,9 +42,18 @@ public:
      * 1. Calculate cost field
      * 2. Compute integration field
      * 3. Compute vector field (set direction to goal in each cell, etc)
+     * The computation itself is done by the FlowField on a background thread (see AsyncFlowField), the new field
+     * replaces the current one in update() once complete.
      */
     void calculateFlowField();
 
+    /**
+     * \brief Take the flow field calculated in the background if it is complete, to call every frame
+     * \details The nodes whose values changed are then refreshed and the path is walked again. Until then, the
+     * agents keep steering on the previous field.
+     */
+    void update();
+
     /**
      * \brief Find a node by its grid coordinates
      * \warning Not world pixel positions, it is actual grid coordinates
@@ -63,12 +86,35 @@ public:
     void setGoalCoordinates(sf::Vector2i goalCoordinates);
     sf::Vector2i getGoalCoordinates() const;
 
+    const ObstacleMap& getObstacles() const;
+    bool isObstacle(const sf::Vector2i& coordinates) const;
+
+    /**
+     * \brief Replace the obstacles and terrain costs with the ones of a map file of the same size
+     * \details The flow field is calculated again in the background if it was already calculated.
+     */
+    void loadMap(const MapFile& file);
+
+    /**
+     * \brief Add an obstacle and repair the flow field around it, if it has already been calculated
+     * \details When the repair would calculate the whole grid, or while a calculation is running, the flow field is
+     * calculated again in the background instead (see calculateFlowField()).
+     * \return number of cells updated by the repair, 0 if the flow field is calculated again
+     */
+    int addObstacle(int x, int y);
 
-    std::list<sf::Vector2i> getObstacles();
-    void addObstacle(int x, int y);
-    void removeObstacle(int x, int y);
+    /**
+     * \brief Remove an obstacle and repair the flow field around it, if it has already been calculated
+     * \details See addObstacle().
+     * \return number of cells updated by the repair, 0 if the flow field is calculated again
+     */
+    int removeObstacle(int x, int y);
 
     void setStartPosition(sf::Vector2i coordinates);
+
+    /**
+     * \brief Color the path from the start to the goal, and its waypoints once pulled tight
+     */
     void calculatePathFromStart();
 
     /**
@@ -76,21 +122,70 @@ public:
      */
     void toggleDebugData();
 
-private:
     /**
-     * \brief Calculate the cost field for each nodes
+     * \brief Build the debug overlay for the visible area if the debug data is displayed, to call before drawing
+     * \param visibleArea area of the world in the view
      */
-    void createCostField();
+    void updateDebugOverlay(const sf::FloatRect& visibleArea);
+
     /**
-     * \brief Compute the integration field by using the previously calculated cost field
+     * \brief Choose the algorithm used to compute the integration field, applied on the next calculateFlowField()
      */
-    void createIntegrationField();
+    void setIntegrator(FlowField::Integrator integrator);
+    FlowField::Integrator getIntegrator() const;
 
+    /**
+     * \brief Let the agents which see the goal walk straight to it (see FlowField::computeLineOfSight()), applied on
+     * the next calculateFlowField()
+     */
+    void setLineOfSightEnabled(bool isEnabled);
+    bool isLineOfSightEnabled() const;
+
+private:
     void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
-    void computeVectorField() const;
+
+    /**
+     * \brief Repair the flow field around a changed obstacle, or calculate it again in the background
+     */
+    int updateObstacle(int x, int y, bool isObstacle);
+
+    /**
+     * \brief Refresh the nodes whose values changed in the flow field since the last refresh
+     */
+    void updateDirtyNodes();
+
+    /**
+     * \brief Refresh the mesh and the debug overlay of a node from the flow field
+     */
+    void updateNode(int index);
+
+    /**
+     * \brief Color the quad of a node, until its next update
+     */
+    void setNodeColor(int index, GridMesh::Color color);
+
+    /**
+     * \brief Copy the quad and the arrow of a node from the mesh to the vertex arrays drawn
+     */
+    void copyNodeVertices(int index);
+
+    // Field displayed and followed by the agents, the new fields are calculated by m_asyncField then swapped in
+    FlowField m_flowField;
+    AsyncFlowField m_asyncField;
+    PathExtractor m_pathExtractor;
 
     std::vector<std::shared_ptr<Node>> m_nodes;
 
+    // Every layer of the grid is drawn in a single call
+    GridMesh m_mesh;
+    sf::VertexArray m_quadVertices;
+    sf::VertexArray m_lineVertices;
+    sf::VertexArray m_arrowVertices;
+
+    // Only built while the debug data is displayed
+    DebugOverlay m_debugOverlay;
+    bool m_isDebugEnabled;
+
     // Grid size
     int m_width;
     int m_height;
@@ -100,12 +195,16 @@ private:
 
     sf::Vector2i m_goalCoordinates;
 
+    // Integrator of the next calculation, m_flowField keeps the one of its fields until then
+    FlowField::Integrator m_integrator;
+
     /**
      * \brief Store list of coordinates from start to goal
      */
     std::vector<sf::Vector2i> m_pathFromStart;
 
-    std::list<sf::Vector2i> m_obstacles;
+    // Kept in sync with the obstacles of m_flowField, one bit per node
+    ObstacleMap m_obstacles;
 };
 
 
@@ -1,26 +1,22 @@
 #ifndef LAB6FLOWFIELD_NODE_HPP
 #define LAB6FLOWFIELD_NODE_HPP
 
-#include <SFML/Graphics.hpp>
+#include <memory>
 
-#include "Arrow.hpp"
-
-#include "ResourceManager/ResourceManager.hpp"
-#include "ResourceManager/ResourceIdentifiers.hpp"
+#include <SFML/System/Vector2.hpp>
 
 class Grid;
 
-class Node : public sf::Drawable, public sf::Transformable
+/**
+ * \brief Cell of the grid, a view on the values of the flow field at its coordinates
+ * \details Nodes hold no visual: the heatmap, grid lines and arrows are drawn by the grid (see GridMesh) and the debug
+ * texts by the debug overlay (see DebugOverlay). The neighbours of a cell are visited with
+ * FlowField::forEachNeighbour().
+ */
+class Node
 {
 public:
-    Node(const FontManager& fontManager, Grid& grid, sf::Vector2i coordinates, float size);
-
-    /**
-     * \brief Get the list of neighbours of this node
-     * \param includeDiagonals include neighbours in diagonal
-     * \return list of neighbours for this node
-     */
-    std::vector<std::shared_ptr<Node>> getNeighbours(bool includeDiagonals = true) const;
+    Node(Grid& grid, sf::Vector2i coordinates, float size);
 
     /**
      * \brief Look for all this neighbour's node and return the one that the flow field direction points to
@@ -28,73 +24,40 @@ public:
      */
     std::shared_ptr<Node> findNextNode() const;
 
-    /**
-     * \brief Set the color for this node
-     * \param color RGBA Color
-     */
-    void setQuadColor(sf::Color color);
-
     /**
      * \brief Get Local grid coordinates of this node
      * \return the local grid coordinates (not the world position)
      */
     sf::Vector2i getCoordinates() const;
 
-    int getCostDistance() const;
-    void setCostDistance(int cost);
+    /**
+     * \brief Index of this node in the flow field arrays of the grid
+     */
+    int getIndex() const;
 
+    int getCostDistance() const;
     int getIntegrationField() const;
-    void setIntegrationField(int integrationField);
-
     sf::Vector2f getFlowFieldDirection() const;
-    void setFlowFieldDirection(sf::Vector2f fieldDirection);
 
-    bool isVisualDebugEnabled() const;
-    void setVisualDebugEnabled(bool enabled);
+    /**
+     * \brief World position of the center of this node
+     */
+    sf::Vector2f getPosition() const;
 
 private:
-    void createQuadVertices();
-    void createOutlineVertices();
-
-    void updateQuadColor();
-
-    void setupDebugText(const FontManager& fontManager);
-
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
-
     // Reference to the grid linked to this node
     Grid& m_grid;
  
     // (X,Y) coordinates of the node in the grid
     sf::Vector2i m_coordinates;
 
+    // Index of the node in the flow field arrays
+    int m_index;
+
     /**
      * \brief Size of the node
      */
     float m_size;
-
-    int m_costDistance;
-    int m_integrationField;
-
-    // Store the direction of the flow in the direction of the goal
-    // (also called vector field)
-    sf::Vector2f m_flowFieldDirection;
-
-    /*
-     * DEBUG PROPERTIES
-     */
- 
-    sf::CircleShape m_positionPoint;
-
-    sf::VertexArray m_vertices;
-    sf::VertexArray m_outlineVertices;
-
-    Arrow m_arrow;
-
-    sf::Text m_costText;
-    sf::Text m_integrationFieldText;
-
-    bool m_isVisualDebugEnabled;
 };
 
 
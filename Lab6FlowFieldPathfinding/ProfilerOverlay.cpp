@@ -0,0 +1,65 @@
+#include "ProfilerOverlay.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include "Profiling/Profiler.hpp"
+
+namespace
+{
+    constexpr unsigned CharacterSize = 11;
+    constexpr float Margin = 6;
+    constexpr float ColumnSpacing = 16;
+}
+
+ProfilerOverlay::ProfilerOverlay(const sf::Font& font) :
+    m_names("", font, CharacterSize),
+    m_times("", font, CharacterSize)
+{
+    m_names.setPosition(Margin, Margin);
+    m_background.setPosition(0, 0);
+    m_background.setFillColor({0, 0, 0, 192});
+}
+
+void ProfilerOverlay::update()
+{
+    char line[96];
+    std::snprintf(line, sizeof(line), "%.2f ms  (%.0f fps)\n", Profiler::getFrameMilliseconds(),
+                  Profiler::getFrameMilliseconds() > 0 ? 1000 / Profiler::getFrameMilliseconds() : 0.0);
+
+    std::string names = "frame\n";
+    std::string times = line;
+    times += "last / avg / max ms, calls\n";
+    names += "\n";
+
+    for (const Profiler::Phase& phase : Profiler::getPhases())
+    {
+        names += std::string(static_cast<size_t>(phase.depth) * 2, ' ') + phase.name + "\n";
+
+        std::snprintf(line, sizeof(line), "%.2f / %.2f / %.2f  %d\n", phase.milliseconds, phase.averageMilliseconds,
+                      phase.maxMilliseconds, phase.callCount);
+        times += line;
+    }
+
+    m_names.setString(names);
+    m_times.setString(times);
+
+    const sf::FloatRect namesBounds = m_names.getLocalBounds();
+    m_times.setPosition(Margin + namesBounds.left + namesBounds.width + ColumnSpacing, Margin);
+
+    const sf::FloatRect timesBounds = m_times.getGlobalBounds();
+    m_background.setSize({
+        timesBounds.left + timesBounds.width + Margin,
+        std::max(namesBounds.top + namesBounds.height, timesBounds.top + timesBounds.height) + Margin * 2
+    });
+}
+
+void ProfilerOverlay::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    target.draw(m_background, states);
+    target.draw(m_names, states);
+    target.draw(m_times, states);
+}
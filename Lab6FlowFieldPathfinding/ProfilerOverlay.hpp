@@ -0,0 +1,35 @@
+#ifndef LAB6FLOWFIELD_PROFILEROVERLAY_HPP
+#define LAB6FLOWFIELD_PROFILEROVERLAY_HPP
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/Text.hpp>
+
+/**
+ * \brief Time of the last frame and of each of its phases (see Profiler), drawn in a corner of the screen
+ * \details One line per phase, indented by its nesting, with its time in the last frame, its moving average, its
+ * maximum over the last Profiler::FrameWindow frames and its number of calls. The texts are only built by update(),
+ * which reads the phases of the profiler, so nothing is spent on them while the overlay is hidden.
+ */
+class ProfilerOverlay : public sf::Drawable
+{
+public:
+    explicit ProfilerOverlay(const sf::Font& font);
+
+    /**
+     * \brief Build the texts from the phases of the last frame, to call once per frame while the overlay is shown
+     */
+    void update();
+
+private:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+    // Names of the phases, and their times in a column on their right
+    sf::Text m_names;
+    sf::Text m_times;
+    sf::RectangleShape m_background;
+};
+
+
+#endif //LAB6FLOWFIELD_PROFILEROVERLAY_HPP
@@ -0,0 +1,351 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+std::atomic<bool> Profiler::s_isEnabled{false};
+
+namespace
+{
+    // Weight of the last frame in the moving average of a phase
+    constexpr double AverageWeight = 0.1;
+
+    struct Event
+    {
+        const char* name;
+        std::int64_t start;
+        std::int64_t end;
+        int depth;
+        int thread;
+    };
+
+    struct Frame
+    {
+        std::int64_t start;
+        std::int64_t end;
+        int thread;
+    };
+
+    /**
+     * \brief Scopes recorded by a thread since the last frame, only locked by the thread and by beginFrame()
+     */
+    struct ThreadBuffer
+    {
+        int thread = 0;
+        std::string name;
+
+        // Scopes open on the thread, only used by the thread itself
+        int depth = 0;
+
+        std::mutex mutex;
+        std::vector<Event> events;
+    };
+
+    struct State
+    {
+        std::mutex mutex;
+        // Buffer of every thread which recorded a scope, kept after the thread ends: the threads of the game live as
+        // long as the game
+        std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+        // Scopes gathered for the frame being closed, kept to reuse their memory
+        std::vector<Event> frameEvents;
+        std::int64_t frameStart = -1;
+        int frameThread = 0;
+        int frameCount = 0;
+        double frameMilliseconds = 0;
+
+        std::vector<Profiler::Phase> phases;
+        // Milliseconds of each phase over the last frames, FrameWindow values per phase
+        std::vector<double> phaseHistory;
+
+        bool isCaptureStarting = false;
+        bool isCapturing = false;
+        std::vector<Event> captureEvents;
+        std::vector<Frame> captureFrames;
+        std::size_t droppedEventCount = 0;
+    };
+
+    State& getState()
+    {
+        static State state;
+        return state;
+    }
+
+    thread_local ThreadBuffer* currentThread = nullptr;
+
+    ThreadBuffer& getThreadBuffer()
+    {
+        if (currentThread != nullptr) return *currentThread;
+
+        State& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.threads.push_back(std::make_unique<ThreadBuffer>());
+        currentThread = state.threads.back().get();
+        currentThread->thread = static_cast<int>(state.threads.size());
+
+        return *currentThread;
+    }
+
+    /**
+     * \brief Move the scopes recorded by every thread to the frame events, with the state locked
+     */
+    void gatherEvents(State& state)
+    {
+        for (const auto& buffer : state.threads)
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            state.frameEvents.insert(state.frameEvents.end(), buffer->events.begin(), buffer->events.end());
+            buffer->events.clear();
+        }
+    }
+
+    /**
+     * \brief Keep the frame events in the capture, as long as it is not full
+     */
+    void captureEvents(State& state)
+    {
+        if (!state.isCapturing) return;
+
+        const std::size_t room = Profiler::MaxCaptureEventCount - state.captureEvents.size();
+        const std::size_t kept = std::min(room, state.frameEvents.size());
+        state.captureEvents.insert(state.captureEvents.end(), state.frameEvents.begin(),
+                                   state.frameEvents.begin() + static_cast<std::ptrdiff_t>(kept));
+        state.droppedEventCount += state.frameEvents.size() - kept;
+    }
+
+    /**
+     * \brief Sum the frame events by phase, and update the average and maximum of every phase
+     */
+    void updatePhases(State& state)
+    {
+        std::vector<Profiler::Phase>& phases = state.phases;
+        for (Profiler::Phase& phase : phases)
+        {
+            phase.callCount = 0;
+            phase.milliseconds = 0;
+        }
+
+        // A scope is recorded when it ends, after the scopes nested in it: the phases are listed by start instead
+        std::sort(state.frameEvents.begin(), state.frameEvents.end(), [](const Event& a, const Event& b)
+        {
+            return a.start < b.start;
+        });
+
+        for (const Event& event : state.frameEvents)
+        {
+            // The names are literals, the same scope always has the same address
+            auto phase = std::find_if(phases.begin(), phases.end(), [&event](const Profiler::Phase& candidate)
+            {
+                return candidate.name == event.name;
+            });
+            if (phase == phases.end())
+            {
+                phases.push_back({event.name, event.depth, 0, 0, -1, 0});
+                state.phaseHistory.resize(phases.size() * Profiler::FrameWindow, 0);
+                phase = phases.end() - 1;
+            }
+
+            phase->callCount++;
+            phase->milliseconds += static_cast<double>(event.end - event.start) / 1e6;
+        }
+
+        const int slot = state.frameCount % Profiler::FrameWindow;
+        for (size_t i = 0; i < phases.size(); i++)
+        {
+            Profiler::Phase& phase = phases[i];
+            phase.averageMilliseconds = phase.averageMilliseconds < 0
+                                            ? phase.milliseconds
+                                            : phase.averageMilliseconds * (1 - AverageWeight) +
+                                            phase.milliseconds * AverageWeight;
+
+            double* history = state.phaseHistory.data() + i * Profiler::FrameWindow;
+            history[slot] = phase.milliseconds;
+            phase.maxMilliseconds = *std::max_element(history, history + Profiler::FrameWindow);
+        }
+    }
+
+    /**
+     * \brief Write a name as a JSON string, the names are literals but may still hold quotes
+     */
+    void writeString(std::FILE* file, const char* text)
+    {
+        std::fputc('"', file);
+        for (const char* c = text; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\') std::fputc('\\', file);
+            if (static_cast<unsigned char>(*c) >= 0x20) std::fputc(*c, file);
+        }
+        std::fputc('"', file);
+    }
+}
+
+void Profiler::setEnabled(const bool isEnabled)
+{
+    if (isEnabled == Profiler::isEnabled()) return;
+
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (isEnabled)
+    {
+        // Scopes which ended just before the profiler was disabled, they belong to no frame
+        gatherEvents(state);
+        state.frameEvents.clear();
+    }
+    state.frameStart = -1;
+
+    s_isEnabled.store(isEnabled, std::memory_order_relaxed);
+}
+
+void Profiler::beginFrame()
+{
+    if (!isEnabled()) return;
+
+    const std::int64_t frameEnd = now();
+    const int thread = getThreadBuffer().thread;
+
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    gatherEvents(state);
+
+    if (state.frameStart >= 0)
+    {
+        state.frameMilliseconds = static_cast<double>(frameEnd - state.frameStart) / 1e6;
+        updatePhases(state);
+        state.frameCount++;
+
+        if (state.isCapturing) state.captureFrames.push_back({state.frameStart, frameEnd, state.frameThread});
+    }
+    captureEvents(state);
+    state.frameEvents.clear();
+
+    if (state.isCaptureStarting)
+    {
+        state.isCaptureStarting = false;
+        state.isCapturing = true;
+    }
+
+    state.frameStart = frameEnd;
+    state.frameThread = thread;
+}
+
+const std::vector<Profiler::Phase>& Profiler::getPhases()
+{
+    return getState().phases;
+}
+
+double Profiler::getFrameMilliseconds()
+{
+    return getState().frameMilliseconds;
+}
+
+void Profiler::startCapture()
+{
+    setEnabled(true);
+
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.captureEvents.clear();
+    state.captureFrames.clear();
+    state.droppedEventCount = 0;
+    state.isCapturing = false;
+    state.isCaptureStarting = true;
+}
+
+bool Profiler::stopCapture(const std::string& path)
+{
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    // The scopes of the frame in progress are kept too, they still count in its phases
+    gatherEvents(state);
+    captureEvents(state);
+
+    state.isCaptureStarting = false;
+    state.isCapturing = false;
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) return false;
+
+    std::int64_t origin = state.captureFrames.empty() ? 0 : state.captureFrames.front().start;
+    for (const Event& event : state.captureEvents) origin = std::min(origin, event.start);
+
+    // Complete events ("X"), in microseconds from the start of the capture
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool isFirst = true;
+    for (const auto& buffer : state.threads)
+    {
+        const std::string name = buffer->name.empty() ? "thread " + std::to_string(buffer->thread) : buffer->name;
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                     isFirst ? "" : ",\n", buffer->thread);
+        writeString(file, name.c_str());
+        std::fprintf(file, "}}");
+        isFirst = false;
+    }
+    for (size_t i = 0; i < state.captureFrames.size(); i++)
+    {
+        const Frame& frame = state.captureFrames[i];
+        std::fprintf(file, "%s{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                     "\"dur\":%.3f,\"args\":{\"frame\":%zu}}", isFirst ? "" : ",\n", frame.thread,
+                     static_cast<double>(frame.start - origin) / 1e3,
+                     static_cast<double>(frame.end - frame.start) / 1e3, i);
+        isFirst = false;
+    }
+    for (const Event& event : state.captureEvents)
+    {
+        std::fprintf(file, "%s{\"name\":", isFirst ? "" : ",\n");
+        writeString(file, event.name);
+        std::fprintf(file, ",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     event.thread, static_cast<double>(event.start - origin) / 1e3,
+                     static_cast<double>(event.end - event.start) / 1e3);
+        isFirst = false;
+    }
+    std::fprintf(file, "\n],\"otherData\":{\"droppedEvents\":%zu}}\n", state.droppedEventCount);
+
+    state.captureEvents.clear();
+    state.captureFrames.clear();
+
+    const bool isWritten = std::ferror(file) == 0;
+    return std::fclose(file) == 0 && isWritten;
+}
+
+bool Profiler::isCapturing()
+{
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.isCapturing || state.isCaptureStarting;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(getState().mutex);
+    buffer.name = name;
+}
+
+int Profiler::beginScope()
+{
+    return getThreadBuffer().depth++;
+}
+
+void Profiler::endScope(const char* name, const std::int64_t start, const int depth)
+{
+    const std::int64_t end = now();
+
+    ThreadBuffer& buffer = getThreadBuffer();
+    buffer.depth = depth;
+
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back({name, start, end, depth, buffer.thread});
+}
+
+std::int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,164 @@
+#ifndef LAB6FLOWFIELD_PROFILER_HPP
+#define LAB6FLOWFIELD_PROFILER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Time spent in the phases of each frame, measured by the scopes placed on the hot paths of the game
+ * \details A phase is timed by a ProfileScope, usually through LAB6FLOWFIELD_PROFILE_SCOPE. While the profiler is
+ * disabled, which it is by default, a scope only reads a flag. Once enabled, each scope records its start and end in a
+ * buffer of its own thread, so the worker threads are measured too without waiting on each other.
+ *
+ * beginFrame() closes the frame, gathers the scopes of every thread and sums them by name for getPhases(). During a
+ * capture, the scopes are also kept until stopCapture() writes them in the Chrome trace event format, which can be
+ * opened in chrome://tracing or https://ui.perfetto.dev to look at each frame and each thread on a timeline.
+ *
+ * Defining LAB6FLOWFIELD_NO_PROFILING removes the scopes at compile time.
+ */
+class Profiler
+{
+public:
+    /**
+     * \brief Time spent in a phase during the last frame, summed over its scopes on every thread
+     */
+    struct Phase
+    {
+        const char* name;
+        // Nesting of the first scope of the phase on its thread, 0 for a scope opened outside of any other
+        int depth;
+        int callCount;
+        double milliseconds;
+        // Moving average over the last frames, and maximum over the last FrameWindow frames
+        double averageMilliseconds;
+        double maxMilliseconds;
+    };
+
+    // Number of frames the maximum of a phase is taken over
+    static constexpr int FrameWindow = 60;
+
+    // Scopes kept by a capture, the ones past this number are dropped so a forgotten capture does not fill the memory
+    static constexpr std::size_t MaxCaptureEventCount = 1 << 22;
+
+    Profiler() = delete;
+
+    static void setEnabled(bool isEnabled);
+
+    static bool isEnabled()
+    {
+        return s_isEnabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Close the current frame and start the next one, to call from the thread running the frames
+     * \details The scopes still open belong to the frame they end in.
+     */
+    static void beginFrame();
+
+    /**
+     * \brief Phases of the last complete frame, in the order they first appeared
+     */
+    static const std::vector<Phase>& getPhases();
+
+    /**
+     * \brief Duration of the last complete frame, between its beginFrame() and the next one
+     */
+    static double getFrameMilliseconds();
+
+    /**
+     * \brief Keep every scope from the next frame on, until stopCapture(), and enable the profiler
+     */
+    static void startCapture();
+
+    /**
+     * \brief Write the scopes captured since startCapture() as a Chrome trace event JSON file
+     * \return false if the file could not be written
+     */
+    static bool stopCapture(const std::string& path);
+
+    static bool isCapturing();
+
+    /**
+     * \brief Name of the calling thread in the trace, its number by default
+     */
+    static void setThreadName(const char* name);
+
+    /**
+     * \brief Open a scope on the calling thread, see ProfileScope
+     * \return number of scopes already open on the thread
+     */
+    static int beginScope();
+
+    /**
+     * \brief Close the last scope opened on the calling thread and record it
+     * \param name string with static storage, only its address is kept
+     */
+    static void endScope(const char* name, std::int64_t start, int depth);
+
+    /**
+     * \brief Current time in nanoseconds, from a monotonic clock
+     */
+    static std::int64_t now();
+
+private:
+    static std::atomic<bool> s_isEnabled;
+};
+
+/**
+ * \brief Time its lifetime under a name, if the profiler is enabled when it starts
+ */
+class ProfileScope
+{
+public:
+    /**
+     * \param name string with static storage, usually a literal
+     */
+    explicit ProfileScope(const char* name);
+
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    // nullptr when the profiler was disabled at the start, nothing is recorded then
+    const char* m_name;
+    std::int64_t m_start;
+    int m_depth;
+};
+
+inline ProfileScope::ProfileScope(const char* name) :
+    m_name(nullptr),
+    m_start(0),
+    m_depth(0)
+{
+    if (!Profiler::isEnabled()) return;
+
+    m_name = name;
+    m_depth = Profiler::beginScope();
+    m_start = Profiler::now();
+}
+
+inline ProfileScope::~ProfileScope()
+{
+    if (m_name == nullptr) return;
+
+    Profiler::endScope(m_name, m_start, m_depth);
+}
+
+#define LAB6FLOWFIELD_PROFILE_CONCAT_IMPL(a, b) a##b
+#define LAB6FLOWFIELD_PROFILE_CONCAT(a, b) LAB6FLOWFIELD_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef LAB6FLOWFIELD_NO_PROFILING
+#define LAB6FLOWFIELD_PROFILE_SCOPE(name) static_cast<void>(0)
+#else
+/**
+ * \brief Time the rest of the enclosing block under a name
+ */
+#define LAB6FLOWFIELD_PROFILE_SCOPE(name) const ProfileScope LAB6FLOWFIELD_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
+
+
+#endif //LAB6FLOWFIELD_PROFILER_HPP
@@ -0,0 +1,174 @@
+#include "GridMesh.hpp"
+
+#include <climits>
+#include <cmath>
+
+#include "../FlowField/FlowField.hpp"
+
+namespace
+{
+    // Cost at which the heatmap reaches black
+    constexpr int HeatmapMaxCost = 50;
+
+    // Size of the arrow head relative to the length of the arrow
+    constexpr float ArrowHeadLength = 0.75f;
+    constexpr float ArrowHeadWidth = 0.5f;
+}
+
+GridMesh::GridMesh(const int width, const int height, const float cellSize) :
+    m_width(width),
+    m_height(height),
+    m_cellSize(cellSize)
+{
+    createQuadVertices();
+    createLineVertices();
+
+    // Every arrow starts collapsed, each cell has no direction yet
+    m_arrowVertices.resize(static_cast<size_t>(width) * height * ArrowVertexCount);
+    for (int index = 0; index < width * height; index++)
+    {
+        updateArrow(index, 0, 0);
+    }
+}
+
+void GridMesh::update(const FlowField& field)
+{
+    for (int index = 0; index < m_width * m_height; index++)
+    {
+        updateCell(field, index);
+    }
+}
+
+void GridMesh::updateCell(const FlowField& field, const int index)
+{
+    setCellColor(index, getHeatmapColor(field.getCostDistance(index)));
+
+    const FlowField::Direction direction = field.getDirection(index);
+    updateArrow(index, direction.x, direction.y);
+}
+
+void GridMesh::setCellColor(const int index, const Color color)
+{
+    Vertex* quad = &m_quadVertices[static_cast<size_t>(index) * QuadVertexCount];
+    for (int i = 0; i < QuadVertexCount; i++)
+    {
+        quad[i].color = color;
+    }
+}
+
+GridMesh::Color GridMesh::getHeatmapColor(const int costDistance)
+{
+    // 0 = Goal Node
+    if (costDistance == 0) return GoalColor;
+
+    // INT_MAX = Impassable node
+    if (costDistance == INT_MAX) return ObstacleColor;
+
+    // Otherwise, the lower the cost the lighter the blue
+    const auto heatmapColor = static_cast<std::uint8_t>((HeatmapMaxCost - costDistance) * 255 / HeatmapMaxCost);
+    return {0, 0, heatmapColor, 255};
+}
+
+const std::vector<GridMesh::Vertex>& GridMesh::getQuadVertices() const
+{
+    return m_quadVertices;
+}
+
+const std::vector<GridMesh::Vertex>& GridMesh::getLineVertices() const
+{
+    return m_lineVertices;
+}
+
+const std::vector<GridMesh::Vertex>& GridMesh::getArrowVertices() const
+{
+    return m_arrowVertices;
+}
+
+int GridMesh::getWidth() const
+{
+    return m_width;
+}
+
+int GridMesh::getHeight() const
+{
+    return m_height;
+}
+
+void GridMesh::createQuadVertices()
+{
+    m_quadVertices.resize(static_cast<size_t>(m_width) * m_height * QuadVertexCount);
+
+    for (int y = 0; y < m_height; y++)
+    {
+        for (int x = 0; x < m_width; x++)
+        {
+            const float left = static_cast<float>(x) * m_cellSize;
+            const float top = static_cast<float>(y) * m_cellSize;
+            Vertex* quad = &m_quadVertices[static_cast<size_t>(x + m_width * y) * QuadVertexCount];
+
+            quad[0] = {left, top, getHeatmapColor(FlowField::Unvisited)};
+            quad[1] = {left + m_cellSize, top, quad[0].color};
+            quad[2] = {left + m_cellSize, top + m_cellSize, quad[0].color};
+            quad[3] = {left, top + m_cellSize, quad[0].color};
+        }
+    }
+}
+
+void GridMesh::createLineVertices()
+{
+    // One line across the whole grid for each border between the cells, and the outline
+    const float right = static_cast<float>(m_width) * m_cellSize;
+    const float bottom = static_cast<float>(m_height) * m_cellSize;
+
+    m_lineVertices.clear();
+    m_lineVertices.reserve(static_cast<size_t>(m_width + m_height + 2) * 2);
+    for (int x = 0; x <= m_width; x++)
+    {
+        const float lineX = static_cast<float>(x) * m_cellSize;
+        m_lineVertices.push_back({lineX, 0, LineColor});
+        m_lineVertices.push_back({lineX, bottom, LineColor});
+    }
+    for (int y = 0; y <= m_height; y++)
+    {
+        const float lineY = static_cast<float>(y) * m_cellSize;
+        m_lineVertices.push_back({0, lineY, LineColor});
+        m_lineVertices.push_back({right, lineY, LineColor});
+    }
+}
+
+void GridMesh::updateArrow(const int index, const float directionX, const float directionY)
+{
+    const float length = m_cellSize / 2;
+    const float centerX = static_cast<float>(index % m_width) * m_cellSize + length;
+    const float centerY = static_cast<float>(index / m_width) * m_cellSize + length;
+
+    Vertex* arrow = &m_arrowVertices[static_cast<size_t>(index) * ArrowVertexCount];
+
+    const float directionLength = std::sqrt(directionX * directionX + directionY * directionY);
+    if (directionLength == 0)
+    {
+        for (int i = 0; i < ArrowVertexCount; i++)
+        {
+            arrow[i] = {centerX, centerY, ArrowColor};
+        }
+        return;
+    }
+
+    const float headX = centerX + directionX * length;
+    const float headY = centerY + directionY * length;
+
+    // Unit vector along the arrow and its perpendicular
+    const float unitX = directionX / directionLength;
+    const float unitY = directionY / directionLength;
+    const float backX = -unitX * length * ArrowHeadLength;
+    const float backY = -unitY * length * ArrowHeadLength;
+    const float sideX = -unitY * length * ArrowHeadLength * ArrowHeadWidth;
+    const float sideY = unitX * length * ArrowHeadLength * ArrowHeadWidth;
+
+    arrow[0] = {centerX, centerY, ArrowColor};
+    arrow[1] = {headX, headY, ArrowColor};
+    arrow[2] = {headX, headY, ArrowColor};
+    arrow[3] = {headX + backX + sideX, headY + backY + sideY, ArrowColor};
+    arrow[4] = {headX, headY, ArrowColor};
+    arrow[5] = {headX + backX - sideX, headY + backY - sideY, ArrowColor};
+}
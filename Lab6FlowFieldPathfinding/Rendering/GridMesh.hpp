@@ -0,0 +1,90 @@
+#ifndef LAB6FLOWFIELD_GRIDMESH_HPP
+#define LAB6FLOWFIELD_GRIDMESH_HPP
+
+#include <vector>
+#include <cstdint>
+
+class FlowField;
+
+/**
+ * \brief Vertices of the layers drawn for a flow field: the heatmap, the grid lines and the direction arrows
+ * \details Each layer is a single array of vertices, so it takes one draw call whatever the size of the grid. The
+ * vertices do not depend on SFML: the game copies them into sf::VertexArray, with the same primitives (quads for the
+ * heatmap, lines for the grid lines and the arrows).
+ *
+ * The quads and arrows of a cell are at a fixed place in their array (see QuadVertexCount and ArrowVertexCount), so a
+ * few cells can be updated without touching the others. A cell without direction has its arrow collapsed on its centre.
+ */
+class GridMesh
+{
+public:
+    struct Color
+    {
+        std::uint8_t r;
+        std::uint8_t g;
+        std::uint8_t b;
+        std::uint8_t a;
+    };
+
+    struct Vertex
+    {
+        float x;
+        float y;
+        Color color;
+    };
+
+    static constexpr int QuadVertexCount = 4;
+    // Shaft, then the two sides of the head
+    static constexpr int ArrowVertexCount = 6;
+
+    static constexpr Color GoalColor = {255, 0, 0, 255};
+    static constexpr Color ObstacleColor = {255, 0, 255, 255};
+    static constexpr Color LineColor = {255, 255, 255, 255};
+    static constexpr Color ArrowColor = {255, 255, 255, 255};
+
+    GridMesh(int width, int height, float cellSize);
+
+    /**
+     * \brief Refresh the color and arrow of every cell from the flow field
+     */
+    void update(const FlowField& field);
+
+    /**
+     * \brief Refresh the color and arrow of one cell from the flow field
+     */
+    void updateCell(const FlowField& field, int index);
+
+    /**
+     * \brief Change the color of the quad of a cell, until the next update of the cell
+     */
+    void setCellColor(int index, Color color);
+
+    /**
+     * \brief Heatmap color of a cell, from its cost distance
+     */
+    static Color getHeatmapColor(int costDistance);
+
+    const std::vector<Vertex>& getQuadVertices() const;
+    const std::vector<Vertex>& getLineVertices() const;
+    const std::vector<Vertex>& getArrowVertices() const;
+
+    int getWidth() const;
+    int getHeight() const;
+
+private:
+    void createQuadVertices();
+    void createLineVertices();
+
+    void updateArrow(int index, float directionX, float directionY);
+
+    int m_width;
+    int m_height;
+    float m_cellSize;
+
+    std::vector<Vertex> m_quadVertices;
+    std::vector<Vertex> m_lineVertices;
+    std::vector<Vertex> m_arrowVertices;
+};
+
+
+#endif //LAB6FLOWFIELD_GRIDMESH_HPP
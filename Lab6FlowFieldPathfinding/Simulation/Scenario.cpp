@@ -0,0 +1,292 @@
+#include "Scenario.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "../FlowField/MapFile.hpp"
+
+namespace
+{
+    /**
+     * \brief Words of a line, without its comment
+     */
+    std::vector<std::string> splitWords(const std::string& line)
+    {
+        std::istringstream stream(line.substr(0, line.find('#')));
+        std::vector<std::string> words;
+        std::string word;
+        while (stream >> word) words.push_back(word);
+
+        return words;
+    }
+
+    /**
+     * \brief Convert a whole word to a number
+     * \return false if the word is not a number or has characters after it
+     */
+    template <typename Number>
+    bool parseNumber(const std::string& word, Number& number)
+    {
+        std::istringstream stream(word);
+        stream >> number;
+
+        return !stream.fail() && stream.peek() == std::char_traits<char>::eof();
+    }
+
+    bool parseState(const std::string& word, bool& isObstacle)
+    {
+        if (word != "on" && word != "off") return false;
+
+        isObstacle = word == "on";
+        return true;
+    }
+
+    bool isAbsolutePath(const std::string& path)
+    {
+        return !path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'));
+    }
+}
+
+bool Scenario::load(const std::string& path, Scenario& scenario, std::string& error)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        error = "cannot read " + path;
+        return false;
+    }
+
+    const size_t separator = path.find_last_of("/\\");
+    return parse(input, separator == std::string::npos ? "" : path.substr(0, separator + 1), scenario, error);
+}
+
+bool Scenario::parse(std::istream& input, const std::string& directory, Scenario& scenario, std::string& error)
+{
+    scenario = Scenario();
+
+    bool hasMap = false;
+    std::string line;
+    for (int lineNumber = 1; std::getline(input, line); lineNumber++)
+    {
+        std::vector<std::string> words = splitWords(line);
+        if (words.empty()) continue;
+
+        const auto fail = [&](const std::string& message)
+        {
+            error = "line " + std::to_string(lineNumber) + ": " + message;
+            return false;
+        };
+
+        Event event{};
+        const bool isTimed = words[0] == "at";
+        if (isTimed)
+        {
+            if (words.size() < 3 || !parseNumber(words[1], event.tick) || event.tick < 0)
+            {
+                return fail("expected at <tick> <event>");
+            }
+            words.erase(words.begin(), words.begin() + 2);
+        }
+
+        const std::string& command = words[0];
+        const size_t argumentCount = words.size() - 1;
+        const auto isSetting = [&](const size_t expectedCount)
+        {
+            return !isTimed && argumentCount == expectedCount;
+        };
+
+        if (command == "map")
+        {
+            if (!isSetting(4) || !parseNumber(words[1], scenario.width) || !parseNumber(words[2], scenario.height) ||
+                !MapGenerator::parse(words[3], scenario.mapType) || !parseNumber(words[4], scenario.mapSeed) ||
+                scenario.width <= 0 || scenario.height <= 0)
+            {
+                return fail("expected map <width> <height> <open|maze|rooms|random> <seed>");
+            }
+            scenario.mapFilePath.clear();
+            hasMap = true;
+        }
+        else if (command == "map-file")
+        {
+            if (!isSetting(1)) return fail("expected map-file <path>");
+
+            scenario.mapFilePath = isAbsolutePath(words[1]) ? words[1] : directory + words[1];
+
+            // Only the header is read here, for the size of the grid
+            MapFile file;
+            if (!file.open(scenario.mapFilePath)) return fail("cannot open the map file " + scenario.mapFilePath);
+            scenario.width = file.getWidth();
+            scenario.height = file.getHeight();
+            scenario.cellSize = file.getCellSize();
+            hasMap = true;
+        }
+        else if (command == "terrain")
+        {
+            if (!isSetting(1) || !parseNumber(words[1], scenario.terrainSeed)) return fail("expected terrain <seed>");
+            scenario.hasTerrain = true;
+        }
+        else if (command == "integrator")
+        {
+            if (!isSetting(1) || !parseIntegrator(words[1], scenario.integrator))
+            {
+                return fail("expected integrator <bfs|weighted|eikonal>");
+            }
+        }
+        else if (command == "line-of-sight")
+        {
+            if (!isSetting(1) || !parseState(words[1], scenario.isLineOfSightEnabled))
+            {
+                return fail("expected line-of-sight <on|off>");
+            }
+        }
+        else if (command == "cell-size")
+        {
+            if (!isSetting(1) || !parseNumber(words[1], scenario.cellSize) || scenario.cellSize <= 0)
+            {
+                return fail("expected cell-size <size>");
+            }
+        }
+        else if (command == "tick-rate")
+        {
+            if (!isSetting(1) || !parseNumber(words[1], scenario.tickRate) || scenario.tickRate <= 0)
+            {
+                return fail("expected tick-rate <ticks per second>");
+            }
+        }
+        else if (command == "ticks")
+        {
+            if (!isSetting(1) || !parseNumber(words[1], scenario.tickCount) || scenario.tickCount < 0)
+            {
+                return fail("expected ticks <count>");
+            }
+        }
+        else if (command == "agent")
+        {
+            if (!isSetting(2) || !parseNumber(words[1], scenario.agentMaxSpeed) ||
+                !parseNumber(words[2], scenario.agentMaxForce))
+            {
+                return fail("expected agent <max speed> <max force>");
+            }
+        }
+        else if (command == "separation")
+        {
+            if (!isSetting(2) || !parseNumber(words[1], scenario.separationRadius) ||
+                !parseNumber(words[2], scenario.separationStrength) || scenario.separationRadius < 0)
+            {
+                return fail("expected separation <radius> <strength>");
+            }
+        }
+        else if (command == "goal")
+        {
+            event.type = EventType::Goal;
+            if (argumentCount != 2 || !parseNumber(words[1], event.x) || !parseNumber(words[2], event.y))
+            {
+                return fail("expected goal <x> <y>");
+            }
+            if (!hasMap) return fail("goal before the map");
+            if (event.x < 0 || event.x >= scenario.width || event.y < 0 || event.y >= scenario.height)
+            {
+                return fail("goal outside the map");
+            }
+        }
+        else if (command == "obstacle")
+        {
+            event.type = EventType::Obstacle;
+            if (argumentCount != 3 || !parseNumber(words[1], event.x) || !parseNumber(words[2], event.y) ||
+                !parseState(words[3], event.isObstacle))
+            {
+                return fail("expected obstacle <x> <y> <on|off>");
+            }
+        }
+        else if (command == "rect")
+        {
+            event.type = EventType::Rect;
+            if (argumentCount != 5 || !parseNumber(words[1], event.x) || !parseNumber(words[2], event.y) ||
+                !parseNumber(words[3], event.width) || !parseNumber(words[4], event.height) ||
+                !parseState(words[5], event.isObstacle))
+            {
+                return fail("expected rect <left> <top> <width> <height> <on|off>");
+            }
+        }
+        else if (command == "polygon")
+        {
+            event.type = EventType::Polygon;
+            if (argumentCount < 7 || argumentCount % 2 == 0 || !parseState(words[1], event.isObstacle))
+            {
+                return fail("expected polygon <on|off> <x> <y> <x> <y> <x> <y> ...");
+            }
+            for (size_t i = 2; i + 1 < words.size(); i += 2)
+            {
+                ObstacleMap::Point vertex{};
+                if (!parseNumber(words[i], vertex.x) || !parseNumber(words[i + 1], vertex.y))
+                {
+                    return fail("polygon vertex " + words[i] + " " + words[i + 1] + " is not a number");
+                }
+                event.vertices.push_back(vertex);
+            }
+        }
+        else if (command == "spawn")
+        {
+            event.type = EventType::Spawn;
+            if (argumentCount != 2 || !parseNumber(words[1], event.count) || !parseNumber(words[2], event.seed) ||
+                event.count < 0)
+            {
+                return fail("expected spawn <count> <seed>");
+            }
+        }
+        else
+        {
+            return fail(isTimed ? "unknown event " + command : "unknown command " + command);
+        }
+
+        const bool isEvent = command == "goal" || command == "obstacle" || command == "rect" || command == "polygon" ||
+            command == "spawn";
+        if (isEvent) scenario.events.push_back(event);
+    }
+
+    if (!hasMap)
+    {
+        error = "no map, expected map or map-file";
+        return false;
+    }
+
+    // Stable, the events of a tick keep the order of the file
+    std::stable_sort(scenario.events.begin(), scenario.events.end(), [](const Event& a, const Event& b)
+    {
+        return a.tick < b.tick;
+    });
+
+    return true;
+}
+
+const char* Scenario::getIntegratorName(const FlowField::Integrator integrator)
+{
+    switch (integrator)
+    {
+    case FlowField::Integrator::BreadthFirst:
+        return "bfs";
+    case FlowField::Integrator::Weighted:
+        return "weighted";
+    case FlowField::Integrator::Eikonal:
+        return "eikonal";
+    }
+
+    return "unknown";
+}
+
+bool Scenario::parseIntegrator(const std::string& name, FlowField::Integrator& integrator)
+{
+    for (const auto candidate : {
+             FlowField::Integrator::BreadthFirst, FlowField::Integrator::Weighted, FlowField::Integrator::Eikonal
+         })
+    {
+        if (name == getIntegratorName(candidate))
+        {
+            integrator = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,118 @@
+#ifndef LAB6FLOWFIELD_SCENARIO_HPP
+#define LAB6FLOWFIELD_SCENARIO_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "../Benchmark/MapGenerator.hpp"
+#include "../FlowField/FlowField.hpp"
+#include "../FlowField/ObstacleMap.hpp"
+
+/**
+ * \brief Script of a headless simulation: a map, then the goals, obstacle edits and agent spawns of each tick
+ * \details A scenario is a text file with one command per line, '#' starting a comment:
+ *
+ *     map 256 256 rooms 42          # width, height, map type (open, maze, rooms, random) and seed of MapGenerator
+ *     map-file level.flowmap        # or a MapFile, relative to the scenario, instead of a generated map
+ *     terrain 7                     # terrain costs of MapGenerator::generateTerrain() with this seed
+ *     integrator weighted           # bfs, weighted or eikonal, bfs by default
+ *     line-of-sight on              # agents seeing the goal walk straight to it (see FlowField::computeLineOfSight)
+ *     cell-size 16                  # size of a cell in world coordinates, 16 by default
+ *     tick-rate 60                  # ticks per second of simulated time, 60 by default
+ *     ticks 3600                    # number of ticks run
+ *     agent 60 150                  # max speed and max force of the agents, the ones of the game by default
+ *     separation 8 1                # separation radius and strength of the agents (see AgentStore::setSeparation)
+ *
+ *     goal 128 128                  # events, run before the first tick
+ *     spawn 2000 1                  # agent count and seed, on random passable cells
+ *     at 600 goal 20 30             # "at <tick>" runs the event before that tick
+ *     at 900 obstacle 64 64 on      # one cell, repaired in place when the field is calculated
+ *     at 900 rect 10 10 40 4 off    # left, top, width, height
+ *     at 1200 polygon on 10 10 60 12 30 50
+ *
+ * The events of a tick run in the order of the file. The same scenario always gives the same simulation.
+ */
+struct Scenario
+{
+    enum class EventType
+    {
+        Goal,
+        Obstacle,
+        Rect,
+        Polygon,
+        Spawn
+    };
+
+    struct Event
+    {
+        int tick;
+        EventType type;
+
+        // Cell of Goal and Obstacle, top left corner of Rect
+        int x;
+        int y;
+
+        // Size of Rect
+        int width;
+        int height;
+
+        // Added or removed by Obstacle, Rect and Polygon
+        bool isObstacle;
+        std::vector<ObstacleMap::Point> vertices;
+
+        // Agents added by Spawn
+        int count;
+        unsigned seed;
+    };
+
+    // Generated map, unless mapFilePath is set
+    int width = 0;
+    int height = 0;
+    MapType mapType = MapType::Open;
+    unsigned mapSeed = 0;
+
+    // Absolute or relative to the working directory, already resolved from the scenario
+    std::string mapFilePath;
+
+    bool hasTerrain = false;
+    unsigned terrainSeed = 0;
+
+    FlowField::Integrator integrator = FlowField::Integrator::BreadthFirst;
+    bool isLineOfSightEnabled = false;
+    float cellSize = 16.f;
+    int tickRate = 60;
+    int tickCount = 0;
+
+    float agentMaxSpeed = 60.f;
+    float agentMaxForce = 150.f;
+    float separationRadius = 0;
+    float separationStrength = 1.f;
+
+    // Sorted by tick, in the order of the file within a tick
+    std::vector<Event> events;
+
+    /**
+     * \brief Read a scenario file, the paths in it being relative to the file
+     * \param error what is wrong and on which line, when false is returned
+     * \return false if the file cannot be read or is not a valid scenario
+     */
+    static bool load(const std::string& path, Scenario& scenario, std::string& error);
+
+    /**
+     * \brief Read a scenario from a stream
+     * \param directory prepended to the relative paths of the scenario, empty for the working directory
+     */
+    static bool parse(std::istream& input, const std::string& directory, Scenario& scenario, std::string& error);
+
+    static const char* getIntegratorName(FlowField::Integrator integrator);
+
+    /**
+     * \brief Convert an integrator name (bfs, weighted, eikonal) to its integrator
+     * \return false if the name is unknown
+     */
+    static bool parseIntegrator(const std::string& name, FlowField::Integrator& integrator);
+};
+
+
+#endif //LAB6FLOWFIELD_SCENARIO_HPP
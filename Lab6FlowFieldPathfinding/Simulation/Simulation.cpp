@@ -0,0 +1,226 @@
+#include "Simulation.hpp"
+
+#include <random>
+
+#include "../FlowField/MapFile.hpp"
+#include "../Profiling/Profiler.hpp"
+
+namespace
+{
+    constexpr std::uint64_t FnvOffsetBasis = 14695981039346656037ULL;
+    constexpr std::uint64_t FnvPrime = 1099511628211ULL;
+
+    /**
+     * \brief FNV-1a hash of some bytes, continuing from a previous hash
+     */
+    std::uint64_t hashBytes(std::uint64_t hash, const void* bytes, const size_t size)
+    {
+        const auto* data = static_cast<const unsigned char*>(bytes);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ data[i]) * FnvPrime;
+        }
+
+        return hash;
+    }
+}
+
+Simulation::Simulation(const Scenario& scenario, ThreadPool* pool) :
+    m_scenario(scenario),
+    m_pool(pool),
+    m_field(scenario.width, scenario.height, scenario.cellSize),
+    m_obstacles(scenario.width, scenario.height),
+    m_agents(scenario.agentMaxSpeed, scenario.agentMaxForce),
+    m_timeStep(1.f / static_cast<float>(scenario.tickRate)),
+    m_tick(0),
+    m_nextEvent(0),
+    m_hasGoal(false),
+    m_isFieldStale(false),
+    m_calculationCount(0),
+    m_repairCount(0)
+{
+    MapFile file;
+    if (!scenario.mapFilePath.empty() && file.open(scenario.mapFilePath))
+    {
+        file.loadMap(m_field);
+        m_obstacles.loadRows(file.getObstacleRows());
+    }
+    else
+    {
+        MapGenerator::generate(m_field, scenario.mapType, scenario.mapSeed);
+        for (int i = 0; i < m_field.getCellCount(); i++)
+        {
+            if (m_field.isObstacle(i)) m_obstacles.setObstacle(i % scenario.width, i / scenario.width, true);
+        }
+    }
+
+    if (scenario.hasTerrain) MapGenerator::generateTerrain(m_field, scenario.terrainSeed);
+    m_field.setIntegrator(scenario.integrator);
+    m_field.setLineOfSightEnabled(scenario.isLineOfSightEnabled);
+    m_field.setThreadPool(pool);
+
+    m_agents.setBounds(0, 0, static_cast<float>(scenario.width) * scenario.cellSize,
+                       static_cast<float>(scenario.height) * scenario.cellSize);
+    m_agents.setSeparation(scenario.separationRadius, scenario.separationStrength);
+}
+
+void Simulation::step()
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("Simulation::step");
+
+    const std::vector<Scenario::Event>& events = m_scenario.events;
+    while (m_nextEvent < events.size() && events[m_nextEvent].tick <= m_tick)
+    {
+        runEvent(events[m_nextEvent]);
+        m_nextEvent++;
+    }
+
+    if (m_isFieldStale && m_hasGoal)
+    {
+        m_field.calculate();
+        m_isFieldStale = false;
+        m_calculationCount++;
+    }
+
+    // No goal yet, the agents wait for one
+    if (m_field.isCalculated())
+    {
+        m_agents.update(m_field, m_timeStep, m_pool);
+    }
+
+    m_tick++;
+}
+
+bool Simulation::isFinished() const
+{
+    return m_tick >= m_scenario.tickCount;
+}
+
+int Simulation::getTick() const
+{
+    return m_tick;
+}
+
+float Simulation::getTimeStep() const
+{
+    return m_timeStep;
+}
+
+const FlowField& Simulation::getField() const
+{
+    return m_field;
+}
+
+const AgentStore& Simulation::getAgents() const
+{
+    return m_agents;
+}
+
+int Simulation::getCalculationCount() const
+{
+    return m_calculationCount;
+}
+
+int Simulation::getRepairCount() const
+{
+    return m_repairCount;
+}
+
+std::uint64_t Simulation::getChecksum() const
+{
+    std::uint64_t hash = hashBytes(FnvOffsetBasis, &m_tick, sizeof(m_tick));
+
+    // The float values are hashed bit for bit, the simulation is expected to give exactly the same ones
+    for (const std::vector<float>* values : {&m_agents.getPositionsX(), &m_agents.getPositionsY()})
+    {
+        hash = hashBytes(hash, values->data(), values->size() * sizeof(float));
+    }
+    for (int i = 0; i < m_agents.size(); i++)
+    {
+        const float velocity[2] = {m_agents.getVelocityX(i), m_agents.getVelocityY(i)};
+        hash = hashBytes(hash, velocity, sizeof(velocity));
+    }
+
+    const std::vector<std::uint8_t>& codes = m_field.getDirectionCodes();
+    return hashBytes(hash, codes.data(), codes.size());
+}
+
+void Simulation::runEvent(const Scenario::Event& event)
+{
+    switch (event.type)
+    {
+    case Scenario::EventType::Goal:
+        m_field.setGoal(event.x, event.y);
+        m_hasGoal = true;
+        m_isFieldStale = true;
+        break;
+    case Scenario::EventType::Obstacle:
+    {
+        const std::uint64_t version = m_obstacles.getVersion();
+        m_obstacles.setObstacle(event.x, event.y, event.isObstacle);
+        if (m_obstacles.getVersion() == version) break;
+
+        if (m_field.isCalculated() && !m_isFieldStale)
+        {
+            m_field.updateObstacle(event.x, event.y, event.isObstacle);
+            m_repairCount++;
+        }
+        else
+        {
+            m_field.setObstacle(event.x, event.y, event.isObstacle);
+            m_isFieldStale = true;
+        }
+        break;
+    }
+    case Scenario::EventType::Rect:
+    case Scenario::EventType::Polygon:
+    {
+        const std::uint64_t version = m_obstacles.getVersion();
+        if (event.type == Scenario::EventType::Rect)
+        {
+            m_obstacles.fillRect(event.x, event.y, event.width, event.height, event.isObstacle);
+        }
+        else
+        {
+            m_obstacles.fillPolygon(event.vertices, event.isObstacle);
+        }
+        if (m_obstacles.getVersion() == version) break;
+
+        m_field.setObstacles(m_obstacles);
+        m_isFieldStale = true;
+        break;
+    }
+    case Scenario::EventType::Spawn:
+        spawnAgents(event.count, event.seed);
+        break;
+    }
+}
+
+void Simulation::spawnAgents(const int count, const unsigned seed)
+{
+    LAB6FLOWFIELD_PROFILE_SCOPE("Simulation::spawnAgents");
+
+    std::vector<int> passableCells;
+    for (int i = 0; i < m_field.getCellCount(); i++)
+    {
+        if (!m_field.isObstacle(i)) passableCells.push_back(i);
+    }
+    if (passableCells.empty()) return;
+
+    // The raw numbers of the generator are used, the standard distributions differ between standard libraries
+    std::mt19937 random(seed);
+    const float cellSize = m_field.getCellSize();
+    const auto offset = [&random, cellSize]
+    {
+        return static_cast<float>(random() >> 8) / static_cast<float>(1 << 24) * cellSize;
+    };
+
+    m_agents.reserve(m_agents.size() + count);
+    for (int i = 0; i < count; i++)
+    {
+        const int cell = passableCells[random() % passableCells.size()];
+        const float x = static_cast<float>(cell % m_field.getWidth()) * cellSize + offset();
+        const float y = static_cast<float>(cell / m_field.getWidth()) * cellSize + offset();
+        m_agents.add(x, y);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef LAB6FLOWFIELD_SIMULATION_HPP
+#define LAB6FLOWFIELD_SIMULATION_HPP
+
+#include <cstdint>
+
+#include "Scenario.hpp"
+#include "../Crowd/AgentStore.hpp"
+#include "../FlowField/FlowField.hpp"
+#include "../FlowField/ObstacleMap.hpp"
+
+class ThreadPool;
+
+/**
+ * \brief Headless run of a scenario: the flow field and the crowd of the game stepped at a fixed time step
+ * \details Each tick runs the events of the scenario due on it, brings the flow field up to date, then moves the agents
+ * like Game::update() does, without a window nor a clock. The flow field is calculated on the calling thread instead of
+ * in the background (see AsyncFlowField): the tick on which a new field is used does not depend on how long it takes
+ * to calculate, so a run only depends on its scenario and gives the same agents and fields however fast the machine and
+ * whatever the number of threads.
+ *
+ * A single obstacle changed while the field is up to date is repaired in place (see FlowField::updateObstacle()), a
+ * new goal or a bulk edit calculates the whole field again, once per tick whatever the number of events.
+ */
+class Simulation
+{
+public:
+    /**
+     * \brief Build the map of the scenario, no tick is run
+     * \param pool threads to calculate the field and move the agents on, the calling thread only when nullptr
+     */
+    Simulation(const Scenario& scenario, ThreadPool* pool);
+
+    /**
+     * \brief Run the events of the current tick, then move the agents by one time step
+     */
+    void step();
+
+    /**
+     * \brief Whether every tick of the scenario has been run
+     */
+    bool isFinished() const;
+
+    /**
+     * \brief Number of ticks already run
+     */
+    int getTick() const;
+    float getTimeStep() const;
+
+    const FlowField& getField() const;
+    const AgentStore& getAgents() const;
+
+    /**
+     * \brief Number of times the whole field was calculated, and of obstacles repaired in place
+     */
+    int getCalculationCount() const;
+    int getRepairCount() const;
+
+    /**
+     * \brief Hash of the state of the simulation: tick, positions and velocities of the agents, and vector field
+     * \details Two runs of the same scenario have the same checksum after the same tick, so the checksums printed by
+     * two builds tell whether a change kept the simulation the same.
+     */
+    std::uint64_t getChecksum() const;
+
+private:
+    void runEvent(const Scenario::Event& event);
+
+    /**
+     * \brief Add agents anywhere in random passable cells, with a random generator of its own for each spawn
+     */
+    void spawnAgents(int count, unsigned seed);
+
+    const Scenario& m_scenario;
+    ThreadPool* m_pool;
+
+    FlowField m_field;
+    // Kept in sync with the obstacles of m_field, edited in bulk then applied with FlowField::setObstacles()
+    ObstacleMap m_obstacles;
+    AgentStore m_agents;
+
+    float m_timeStep;
+    int m_tick;
+    size_t m_nextEvent;
+
+    bool m_hasGoal;
+    // The field does not match the map or the goal anymore, calculated again before the agents move
+    bool m_isFieldStale;
+
+    int m_calculationCount;
+    int m_repairCount;
+};
+
+
+#endif //LAB6FLOWFIELD_SIMULATION_HPP
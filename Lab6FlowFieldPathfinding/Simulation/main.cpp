@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../Crowd/ThreadPool.hpp"
+#include "../Profiling/Profiler.hpp"
+#include "Scenario.hpp"
+#include "Simulation.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::string scenarioPath;
+        // Threads calculating the field and moving the agents, the calling one included
+        int threadCount = ThreadPool::getDefaultWorkerCount() + 1;
+        // Ticks of the scenario when negative
+        int tickCount = -1;
+        // Print the checksum every this number of ticks, to find the first tick where two runs differ, never when 0
+        int checksumInterval = 0;
+        // Chrome trace of the run, one frame per tick, none when empty
+        std::string tracePath;
+    };
+
+    void printUsage(const char* program)
+    {
+        std::printf("Usage: %s <scenario> [--threads N] [--ticks N] [--checksums N] [--trace trace.json]\n", program);
+    }
+
+    bool parseOptions(const int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string argument = argv[i];
+            if (argument == "--help") return false;
+
+            if (argument.compare(0, 2, "--") != 0)
+            {
+                if (!options.scenarioPath.empty()) return false;
+                options.scenarioPath = argument;
+                continue;
+            }
+
+            if (i + 1 >= argc) return false;
+            const std::string value = argv[++i];
+            if (argument == "--threads") options.threadCount = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--ticks") options.tickCount = std::max(0, std::atoi(value.c_str()));
+            else if (argument == "--checksums") options.checksumInterval = std::max(0, std::atoi(value.c_str()));
+            else if (argument == "--trace") options.tracePath = value;
+            else return false;
+        }
+
+        return !options.scenarioPath.empty();
+    }
+
+    /**
+     * \brief Value under which a fraction of the sorted values are, nearest rank
+     */
+    double getPercentile(const std::vector<double>& sortedValues, const double fraction)
+    {
+        if (sortedValues.empty()) return 0;
+
+        const auto rank = static_cast<size_t>(fraction * static_cast<double>(sortedValues.size()) + 0.999999);
+        return sortedValues[std::min(std::max<size_t>(rank, 1), sortedValues.size()) - 1];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Scenario scenario;
+    std::string error;
+    if (!Scenario::load(options.scenarioPath, scenario, error))
+    {
+        std::fprintf(stderr, "%s: %s\n", options.scenarioPath.c_str(), error.c_str());
+        return 1;
+    }
+    if (options.tickCount >= 0) scenario.tickCount = options.tickCount;
+
+    Profiler::setThreadName("main");
+    if (!options.tracePath.empty()) Profiler::startCapture();
+
+    ThreadPool pool(options.threadCount - 1);
+    Simulation simulation(scenario, &pool);
+
+    std::printf("scenario   %s\n", options.scenarioPath.c_str());
+    std::printf("map        %dx%d %s, %s integrator%s\n", scenario.width, scenario.height,
+                scenario.mapFilePath.empty() ? MapGenerator::getName(scenario.mapType).c_str()
+                                             : scenario.mapFilePath.c_str(),
+                Scenario::getIntegratorName(scenario.integrator),
+                scenario.isLineOfSightEnabled ? ", line of sight" : "");
+    std::printf("threads    %d\n", pool.getThreadCount());
+    std::fflush(stdout);
+
+    // Time of each tick, in milliseconds
+    std::vector<double> tickMilliseconds;
+    tickMilliseconds.reserve(scenario.tickCount);
+    int slowestTick = 0;
+
+    const auto start = Clock::now();
+    while (!simulation.isFinished())
+    {
+        Profiler::beginFrame();
+
+        const auto tickStart = Clock::now();
+        simulation.step();
+        const auto tickEnd = Clock::now();
+
+        const double milliseconds = std::chrono::duration<double, std::milli>(tickEnd - tickStart).count();
+        if (tickMilliseconds.empty() || milliseconds > tickMilliseconds[slowestTick])
+        {
+            slowestTick = static_cast<int>(tickMilliseconds.size());
+        }
+        tickMilliseconds.push_back(milliseconds);
+
+        // Outside of the measured time, a checksum hashes every agent
+        if (options.checksumInterval > 0 && simulation.getTick() % options.checksumInterval == 0)
+        {
+            std::printf("tick %-6d %016" PRIx64 "\n", simulation.getTick(), simulation.getChecksum());
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Closes the frame of the last tick
+    Profiler::beginFrame();
+
+    const int tickCount = simulation.getTick();
+    const double slowestMilliseconds = tickMilliseconds.empty() ? 0 : tickMilliseconds[slowestTick];
+    std::sort(tickMilliseconds.begin(), tickMilliseconds.end());
+
+    std::printf("agents     %d\n", simulation.getAgents().size());
+    std::printf("fields     %d calculated, %d obstacles repaired\n", simulation.getCalculationCount(),
+                simulation.getRepairCount());
+    std::printf("ticks      %d, %.1f s of simulated time\n", tickCount,
+                static_cast<double>(tickCount) * simulation.getTimeStep());
+    std::printf("run        %.3f s, %.0f ticks/s, %.1fx real time\n", seconds,
+                seconds > 0 ? tickCount / seconds : 0.0,
+                seconds > 0 ? tickCount * simulation.getTimeStep() / seconds : 0.0);
+    std::printf("tick ms    p50 %.3f  p90 %.3f  p99 %.3f  max %.3f (tick %d)\n",
+                getPercentile(tickMilliseconds, 0.5), getPercentile(tickMilliseconds, 0.9),
+                getPercentile(tickMilliseconds, 0.99), slowestMilliseconds, slowestTick);
+    std::printf("checksum   %016" PRIx64 "\n", simulation.getChecksum());
+
+    if (!options.tracePath.empty())
+    {
+        if (!Profiler::stopCapture(options.tracePath))
+        {
+            std::fprintf(stderr, "cannot write the trace to %s\n", options.tracePath.c_str());
+            return 1;
+        }
+        std::printf("trace      %s\n", options.tracePath.c_str());
+    }
+
+    return 0;
+}